@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <stdexcept>
+#include <pokerstove/util/lastbit.h>
+#include <pokerstove/util/utypes.h>
+#include "BlockerEnumerator.h"
+#include "BoardRanking.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+RangeComposition::RangeComposition ()
+  : nuts(0.0)
+  , total(0.0)
+{
+  std::fill (weight, weight+NUM_EVAL_TYPES, 0.0);
+}
+
+double RangeComposition::fraction (int type) const
+{
+  return total > 0.0 ? weight[type] / total : 0.0;
+}
+
+double RangeComposition::nutsFraction () const
+{
+  return total > 0.0 ? nuts / total : 0.0;
+}
+
+BlockerEnumerator::BlockerEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                                      const CardSet& board,
+                                      const CardDistribution& range,
+                                      const CardSet& dead)
+  : _blocked(board | dead)
+  , _words(0)
+{
+  TraceSpan span ("blockers", "enum");
+  if (span.active ())
+    span.setDetail (board.str ());
+  BoardRanking ranking (peval, board, dead);
+  if (ranking.size() > 0)
+    _nuts = ranking.evaluation (0);
+
+  vector<CardSet> hands;
+  for (size_t i=0; i<range.size(); i++)
+    if (range.weight (i) > 0.0 && !range[i].intersects (_blocked))
+      {
+        hands.push_back (range[i]);
+        _weights.push_back (range.weight (i));
+      }
+
+  vector<PokerHandEvaluation> evals;
+  peval->evaluateHands (hands, board, evals);
+
+  _words = (hands.size() + 63) / 64;
+  _cardMasks.assign (CardSet::STANDARD_DECK_SIZE * _words, 0);
+  _types.resize (hands.size());
+  _isNuts.resize (hands.size());
+  for (size_t h=0; h<hands.size(); h++)
+    {
+      _types[h]  = static_cast<uint8_t>(evals[h].eval(0).type());
+      _isNuts[h] = evals[h].eval(0) == _nuts;
+      _composition.weight[_types[h]] += _weights[h];
+      if (_isNuts[h])
+        _composition.nuts += _weights[h];
+      _composition.total += _weights[h];
+
+      uint64_t m = hands[h].mask();
+      for (size_t c=0; c<CardSet::STANDARD_DECK_SIZE; c++)
+        if (m & (ONE64 << c))
+          _cardMasks[c*_words + h/64] |= ONE64 << (h%64);
+    }
+}
+
+BlockerStats BlockerEnumerator::calculate (const CardSet& hero) const
+{
+  if (hero.intersects (_blocked))
+    throw std::invalid_argument ("BlockerEnumerator: the hero conflicts with the board");
+
+  vector<size_t> cards;
+  for (size_t c=0; c<CardSet::STANDARD_DECK_SIZE; c++)
+    if (hero.mask() & (ONE64 << c))
+      cards.push_back (c);
+
+  BlockerStats stats;
+  stats.before = _composition;
+  stats.after  = _composition;
+  for (size_t w=0; w<_words; w++)
+    {
+      uint64_t blocked = 0;
+      for (size_t i=0; i<cards.size(); i++)
+        blocked |= _cardMasks[cards[i]*_words + w];
+      while (blocked)
+        {
+          uint b = firstbit (blocked);
+          blocked ^= ONE64 << b;
+          size_t h = w*64 + b;
+          stats.after.weight[_types[h]] -= _weights[h];
+          if (_isNuts[h])
+            stats.after.nuts -= _weights[h];
+          stats.after.total -= _weights[h];
+        }
+    }
+  return stats;
+}
+
+void BlockerEnumerator::memoryFootprint (MemoryFootprint& mem) const
+{
+  mem.add ("caches", "blocker weights", _weights.empty() ? NULL : &_weights[0],
+           _weights.capacity() * sizeof(double) + _types.capacity() + _isNuts.capacity());
+  mem.add ("caches", "blocker card masks", _cardMasks.empty() ? NULL : &_cardMasks[0],
+           _cardMasks.capacity() * sizeof(uint64_t));
+}
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_BLOCKERENUMERATOR_H_
+#define PENUM_BLOCKERENUMERATOR_H_
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PokerEvaluation.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include "CardDistribution.h"
+
+namespace pokerstove
+{
+  /**
+   * The weight of a range in each hand category on a board: the hand
+   * types of PokerEvaluation (ONE_PAIR, FLUSH, ...), and the hands
+   * which make the nuts.
+   */
+  struct RangeComposition
+  {
+    double weight[NUM_EVAL_TYPES];
+    double nuts;
+    double total;
+
+    RangeComposition ();
+
+    double fraction (int type) const;
+    double nutsFraction () const;
+  };
+
+  /**
+   * How the hero's cards change a villain range: the composition
+   * before, and after removing the hands the hero's cards block.
+   */
+  struct BlockerStats
+  {
+    RangeComposition before;
+    RangeComposition after;
+
+    /**
+     * change in the fraction of the range of a hand type
+     */
+    double change (int type) const { return after.fraction (type) - before.fraction (type); }
+    double nutsChange () const     { return after.nutsFraction () - before.nutsFraction (); }
+  };
+
+  /**
+   * Card removal statistics of a villain range on a board.  The range
+   * is evaluated once, with PokerHandEvaluator::evaluateHands, and for
+   * every card a bit mask of the range hands holding it is built.  A
+   * query ORs the masks of the hero's cards and subtracts the weight
+   * of just the blocked hands, so it never evaluates a hand.
+   *
+   * Categories are the hand types of the first evaluation, which are
+   * meaningful for high games.  The nuts are the best evaluation any
+   * hand can make on the board, whether or not it is in the range.
+   */
+  class BlockerEnumerator
+  {
+  public:
+    /**
+     * Throws std::invalid_argument for a game without a board.
+     */
+    BlockerEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                       const CardSet& board,
+                       const CardDistribution& range,
+                       const CardSet& dead=CardSet());
+
+    /**
+     * the range on the board, with no cards removed
+     */
+    const RangeComposition& composition () const { return _composition; }
+
+    const PokerEvaluation& nuts () const { return _nuts; }
+
+    /**
+     * Throws std::invalid_argument if the hero conflicts with the
+     * board or dead cards.
+     */
+    BlockerStats calculate (const CardSet& hero) const;
+
+    /**
+     * add the range tables and card masks to mem, as a cache
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+  private:
+    CardSet                 _blocked;       //!< board and dead cards
+    PokerEvaluation         _nuts;
+    RangeComposition        _composition;
+    std::vector<double>     _weights;       //!< of each range hand left on the board
+    std::vector<uint8_t>    _types;
+    std::vector<uint8_t>    _isNuts;
+    size_t                  _words;         //!< per card mask
+    std::vector<uint64_t>   _cardMasks;     //!< card major, _words each
+  };
+}
+
+#endif  // PENUM_BLOCKERENUMERATOR_H_
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <stdexcept>
+#include <pokerstove/util/combinations.h>
+#include <pokerstove/util/utypes.h>
+#include "BoardRanking.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+BoardRanking::BoardRanking (boost::shared_ptr<PokerHandEvaluator> peval,
+                            const CardSet& board,
+                            const CardSet& dead)
+  : _board(board)
+{
+  if (peval->boardSize() == 0)
+    throw std::invalid_argument ("BoardRanking: the game has no board");
+
+  TraceSpan span ("board ranking", "enum");
+  if (span.active ())
+    span.setDetail (board.str ());
+  CardSet deck (((ONE64 << CardSet::STANDARD_DECK_SIZE) - 1) & ~(board | dead).mask());
+  vector<CardSet> cards = deck.cardSets ();
+  size_t hsize = peval->handSize ();
+  vector<CardSet> hands;
+  if (hsize <= cards.size())
+    {
+      combinations combo (cards.size(), hsize);
+      do
+        {
+          CardSet hand;
+          for (size_t i=0; i<hsize; i++)
+            hand |= cards[combo[i]];
+          hands.push_back (hand);
+        }
+      while (combo.next ());
+    }
+
+  vector<PokerHandEvaluation> evals;
+  peval->evaluateHands (hands, board, evals);
+
+  // strongest first: the complemented code in the high bits, with the
+  // deal order below it so that ties keep that order.  Flipping the
+  // sign bit keeps the order of negative codes.
+  vector<uint64_t> keys (hands.size());
+  for (size_t i=0; i<hands.size(); i++)
+    {
+      uint32_t code = static_cast<uint32_t>(evals[i].eval(0).code()) ^ 0x80000000u;
+      keys[i] = (static_cast<uint64_t>(~code) << 32) | static_cast<uint32_t>(i);
+    }
+  sort (keys.begin(), keys.end());
+
+  _hands.resize (hands.size());
+  _evals.resize (hands.size());
+  _ranks.resize (hands.size());
+  _byMask.resize (hands.size());
+  for (size_t pos=0; pos<keys.size(); pos++)
+    {
+      size_t i = static_cast<uint32_t>(keys[pos]);
+      _hands[pos] = hands[i];
+      _evals[pos] = evals[i].eval(0);
+      if (pos == 0 || _evals[pos] != _evals[pos-1])
+        _groups.push_back (static_cast<uint32_t>(pos));
+      _ranks[pos]  = static_cast<uint32_t>(_groups.size() - 1);
+      _byMask[pos] = make_pair (hands[i].mask(), static_cast<uint32_t>(pos));
+    }
+  _groups.push_back (static_cast<uint32_t>(_hands.size()));
+  sort (_byMask.begin(), _byMask.end());
+}
+
+size_t BoardRanking::find (const CardSet& hand) const
+{
+  vector<pair<uint64_t,uint32_t> >::const_iterator it =
+    lower_bound (_byMask.begin(), _byMask.end(), make_pair (hand.mask(), static_cast<uint32_t>(0)));
+  if (it == _byMask.end() || it->first != hand.mask())
+    return size ();
+  return it->second;
+}
+
+void BoardRanking::memoryFootprint (MemoryFootprint& mem) const
+{
+  mem.add ("caches", "ranking hands", _hands.empty() ? NULL : &_hands[0],
+           _hands.capacity() * sizeof(CardSet));
+  mem.add ("caches", "ranking evaluations", _evals.empty() ? NULL : &_evals[0],
+           _evals.capacity() * sizeof(PokerEvaluation));
+  mem.add ("caches", "ranking ranks", _ranks.empty() ? NULL : &_ranks[0],
+           (_ranks.capacity() + _groups.capacity()) * sizeof(uint32_t));
+  mem.add ("caches", "ranking index", _byMask.empty() ? NULL : &_byMask[0],
+           _byMask.capacity() * sizeof(pair<uint64_t,uint32_t>));
+}
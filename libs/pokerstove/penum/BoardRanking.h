@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_BOARDRANKING_H_
+#define PENUM_BOARDRANKING_H_
+
+#include <utility>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PokerEvaluation.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+
+namespace pokerstove
+{
+  /**
+   * Every hand which can be dealt with a board, sorted from the nuts
+   * down, with the dense rank of each position and the tie groups.
+   * Rank 0 is the nuts, and the hands of one rank are a contiguous
+   * group of positions.  Split pot games are ranked by their first
+   * evaluation, the high hand.
+   *
+   * The hands are evaluated with one PokerHandEvaluator::evaluateHands
+   * call, and sorted as integer keys built from the evaluation codes,
+   * so that hands of equal strength stay in deal order.
+   */
+  class BoardRanking
+  {
+  public:
+    /**
+     * Throws std::invalid_argument for a game without a board.
+     */
+    BoardRanking (boost::shared_ptr<PokerHandEvaluator> peval,
+                  const CardSet& board,
+                  const CardSet& dead=CardSet());
+
+    const CardSet& board () const { return _board; }
+
+    size_t size () const { return _hands.size(); }
+
+    const CardSet& hand (size_t pos) const          { return _hands[pos]; }
+    const PokerEvaluation& evaluation (size_t pos) const { return _evals[pos]; }
+    size_t rank (size_t pos) const                  { return _ranks[pos]; }
+
+    size_t numRanks () const { return _groups.size() - 1; }
+
+    /**
+     * the positions [first, last) of the hands of rank r
+     */
+    std::pair<size_t,size_t> group (size_t r) const
+    {
+      return std::make_pair (_groups[r], _groups[r+1]);
+    }
+
+    /**
+     * the position of hand, or size() if it can not be dealt
+     */
+    size_t find (const CardSet& hand) const;
+
+    /**
+     * add the ranking arrays to mem, as a cache
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+  private:
+    CardSet                                  _board;
+    std::vector<CardSet>                     _hands;
+    std::vector<PokerEvaluation>             _evals;
+    std::vector<uint32_t>                    _ranks;
+    std::vector<uint32_t>                    _groups;    //!< first position of each rank, then size()
+    std::vector<std::pair<uint64_t,uint32_t> > _byMask;  //!< (hand mask, position), sorted
+  };
+}
+
+#endif  // PENUM_BOARDRANKING_H_
@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "BucketTable.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t BucketTable::MAX_BUCKETS;
+
+namespace
+{
+  const char     BUCKET_MAGIC[4] = { 'P', 'S', 'B', 'K' };
+  const uint32_t BUCKET_VERSION  = 1;
+  const size_t   HEADER_SIZE     = 32;
+
+  void putU32 (uint8_t * p, uint32_t v)
+  {
+    for (int i=0; i<4; i++)
+      p[i] = static_cast<uint8_t>(v >> (8*i));
+  }
+
+  uint32_t getU32 (const uint8_t * p)
+  {
+    uint32_t v = 0;
+    for (int i=0; i<4; i++)
+      v |= static_cast<uint32_t>(p[i]) << (8*i);
+    return v;
+  }
+}
+
+BucketTable::BucketTable ()
+  : _file()
+  , _filename()
+  , _street(0)
+  , _buckets(0)
+  , _count(0)
+  , _table(NULL)
+  , _indexer()
+{}
+
+BucketTable::BucketTable (const string& filename)
+  : _file()
+  , _filename()
+  , _street(0)
+  , _buckets(0)
+  , _count(0)
+  , _table(NULL)
+  , _indexer()
+{
+  open (filename);
+}
+
+void BucketTable::open (const string& filename)
+{
+  TraceSpan span ("load", "table", filename);
+  close ();
+  _file.open (filename);
+  _filename = filename;
+  const uint8_t * p = reinterpret_cast<const uint8_t*>(_file.data());
+  if (_file.size() < HEADER_SIZE || memcmp (p, BUCKET_MAGIC, 4) != 0)
+    {
+      close ();
+      throw std::runtime_error ("BucketTable: not a bucket table: " + filename);
+    }
+  if (getU32 (p+4) != BUCKET_VERSION)
+    {
+      close ();
+      throw std::runtime_error ("BucketTable: unsupported table version: " + filename);
+    }
+
+  size_t street = getU32 (p+8);
+  size_t buckets = getU32 (p+12);
+  uint64_t count = static_cast<uint64_t>(getU32 (p+16)) | (static_cast<uint64_t>(getU32 (p+20)) << 32);
+  if (street >= NUM_HOLDEM_ROUNDS || count > _indexer.size (street)
+      || HEADER_SIZE + 2*count > _file.size())
+    {
+      close ();
+      throw std::runtime_error ("BucketTable: truncated or mismatched table: " + filename);
+    }
+  _street  = street;
+  _buckets = buckets;
+  _count   = count;
+  _table   = p + HEADER_SIZE;
+}
+
+void BucketTable::close ()
+{
+  if (_file.is_open())
+    _file.close ();
+  _filename.clear ();
+  _street  = 0;
+  _buckets = 0;
+  _count   = 0;
+  _table   = NULL;
+}
+
+size_t BucketTable::lookup (const CardSet& hole, const CardSet& board) const
+{
+  if (HoldemHandIndexer::street (board) != _street)
+    throw std::invalid_argument ("BucketTable: the board is not of the table's street");
+  uint64_t idx = _indexer.index (hole, board);
+  if (idx >= _count)
+    throw std::out_of_range ("BucketTable: the state is not in the table");
+  return lookup (idx);
+}
+
+void BucketTable::memoryFootprint (MemoryFootprint& mem) const
+{
+  if (_file.is_open())
+    mem.add ("files", _filename, _file.data(), _file.size());
+}
+
+void BucketTable::write (const string& filename, size_t street, size_t buckets,
+                         const vector<uint32_t>& assignment)
+{
+  HoldemHandIndexer indexer;
+  if (street >= NUM_HOLDEM_ROUNDS || buckets == 0 || buckets > MAX_BUCKETS
+      || assignment.size() > indexer.size (street))
+    throw std::invalid_argument ("BucketTable: bad street, bucket count or number of states");
+
+  vector<uint8_t> bytes (HEADER_SIZE + 2*assignment.size(), 0);
+  memcpy (&bytes[0], BUCKET_MAGIC, 4);
+  putU32 (&bytes[4], BUCKET_VERSION);
+  putU32 (&bytes[8], static_cast<uint32_t>(street));
+  putU32 (&bytes[12], static_cast<uint32_t>(buckets));
+  putU32 (&bytes[16], static_cast<uint32_t>(assignment.size()));
+  putU32 (&bytes[20], static_cast<uint32_t>(static_cast<uint64_t>(assignment.size()) >> 32));
+  for (size_t i=0; i<assignment.size(); i++)
+    {
+      if (assignment[i] >= buckets)
+        throw std::invalid_argument ("BucketTable: bucket out of range");
+      bytes[HEADER_SIZE + 2*i]   = static_cast<uint8_t>(assignment[i]);
+      bytes[HEADER_SIZE + 2*i+1] = static_cast<uint8_t>(assignment[i] >> 8);
+    }
+
+  TraceSpan span ("write", "output", filename);
+  ofstream out (filename.c_str(), ios::binary);
+  out.write (reinterpret_cast<const char*>(&bytes[0]), bytes.size());
+  if (!out)
+    throw std::runtime_error ("BucketTable: unable to write " + filename);
+}
@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_BUCKETTABLE_H_
+#define PENUM_BUCKETTABLE_H_
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include "HoldemHandIndexer.h"
+
+namespace pokerstove
+{
+  /**
+   * The bucket of every suit isomorphic hold'em state of one street,
+   * as found by clustering (see KMeans), indexed by HoldemHandIndexer.
+   * The file is memory mapped like HandStrengthTable.
+   *
+   * The file starts with a 32 byte header (the magic "PSBK", version,
+   * street, number of buckets and number of states, little endian),
+   * followed by one little endian u16 bucket per state, so there can
+   * be at most 65536 buckets.  A table may cover only the first states
+   * of its street.
+   */
+  class BucketTable
+  {
+  public:
+    static const size_t MAX_BUCKETS = 65536;
+
+    BucketTable ();
+    explicit BucketTable (const std::string& filename);
+
+    void open (const std::string& filename);
+    void close ();
+    bool isOpen () const { return _file.is_open(); }
+
+    size_t street () const { return _street; }
+    size_t numBuckets () const { return _buckets; }
+    uint64_t size () const { return _count; }
+
+    size_t lookup (uint64_t idx) const
+    {
+      return _table[2*idx] | (_table[2*idx+1] << 8);
+    }
+
+    /**
+     * bucket of the hole cards with a board of the table's street
+     */
+    size_t lookup (const CardSet& hole, const CardSet& board) const;
+
+    const HoldemHandIndexer& indexer () const { return _indexer; }
+
+    /**
+     * add the mapped file to mem
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+    /**
+     * Write the buckets of the first assignment.size() states of a
+     * street.  Throws std::invalid_argument if there are too many
+     * buckets or states, or a bucket is out of range.
+     */
+    static void write (const std::string& filename, size_t street, size_t buckets,
+                       const std::vector<uint32_t>& assignment);
+
+  private:
+    boost::iostreams::mapped_file_source _file;
+    std::string                          _filename;
+    size_t                               _street;
+    size_t                               _buckets;
+    uint64_t                             _count;
+    const uint8_t *                      _table;
+    HoldemHandIndexer                    _indexer;
+  };
+}
+
+#endif  // PENUM_BUCKETTABLE_H_
@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <stdexcept>
+#include <vector>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+#include <pokerstove/util/combinations.h>
+#include <pokerstove/peval/Card.h>
+#include "CardDistribution.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace boost;
+using namespace pokerstove;
+
+CardDistribution::CardDistribution ()
+  : _hands()
+  , _weights()
+  , _desc()
+{}
+
+CardDistribution::CardDistribution (const CardSet& hand)
+  : _hands(1, hand)
+  , _weights(1, 1.0)
+  , _desc(hand.str())
+{}
+
+CardDistribution::CardDistribution (const string& s, size_t handSize)
+  : _hands()
+  , _weights()
+  , _desc()
+{
+  parse (s, handSize);
+}
+
+void CardDistribution::clear ()
+{
+  _hands.clear ();
+  _weights.clear ();
+  _desc.clear ();
+}
+
+void CardDistribution::fill (size_t n)
+{
+  CardSet deck;
+  deck.fill ();
+  fill (deck, n);
+}
+
+void CardDistribution::fill (const CardSet& deck, size_t n)
+{
+  clear ();
+  vector<CardSet> cards;
+  for (size_t i=0; i<CardSet::STANDARD_DECK_SIZE; i++)
+    if (deck.contains (Card(static_cast<uint8_t>(i))))
+      cards.push_back (CardSet(Card(static_cast<uint8_t>(i))));
+  if (n == 0 || n > cards.size())
+    return;
+
+  combinations combo (cards.size(), n);
+  do
+    {
+      CardSet hand;
+      for (size_t i=0; i<n; i++)
+        hand |= cards[combo[i]];
+      insert (hand);
+    }
+  while (combo.next ());
+  _desc = "random";
+}
+
+void CardDistribution::insert (const CardSet& hand, double weight)
+{
+  _hands.push_back (hand);
+  _weights.push_back (weight);
+}
+
+void CardDistribution::removeConflicts (const CardSet& dead)
+{
+  size_t n = 0;
+  for (size_t i=0; i<_hands.size(); i++)
+    {
+      if (_hands[i].intersects (dead))
+        continue;
+      _hands[n] = _hands[i];
+      _weights[n] = _weights[i];
+      n++;
+    }
+  _hands.resize (n);
+  _weights.resize (n);
+}
+
+double CardDistribution::totalWeight () const
+{
+  double total = 0.0;
+  for (size_t i=0; i<_weights.size(); i++)
+    total += _weights[i];
+  return total;
+}
+
+size_t CardDistribution::handSize () const
+{
+  if (_hands.empty ())
+    return 0;
+  return _hands[0].size ();
+}
+
+string CardDistribution::str () const
+{
+  if (!_desc.empty ())
+    return _desc;
+
+  string ret;
+  for (size_t i=0; i<_hands.size(); i++)
+    {
+      if (i > 0)
+        ret += ",";
+      ret += _hands[i].str ();
+    }
+  return ret;
+}
+
+void CardDistribution::memoryFootprint (MemoryFootprint& mem, const string& name) const
+{
+  mem.add ("ranges", name + " hands", _hands.empty() ? NULL : &_hands[0],
+           _hands.capacity() * sizeof(CardSet));
+  mem.add ("ranges", name + " weights", _weights.empty() ? NULL : &_weights[0],
+           _weights.capacity() * sizeof(double));
+}
+
+void CardDistribution::parse (const string& instr, size_t handSize)
+{
+  TraceSpan span ("parse", "parse", instr);
+  clear ();
+  string in = erase_all_copy (instr, " ");
+
+  vector<string> tokens;
+  split (tokens, in, is_any_of(","));
+  for (size_t i=0; i<tokens.size(); i++)
+    {
+      if (tokens[i].empty ())
+        continue;
+
+      double weight = 1.0;
+      string token = tokens[i];
+      size_t colon = token.find (':');
+      if (colon != string::npos)
+        {
+          try
+            {
+              weight = lexical_cast<double> (token.substr (colon+1));
+            }
+          catch (bad_lexical_cast&)
+            {
+              throw std::invalid_argument ("CardDistribution: bad weight: " + token);
+            }
+          token = token.substr (0, colon);
+        }
+      parseToken (token, weight, handSize);
+    }
+  _desc = in;
+}
+
+void CardDistribution::parseToken (const string& token, double weight, size_t handSize)
+{
+  if (token == "random")
+    {
+      CardDistribution all;
+      all.fill (handSize);
+      for (size_t i=0; i<all.size(); i++)
+        insert (all[i], weight);
+      return;
+    }
+
+  // rank classes, "AA", "AKs", "AKo", "AK"
+  if ((token.size() == 2 || token.size() == 3) &&
+      string ("cdhsCDHS").find (token[1]) == string::npos)
+    {
+      Rank r1, r2;
+      try
+        {
+          r1 = Rank (token.substr (0,1));
+          r2 = Rank (token.substr (1,1));
+        }
+      catch (std::exception&)
+        {
+          throw std::invalid_argument ("CardDistribution: bad hand class: " + token);
+        }
+
+      bool suited  = token.size() == 3 && token[2] == 's';
+      bool offsuit = token.size() == 3 && token[2] == 'o';
+      if (token.size() == 3 && !suited && !offsuit)
+        throw std::invalid_argument ("CardDistribution: bad hand class: " + token);
+      if (r1 == r2 && suited)
+        throw std::invalid_argument ("CardDistribution: pairs can not be suited: " + token);
+
+      for (Suit s1=Suit::begin(); s1<Suit::end(); ++s1)
+        for (Suit s2=Suit::begin(); s2<Suit::end(); ++s2)
+          {
+            if (r1 == r2 && !(s1 < s2))
+              continue;
+            if (suited && !(s1 == s2))
+              continue;
+            if (offsuit && s1 == s2)
+              continue;
+            CardSet hand;
+            hand.insert (Card (r1, s1));
+            hand.insert (Card (r2, s2));
+            insert (hand, weight);
+          }
+      return;
+    }
+
+  // an explicit hand
+  CardSet hand (token);
+  if (token.size() % 2 != 0 || hand.size() * 2 != token.size())
+    throw std::invalid_argument ("CardDistribution: bad hand: " + token);
+  insert (hand, weight);
+}
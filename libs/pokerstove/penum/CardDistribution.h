@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_CARDDISTRIBUTION_H_
+#define PENUM_CARDDISTRIBUTION_H_
+
+#include <string>
+#include <vector>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+
+namespace pokerstove
+{
+  /**
+   * A weighted set of hands, the range of hands a player may hold.
+   * Every hand in a distribution is expected to have the same number
+   * of cards.
+   *
+   * The string form is a comma separated list of tokens, each token
+   * optionally followed by :weight.  A token is one of:
+   * - an explicit hand, "AcKd" or "AcAdKhKs"
+   * - a two card rank class, "AA", "AKs", "AKo", or "AK"
+   * - "random", every hand of the requested size
+   *
+   * examples:
+   *   "AcAs"
+   *   "AA,KK,AKs:0.5"
+   *   "random"
+   */
+  class CardDistribution
+  {
+  public:
+    CardDistribution ();                                  //!< the empty distribution
+    explicit CardDistribution (const CardSet& hand);      //!< a single hand with weight 1
+    explicit CardDistribution (const std::string& s,
+                               size_t handSize=2);        //!< @see parse
+
+    /**
+     * Parse a distribution string, replacing the current contents.
+     * handSize is only used to expand "random".  Throws
+     * std::invalid_argument on unparseable input.
+     */
+    void parse (const std::string& s, size_t handSize=2);
+
+    void clear ();
+    void fill (size_t n);                                 //!< every n card hand
+    void fill (const CardSet& deck, size_t n);            //!< every n card hand from deck
+    void insert (const CardSet& hand, double weight=1.0);
+
+    /**
+     * Remove every hand which intersects the dead cards.
+     */
+    void removeConflicts (const CardSet& dead);
+
+    size_t size () const                      { return _hands.size(); }
+    bool   empty () const                     { return _hands.empty(); }
+    const CardSet& operator[] (size_t i) const { return _hands[i]; }
+    double weight (size_t i) const            { return _weights[i]; }
+    double totalWeight () const;
+
+    /**
+     * The number of cards in each hand, zero if empty.
+     */
+    size_t handSize () const;
+
+    /**
+     * The descriptor the distribution was parsed from, or a list of
+     * the hands if it was built up by hand.
+     */
+    std::string str () const;
+
+    /**
+     * add the hand and weight storage to mem, as ranges
+     */
+    void memoryFootprint (MemoryFootprint& mem, const std::string& name) const;
+
+  private:
+    void parseToken (const std::string& token, double weight, size_t handSize);
+
+    std::vector<CardSet> _hands;
+    std::vector<double>  _weights;
+    std::string          _desc;
+  };
+}
+
+#endif  // PENUM_CARDDISTRIBUTION_H_
@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <stdexcept>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <pokerstove/util/utypes.h>
+#include "EquityJob.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+struct EquityJob::State
+{
+  ShowdownEnumerator               enumerator;
+  ShowdownEnumerator::Plan         plan;
+  std::vector<std::vector<double> > cumulative;   //!< sampling only
+  uint64_t                         trials;         //!< zero to enumerate
+  uint32_t                         seed;
+  std::vector<uint64_t>            order;          //!< chunks, in the order they run
+
+  boost::atomic<uint64_t>          next;           //!< next position in order
+  boost::atomic<bool>              cancelled;
+
+  mutable boost::mutex             lock;
+  mutable boost::condition_variable finished;
+  std::vector<ShowdownResult>      chunks;
+  ShowdownResult                   partial;        //!< sum of chunks, as they finish
+  uint64_t                         ndone;          //!< chunks finished or skipped
+  uint64_t                         nrun;           //!< chunks finished
+  bool                             failed;
+  std::string                      error;
+
+  explicit State (const ShowdownEnumerator& e)
+    : enumerator(e)
+    , trials(0)
+    , seed(0)
+    , next(0)
+    , cancelled(false)
+    , partial(e.numPlayers())
+    , ndone(0)
+    , nrun(0)
+    , failed(false)
+  {}
+
+  bool complete () const { return ndone == order.size(); }
+};
+
+/**
+ * chunks 0..n-1 in bit reversed order, so that any prefix of the
+ * order is spread evenly over [0,n)
+ */
+static vector<uint64_t> bitReversed (uint64_t n)
+{
+  int bits = 0;
+  while ((ONE64 << bits) < n)
+    bits++;
+  vector<uint64_t> order;
+  for (uint64_t i=0; i < (ONE64 << bits); i++)
+    {
+      uint64_t r = 0;
+      for (int b=0; b<bits; b++)
+        if (i & (ONE64 << b))
+          r |= ONE64 << (bits-1-b);
+      if (r < n)
+        order.push_back (r);
+    }
+  return order;
+}
+
+EquityJob::EquityJob (boost::shared_ptr<State> state)
+  : _state(state)
+{}
+
+EquityJob::~EquityJob ()
+{
+  cancel ();
+}
+
+boost::shared_ptr<EquityJob> EquityJob::enumerate (const ShowdownEnumerator& enumerator)
+{
+  boost::shared_ptr<State> state (new State (enumerator));
+  enumerator.makePlan (state->plan);
+  state->order = bitReversed (min<uint64_t> (state->plan.size(), ShowdownEnumerator::ENUMERATE_CHUNKS));
+  return start (state);
+}
+
+boost::shared_ptr<EquityJob> EquityJob::sample (const ShowdownEnumerator& enumerator,
+                                                uint64_t trials, uint32_t seed)
+{
+  boost::shared_ptr<State> state (new State (enumerator));
+  state->trials = trials;
+  state->seed   = seed;
+  enumerator.cumulativeWeights (state->cumulative);
+  uint64_t nchunks = ShowdownEnumerator::sampleChunks (trials);
+  for (uint64_t c=0; c<nchunks; c++)
+    state->order.push_back (c);
+  return start (state);
+}
+
+boost::shared_ptr<EquityJob> EquityJob::start (boost::shared_ptr<State> state)
+{
+  const size_t nplayers = state->enumerator.numPlayers();
+  state->chunks.assign (state->order.size(), ShowdownResult (nplayers));
+  boost::shared_ptr<EquityJob> job (new EquityJob (state));
+
+  // every task runs whichever chunk is next in the order, so the
+  // order holds however the pool schedules the tasks
+  ThreadPool * pool = state->enumerator.pool ();
+  for (size_t k=0; k<state->order.size(); k++)
+    {
+      if (pool == NULL)
+        runNext (state);
+      else
+        pool->submit (boost::bind (&EquityJob::runNext, state));
+    }
+  return job;
+}
+
+void EquityJob::runNext (boost::shared_ptr<State> state)
+{
+  uint64_t k = state->next.fetch_add (1);
+  uint64_t c = state->order[k];
+  bool ran = false;
+  string error;
+  ShowdownResult result (state->enumerator.numPlayers());
+  if (!state->cancelled.load ())
+    {
+      try
+        {
+          if (state->trials > 0)
+            {
+              uint64_t first = c * ShowdownEnumerator::SAMPLE_CHUNK;
+              state->enumerator.sampleChunk (&state->cumulative, first,
+                                             min (state->trials, first + ShowdownEnumerator::SAMPLE_CHUNK),
+                                             state->seed, &result);
+            }
+          else
+            {
+              uint64_t nchunks = state->order.size();
+              state->enumerator.enumerateChunk (&state->plan, state->plan.chunkBegin (c, nchunks),
+                                                state->plan.chunkBegin (c+1, nchunks), &result);
+            }
+          ran = true;
+        }
+      catch (std::exception& e)
+        {
+          error = e.what ();
+        }
+      catch (...)
+        {
+          error = "EquityJob: unknown exception in chunk";
+        }
+    }
+
+  boost::mutex::scoped_lock guard (state->lock);
+  if (ran)
+    {
+      state->chunks[c] = result;
+      state->partial  += result;
+      state->nrun++;
+    }
+  else if (!error.empty() && !state->failed)
+    {
+      // the rest of the job is skipped
+      state->failed = true;
+      state->error  = error;
+      state->cancelled.store (true);
+    }
+  state->ndone++;
+  if (state->complete ())
+    state->finished.notify_all ();
+}
+
+uint64_t EquityJob::numChunks () const
+{
+  return _state->order.size();
+}
+
+uint64_t EquityJob::chunksDone () const
+{
+  boost::mutex::scoped_lock guard (_state->lock);
+  return _state->nrun;
+}
+
+double EquityJob::progress () const
+{
+  if (_state->order.empty())
+    return 1.0;
+  return static_cast<double>(chunksDone ()) / _state->order.size();
+}
+
+ShowdownResult EquityJob::estimate () const
+{
+  boost::mutex::scoped_lock guard (_state->lock);
+  return _state->partial;
+}
+
+void EquityJob::cancel ()
+{
+  _state->cancelled.store (true);
+}
+
+bool EquityJob::cancelled () const
+{
+  return _state->cancelled.load ();
+}
+
+bool EquityJob::done () const
+{
+  boost::mutex::scoped_lock guard (_state->lock);
+  return _state->complete ();
+}
+
+void EquityJob::wait () const
+{
+  while (!waitFor (boost::posix_time::milliseconds (100)))
+    ;
+}
+
+bool EquityJob::waitFor (const boost::posix_time::time_duration& timeout) const
+{
+  ThreadPool * pool = _state->enumerator.pool ();
+  boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time () + timeout;
+
+  // a worker of the pool runs queued tasks rather than block a thread
+  // the job may need
+  if (pool != NULL && pool->workerIndex () < pool->size ())
+    while (!done () && boost::posix_time::microsec_clock::universal_time () < deadline)
+      if (!pool->runOne ())
+        break;
+
+  boost::mutex::scoped_lock guard (_state->lock);
+  while (!_state->complete ())
+    if (!_state->finished.timed_wait (guard, deadline))
+      return _state->complete ();
+  return true;
+}
+
+ShowdownResult EquityJob::result () const
+{
+  wait ();
+  TraceSpan span ("merge", "merge");
+  boost::mutex::scoped_lock guard (_state->lock);
+  if (_state->failed)
+    throw std::runtime_error (_state->error);
+  if (_state->nrun != _state->order.size())
+    throw std::runtime_error ("EquityJob: cancelled");
+  return ShowdownEnumerator::merge (_state->chunks, _state->enumerator.numPlayers());
+}
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_EQUITYJOB_H_
+#define PENUM_EQUITYJOB_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "ShowdownEnumerator.h"
+
+namespace pokerstove
+{
+  /**
+   * A showdown equity calculation running in the background, on the
+   * pool of the enumerator it was started from.  The caller keeps the
+   * handle, and can poll progress() and estimate(), wait for the
+   * result, or cancel() it, for example
+   *
+   *   boost::shared_ptr<EquityJob> job = EquityJob::enumerate (enumerator);
+   *   while (!job->waitFor (boost::posix_time::milliseconds (100)))
+   *     show (job->progress (), job->estimate ());
+   *   ShowdownResult r = job->result ();
+   *
+   * The job runs the chunks of ShowdownEnumerator::enumerateRange or
+   * sampleRange, and result() merges them in order, so it is the same
+   * bit for bit as enumerate() or sample().  The estimate is the
+   * chunks finished so far.  Exact chunks are run in bit reversed
+   * order, so that the finished part is spread over the whole job.
+   *
+   * cancel() stops the job at the next chunk boundary; destroying the
+   * handle cancels it too.  Chunks already queued on the pool return
+   * at once, so a stale job costs at most the chunks it is running.
+   * With a null pool the job has run by the time it is returned.
+   */
+  class EquityJob
+  {
+  public:
+    static boost::shared_ptr<EquityJob> enumerate (const ShowdownEnumerator& enumerator);
+    static boost::shared_ptr<EquityJob> sample (const ShowdownEnumerator& enumerator,
+                                                uint64_t trials, uint32_t seed=0);
+
+    ~EquityJob ();
+
+    uint64_t numChunks () const;
+    uint64_t chunksDone () const;
+
+    /**
+     * fraction of the chunks finished, in [0,1]
+     */
+    double progress () const;
+
+    /**
+     * merged result of the chunks finished so far
+     */
+    ShowdownResult estimate () const;
+
+    void cancel ();
+    bool cancelled () const;
+
+    /**
+     * true once no more chunks will run: finished, cancelled or failed
+     */
+    bool done () const;
+
+    void wait () const;
+    bool waitFor (const boost::posix_time::time_duration& timeout) const;
+
+    /**
+     * Wait and return the result.  Throws std::runtime_error if the
+     * job was cancelled or a chunk threw.
+     */
+    ShowdownResult result () const;
+
+  private:
+    struct State;
+
+    explicit EquityJob (boost::shared_ptr<State> state);
+    EquityJob (const EquityJob&);
+    EquityJob& operator= (const EquityJob&);
+
+    static boost::shared_ptr<EquityJob> start (boost::shared_ptr<State> state);
+    static void runNext (boost::shared_ptr<State> state);
+
+    boost::shared_ptr<State> _state;
+  };
+}
+
+#endif  // PENUM_EQUITYJOB_H_
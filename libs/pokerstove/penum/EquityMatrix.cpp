@@ -0,0 +1,350 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+#include "EquityMatrix.h"
+
+using namespace std;
+using namespace pokerstove;
+
+static const char     MATRIX_MAGIC[4] = { 'P', 'S', 'E', 'M' };
+static const uint32_t MATRIX_VERSION  = 1;
+
+/**
+ * little endian serialization helpers
+ */
+static void putU32 (uint8_t * p, uint32_t v)
+{
+  for (int i=0; i<4; i++)
+    p[i] = static_cast<uint8_t>(v >> (8*i));
+}
+
+static uint32_t getU32 (const uint8_t * p)
+{
+  uint32_t v = 0;
+  for (int i=0; i<4; i++)
+    v |= static_cast<uint32_t>(p[i]) << (8*i);
+  return v;
+}
+
+static void writeU32 (ostream& out, uint32_t v)
+{
+  uint8_t buf[4];
+  putU32 (buf, v);
+  out.write (reinterpret_cast<const char*>(buf), 4);
+}
+
+static void writeU64 (ostream& out, uint64_t v)
+{
+  writeU32 (out, static_cast<uint32_t>(v));
+  writeU32 (out, static_cast<uint32_t>(v >> 32));
+}
+
+static void writeString (ostream& out, const string& s)
+{
+  writeU32 (out, static_cast<uint32_t>(s.size()));
+  out.write (s.data(), s.size());
+}
+
+static void readBytes (istream& in, void * p, size_t n)
+{
+  in.read (reinterpret_cast<char*>(p), n);
+  if (static_cast<size_t>(in.gcount()) != n)
+    throw std::runtime_error ("EquityMatrixReader: unexpected end of file");
+}
+
+static uint32_t readU32 (istream& in)
+{
+  uint8_t buf[4];
+  readBytes (in, buf, 4);
+  return getU32 (buf);
+}
+
+static uint64_t readU64 (istream& in)
+{
+  uint64_t lo = readU32 (in);
+  uint64_t hi = readU32 (in);
+  return lo | (hi << 32);
+}
+
+static string readString (istream& in)
+{
+  uint32_t n = readU32 (in);
+  string s (n, '\0');
+  if (n > 0)
+    readBytes (in, &s[0], n);
+  return s;
+}
+
+// FNV-1a, cheap and good enough to catch torn or truncated chunks
+static uint32_t checksum (const uint8_t * p, size_t n)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i=0; i<n; i++)
+    {
+      h ^= p[i];
+      h *= 16777619u;
+    }
+  return h;
+}
+
+uint16_t pokerstove::floatToHalf (float f)
+{
+  uint32_t x;
+  memcpy (&x, &f, sizeof(x));
+
+  uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000);
+  uint32_t mant = x & 0x007FFFFF;
+  int      exp  = static_cast<int>((x >> 23) & 0xFF);
+
+  // inf and nan
+  if (exp == 0xFF)
+    return sign | 0x7C00 | (mant ? 0x0200 : 0);
+
+  int e = exp - 127 + 15;
+  if (e >= 0x1F)
+    return sign | 0x7C00;
+
+  // subnormal halves
+  if (e <= 0)
+    {
+      if (e < -10)
+        return sign;
+      mant |= 0x00800000;
+      int shift = 14 - e;
+      uint32_t half = mant >> shift;
+      uint32_t rem  = mant & ((1u << shift) - 1);
+      uint32_t mid  = 1u << (shift - 1);
+      if (rem > mid || (rem == mid && (half & 1)))
+        half++;
+      return static_cast<uint16_t>(sign | half);
+    }
+
+  // a carry out of the mantissa correctly bumps the exponent
+  uint32_t half = (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+  uint32_t rem  = mant & 0x1FFF;
+  if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+    half++;
+  return static_cast<uint16_t>(sign | half);
+}
+
+float pokerstove::halfToFloat (uint16_t h)
+{
+  uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+  uint32_t exp  = (h >> 10) & 0x1F;
+  uint32_t mant = h & 0x03FF;
+  uint32_t x;
+
+  if (exp == 0)
+    {
+      if (mant == 0)
+        x = sign;
+      else
+        {
+          int e = 1;
+          while ((mant & 0x0400) == 0)
+            {
+              mant <<= 1;
+              e--;
+            }
+          mant &= 0x03FF;
+          x = sign | (static_cast<uint32_t>(e - 15 + 127) << 23) | (mant << 13);
+        }
+    }
+  else if (exp == 0x1F)
+    x = sign | 0x7F800000 | (mant << 13);
+  else
+    x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+
+  float f;
+  memcpy (&f, &x, sizeof(f));
+  return f;
+}
+
+EquityMatrixWriter::EquityMatrixWriter (ostream& out, const EquityMatrixHeader& header)
+  : _out(out)
+  , _header(header)
+  , _chunk()
+  , _chunkFirstRow(0)
+  , _chunkSize(0)
+  , _rowsWritten(0)
+{
+  if (_header.chunkRows == 0)
+    _header.chunkRows = 1;
+  _chunk.resize (_header.chunkRows * _header.cols.size() * _header.valueSize());
+
+  _out.write (MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+  writeU32 (_out, MATRIX_VERSION);
+  writeU32 (_out, static_cast<uint32_t>(_header.valueFormat));
+  writeU32 (_out, _header.chunkRows);
+  writeString (_out, _header.game);
+  writeString (_out, _header.board);
+  writeString (_out, _header.dead);
+  writeString (_out, _header.rowRange);
+  writeString (_out, _header.colRange);
+  writeU32 (_out, static_cast<uint32_t>(_header.rows.size()));
+  for (size_t i=0; i<_header.rows.size(); i++)
+    writeU64 (_out, _header.rows[i].mask());
+  writeU32 (_out, static_cast<uint32_t>(_header.cols.size()));
+  for (size_t i=0; i<_header.cols.size(); i++)
+    writeU64 (_out, _header.cols[i].mask());
+}
+
+EquityMatrixWriter::~EquityMatrixWriter ()
+{
+  try
+    {
+      flush ();
+    }
+  catch (...)
+    {
+      // never throw from a destructor
+    }
+}
+
+void EquityMatrixWriter::writeRow (const vector<double>& row)
+{
+  const size_t ncols = _header.cols.size();
+  if (row.size() != ncols)
+    throw std::invalid_argument ("EquityMatrixWriter: row has "
+                                 + boost::lexical_cast<string>(row.size())
+                                 + " entries, expected "
+                                 + boost::lexical_cast<string>(ncols));
+  if (_rowsWritten + _chunkSize >= _header.rows.size())
+    throw std::runtime_error ("EquityMatrixWriter: too many rows");
+
+  uint8_t * p = ncols > 0 ? &_chunk[0] + _chunkSize * ncols * _header.valueSize() : NULL;
+  for (size_t j=0; j<ncols; j++)
+    {
+      float f = static_cast<float>(row[j]);
+      if (_header.valueFormat == EquityMatrixHeader::FLOAT16)
+        {
+          uint16_t h = floatToHalf (f);
+          *p++ = static_cast<uint8_t>(h);
+          *p++ = static_cast<uint8_t>(h >> 8);
+        }
+      else
+        {
+          uint32_t x;
+          memcpy (&x, &f, sizeof(x));
+          putU32 (p, x);
+          p += 4;
+        }
+    }
+
+  if (++_chunkSize == _header.chunkRows)
+    flush ();
+}
+
+void EquityMatrixWriter::flush ()
+{
+  if (_chunkSize == 0)
+    return;
+
+  size_t nbytes = _chunkSize * _header.cols.size() * _header.valueSize();
+  writeU32 (_out, static_cast<uint32_t>(_chunkFirstRow));
+  writeU32 (_out, static_cast<uint32_t>(_chunkSize));
+  if (nbytes > 0)
+    _out.write (reinterpret_cast<const char*>(&_chunk[0]), nbytes);
+  writeU32 (_out, checksum (nbytes > 0 ? &_chunk[0] : NULL, nbytes));
+  _out.flush ();
+  if (!_out)
+    throw std::runtime_error ("EquityMatrixWriter: write failed");
+
+  _rowsWritten  += _chunkSize;
+  _chunkFirstRow = _rowsWritten;
+  _chunkSize     = 0;
+}
+
+EquityMatrixReader::EquityMatrixReader (istream& in)
+  : _in(in)
+  , _header()
+  , _chunk()
+  , _chunkRow(0)
+  , _chunkSize(0)
+  , _rowsRead(0)
+{
+  char magic[4];
+  readBytes (_in, magic, sizeof(magic));
+  if (memcmp (magic, MATRIX_MAGIC, sizeof(magic)) != 0)
+    throw std::runtime_error ("EquityMatrixReader: not an equity matrix file");
+  uint32_t version = readU32 (_in);
+  if (version != MATRIX_VERSION)
+    throw std::runtime_error ("EquityMatrixReader: unsupported version "
+                              + boost::lexical_cast<string>(version));
+
+  uint32_t format = readU32 (_in);
+  if (format != EquityMatrixHeader::FLOAT32 && format != EquityMatrixHeader::FLOAT16)
+    throw std::runtime_error ("EquityMatrixReader: unknown value format");
+  _header.valueFormat = static_cast<EquityMatrixHeader::format>(format);
+  _header.chunkRows = readU32 (_in);
+  _header.game      = readString (_in);
+  _header.board     = readString (_in);
+  _header.dead      = readString (_in);
+  _header.rowRange  = readString (_in);
+  _header.colRange  = readString (_in);
+
+  uint32_t nrows = readU32 (_in);
+  _header.rows.resize (nrows);
+  for (uint32_t i=0; i<nrows; i++)
+    _header.rows[i] = CardSet (readU64 (_in));
+  uint32_t ncols = readU32 (_in);
+  _header.cols.resize (ncols);
+  for (uint32_t i=0; i<ncols; i++)
+    _header.cols[i] = CardSet (readU64 (_in));
+}
+
+void EquityMatrixReader::readChunk ()
+{
+  uint32_t first = readU32 (_in);
+  uint32_t nrows = readU32 (_in);
+  if (first != _rowsRead || nrows == 0 || nrows > _header.chunkRows ||
+      first + nrows > _header.rows.size())
+    throw std::runtime_error ("EquityMatrixReader: bad chunk header at row "
+                              + boost::lexical_cast<string>(_rowsRead));
+
+  size_t nbytes = nrows * _header.cols.size() * _header.valueSize();
+  _chunk.resize (nbytes);
+  if (nbytes > 0)
+    readBytes (_in, &_chunk[0], nbytes);
+  if (readU32 (_in) != checksum (nbytes > 0 ? &_chunk[0] : NULL, nbytes))
+    throw std::runtime_error ("EquityMatrixReader: checksum mismatch at row "
+                              + boost::lexical_cast<string>(_rowsRead));
+  _chunkRow  = 0;
+  _chunkSize = nrows;
+}
+
+bool EquityMatrixReader::readRow (vector<float>& row)
+{
+  if (_rowsRead == _header.rows.size())
+    return false;
+  if (_chunkRow == _chunkSize)
+    readChunk ();
+
+  const size_t ncols = _header.cols.size();
+  row.resize (ncols);
+  const uint8_t * p = ncols > 0 ? &_chunk[0] + _chunkRow * ncols * _header.valueSize() : NULL;
+  for (size_t j=0; j<ncols; j++)
+    {
+      if (_header.valueFormat == EquityMatrixHeader::FLOAT16)
+        {
+          row[j] = halfToFloat (static_cast<uint16_t>(p[0] | (p[1] << 8)));
+          p += 2;
+        }
+      else
+        {
+          uint32_t x = getU32 (p);
+          memcpy (&row[j], &x, sizeof(x));
+          p += 4;
+        }
+    }
+
+  _chunkRow++;
+  _rowsRead++;
+  return true;
+}
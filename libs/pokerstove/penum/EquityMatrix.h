@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_EQUITYMATRIX_H_
+#define PENUM_EQUITYMATRIX_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <pokerstove/peval/CardSet.h>
+
+namespace pokerstove
+{
+  /**
+   * Everything needed to interpret a combo x combo equity matrix.
+   * Entry (i,j) is the equity of rows[i] against cols[j].  Pairs of
+   * hands which share cards are stored as NaN.
+   */
+  struct EquityMatrixHeader
+  {
+    enum format { FLOAT32 = 0,
+                  FLOAT16 = 1 };
+
+    std::string game;                  //!< PokerHandEvaluator::alloc id
+    std::string board;
+    std::string dead;
+    std::string rowRange;              //!< CardDistribution descriptors
+    std::string colRange;
+    std::vector<CardSet> rows;         //!< the expanded row hands, in order
+    std::vector<CardSet> cols;         //!< the expanded column hands, in order
+    format   valueFormat;
+    uint32_t chunkRows;                //!< rows per chunk in the file
+
+    EquityMatrixHeader ()
+      : valueFormat(FLOAT32)
+      , chunkRows(64)
+    {}
+
+    size_t valueSize () const { return valueFormat == FLOAT16 ? 2 : 4; }
+  };
+
+  /**
+   * Streaming writer for equity matrices.  Rows are written in order as
+   * they are produced, and at most one chunk of rows is held in memory.
+   *
+   * file layout, all integers little endian:
+   *   "PSEM" version:u32 format:u32 chunkRows:u32
+   *   game board dead rowRange colRange         (u32 length + bytes each)
+   *   nrows:u32 rowmasks:u64[nrows] ncols:u32 colmasks:u64[ncols]
+   *   chunks: firstRow:u32 nrows:u32 values[nrows*ncols] checksum:u32
+   */
+  class EquityMatrixWriter
+  {
+  public:
+    EquityMatrixWriter (std::ostream& out, const EquityMatrixHeader& header);
+    ~EquityMatrixWriter ();
+
+    /**
+     * Append the next row, which must have one entry per column.
+     */
+    void writeRow (const std::vector<double>& row);
+
+    /**
+     * Write out any buffered rows as a (possibly short) chunk.
+     */
+    void flush ();
+
+    size_t rowsWritten () const { return _rowsWritten; }
+
+  private:
+    // non-copyable
+    EquityMatrixWriter (const EquityMatrixWriter&);
+    EquityMatrixWriter& operator=(const EquityMatrixWriter&);
+
+    std::ostream&        _out;
+    EquityMatrixHeader   _header;
+    std::vector<uint8_t> _chunk;
+    size_t               _chunkFirstRow;
+    size_t               _chunkSize;
+    size_t               _rowsWritten;
+  };
+
+  /**
+   * Streaming reader for files produced by EquityMatrixWriter.  Throws
+   * std::runtime_error on malformed or corrupted input.
+   */
+  class EquityMatrixReader
+  {
+  public:
+    explicit EquityMatrixReader (std::istream& in);
+
+    const EquityMatrixHeader& header () const { return _header; }
+
+    /**
+     * Read the next row, returns false once all rows have been read.
+     */
+    bool readRow (std::vector<float>& row);
+
+    size_t rowsRead () const { return _rowsRead; }
+
+  private:
+    void readChunk ();
+
+    std::istream&        _in;
+    EquityMatrixHeader   _header;
+    std::vector<uint8_t> _chunk;
+    size_t               _chunkRow;
+    size_t               _chunkSize;
+    size_t               _rowsRead;
+  };
+
+  /**
+   * IEEE 754 binary16 conversions, round to nearest even.
+   */
+  uint16_t floatToHalf (float f);
+  float    halfToFloat (uint16_t h);
+}
+
+#endif  // PENUM_EQUITYMATRIX_H_
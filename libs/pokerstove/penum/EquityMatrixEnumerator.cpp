@@ -0,0 +1,306 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <pokerstove/util/combinations.h>
+#include <pokerstove/peval/Card.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include "EquityMatrixEnumerator.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t EquityMatrixEnumerator::TABLE_CHUNKS;
+const size_t EquityMatrixEnumerator::ROW_CHUNK;
+
+/**
+ * heads up share of the pot for a single showdown, split the same way
+ * as PokerHandEvaluator::evaluateShowdown
+ */
+static inline double pairShare (const PokerHandEvaluation& hero,
+                                const PokerHandEvaluation& villain)
+{
+  size_t nevals = 1;
+  if (hero.eval(1) > PokerEvaluation(0) || villain.eval(1) > PokerEvaluation(0))
+    nevals = 2;
+
+  double share = 0.0;
+  for (size_t e=0; e<nevals; e++)
+    {
+      if (hero.eval(e) > villain.eval(e))
+        share += 1.0;
+      else if (hero.eval(e) == villain.eval(e))
+        share += 0.5;
+    }
+  return share / nevals;
+}
+
+/**
+ * Everything the row and table chunks share.  The evaluations of the
+ * table are written by one chunk per hand range, and read by all the
+ * row chunks after it is complete.
+ */
+struct MatrixJob
+{
+  const PokerHandEvaluator *          peval;
+  const vector<CardSet> *             runouts;
+  CardSet                             blocked;
+  const CardDistribution *            rows;
+  const CardDistribution *            cols;
+  const vector<CardSet> *             hands;
+  const vector<size_t> *              rowSlot;
+  const vector<size_t> *              colSlot;
+  vector<PokerHandEvaluation> *       table;      //!< empty without a table
+};
+
+static void fillTable (const MatrixJob * job, size_t first, size_t last)
+{
+  const size_t nrunouts = job->runouts->size();
+  for (size_t h=first; h<last; h++)
+    {
+      const CardSet& hand = (*job->hands)[h];
+      if (hand.intersects (job->blocked))
+        continue;
+      for (size_t r=0; r<nrunouts; r++)
+        if (hand.disjoint ((*job->runouts)[r]))
+          (*job->table)[h*nrunouts+r] = job->peval->evaluateHand (hand, (*job->runouts)[r]);
+    }
+}
+
+/**
+ * Rows [first, last) of the matrix, into out, one row after another.
+ */
+static void computeRows (const MatrixJob * job, size_t first, size_t last, double * out)
+{
+  const double NaN = numeric_limits<double>::quiet_NaN();
+  const vector<CardSet>& runouts = *job->runouts;
+  const size_t nrunouts = runouts.size();
+  const size_t ncols = job->cols->size();
+  const bool useTable = !job->table->empty();
+
+  vector<PokerHandEvaluation> heroEvals;
+  vector<PokerHandEvaluation> villainEvals;
+  if (!useTable)
+    {
+      heroEvals.resize (nrunouts);
+      villainEvals.resize (nrunouts);
+    }
+
+  for (size_t i=first; i<last; i++)
+    {
+      double * row = out + (i-first)*ncols;
+      const CardSet& hero = (*job->rows)[i];
+      if (hero.intersects (job->blocked))
+        {
+          std::fill (row, row+ncols, NaN);
+          continue;
+        }
+
+      const PokerHandEvaluation * pHero;
+      if (useTable)
+        pHero = &(*job->table)[(*job->rowSlot)[i]*nrunouts];
+      else
+        {
+          for (size_t r=0; r<nrunouts; r++)
+            if (hero.disjoint (runouts[r]))
+              {
+                PEVAL_COUNT(MATRIX_TABLE_MISS);
+                heroEvals[r] = job->peval->evaluateHand (hero, runouts[r]);
+              }
+          pHero = &heroEvals[0];
+        }
+
+      for (size_t j=0; j<ncols; j++)
+        {
+          const CardSet& villain = (*job->cols)[j];
+          if (villain.intersects (hero) || villain.intersects (job->blocked))
+            {
+              row[j] = NaN;
+              continue;
+            }
+
+          CardSet both = hero | villain;
+          const PokerHandEvaluation * pVillain;
+          if (useTable)
+            pVillain = &(*job->table)[(*job->colSlot)[j]*nrunouts];
+          else
+            {
+              for (size_t r=0; r<nrunouts; r++)
+                if (both.disjoint (runouts[r]))
+                  {
+                    PEVAL_COUNT(MATRIX_TABLE_MISS);
+                    villainEvals[r] = job->peval->evaluateHand (villain, runouts[r]);
+                  }
+              pVillain = &villainEvals[0];
+            }
+
+          double share = 0.0;
+          size_t count = 0;
+          for (size_t r=0; r<nrunouts; r++)
+            {
+              if (both.intersects (runouts[r]))
+                continue;
+              PEVAL_COUNT(BOARDS);
+              if (useTable)
+                PEVAL_COUNT(MATRIX_TABLE_HIT);
+              share += pairShare (pHero[r], pVillain[r]);
+              count++;
+            }
+          row[j] = count > 0 ? share / count : NaN;
+        }
+    }
+}
+
+EquityMatrixEnumerator::EquityMatrixEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                                                const CardSet& board,
+                                                const CardSet& dead)
+  : _peval(peval)
+  , _board(board)
+  , _dead(dead)
+  , _runouts()
+  , _tableLimit(DEFAULT_TABLE_LIMIT)
+  , _pool(&ThreadPool::shared ())
+{
+  size_t bsize = _board.size();
+  size_t missing = _peval->boardSize() > bsize ? _peval->boardSize() - bsize : 0;
+
+  CardSet deck (((ONE64 << CardSet::STANDARD_DECK_SIZE) - 1) & ~(_board | _dead).mask());
+  vector<CardSet> cards = deck.cardSets ();
+  if (missing > cards.size())
+    throw std::invalid_argument ("EquityMatrixEnumerator: not enough cards to complete the board");
+
+  if (missing == 0)
+    {
+      _runouts.push_back (_board);
+      return;
+    }
+
+  combinations combo (cards.size(), missing);
+  do
+    {
+      CardSet runout = _board;
+      for (size_t i=0; i<missing; i++)
+        runout |= cards[combo[i]];
+      _runouts.push_back (runout);
+    }
+  while (combo.next ());
+}
+
+EquityMatrixHeader EquityMatrixEnumerator::header (const string& game,
+                                                   const CardDistribution& rows,
+                                                   const CardDistribution& cols) const
+{
+  EquityMatrixHeader h;
+  h.game     = game;
+  h.board    = _board.str ();
+  h.dead     = _dead.str ();
+  h.rowRange = rows.str ();
+  h.colRange = cols.str ();
+  for (size_t i=0; i<rows.size(); i++)
+    h.rows.push_back (rows[i]);
+  for (size_t j=0; j<cols.size(); j++)
+    h.cols.push_back (cols[j]);
+  return h;
+}
+
+void EquityMatrixEnumerator::memoryFootprint (MemoryFootprint& mem) const
+{
+  mem.add ("caches", "matrix runouts", _runouts.empty() ? NULL : &_runouts[0],
+           _runouts.capacity() * sizeof(CardSet));
+}
+
+void EquityMatrixEnumerator::calculate (const CardDistribution& rows,
+                                        const CardDistribution& cols,
+                                        EquityMatrixWriter& writer) const
+{
+  const size_t nrunouts = _runouts.size();
+  const CardSet blocked = _board | _dead;
+
+  // give every distinct hand one slot, so that a hand which appears
+  // as both a row and a column is only evaluated once per runout
+  map<uint64_t,size_t> slots;
+  vector<CardSet> hands;
+  vector<size_t> rowSlot (rows.size());
+  vector<size_t> colSlot (cols.size());
+  for (size_t i=0; i<rows.size()+cols.size(); i++)
+    {
+      const CardSet& hand = i < rows.size() ? rows[i] : cols[i-rows.size()];
+      map<uint64_t,size_t>::iterator it = slots.find (hand.mask());
+      size_t slot;
+      if (it == slots.end())
+        {
+          slot = hands.size();
+          slots[hand.mask()] = slot;
+          hands.push_back (hand);
+        }
+      else
+        slot = it->second;
+      if (i < rows.size())
+        rowSlot[i] = slot;
+      else
+        colSlot[i-rows.size()] = slot;
+    }
+
+  MatrixJob job;
+  job.peval   = _peval.get ();
+  job.runouts = &_runouts;
+  job.blocked = blocked;
+  job.rows    = &rows;
+  job.cols    = &cols;
+  job.hands   = &hands;
+  job.rowSlot = &rowSlot;
+  job.colSlot = &colSlot;
+
+  // the table is hand major so the inner runout loop is contiguous
+  vector<PokerHandEvaluation> table;
+  job.table = &table;
+  double tableBytes = static_cast<double>(hands.size()) * nrunouts * sizeof(PokerHandEvaluation);
+  bool useTable = tableBytes <= static_cast<double>(_tableLimit) && nrunouts > 0 && !hands.empty();
+  if (useTable)
+    {
+      TraceSpan span ("runout table", "table");
+      table.resize (hands.size() * nrunouts);
+      TaskGroup group (_pool);
+      size_t nchunks = min (hands.size(), TABLE_CHUNKS);
+      for (size_t c=0; c<nchunks; c++)
+        group.run (boost::bind (fillTable, &job,
+                                hands.size() * c / nchunks,
+                                hands.size() * (c+1) / nchunks));
+      group.wait ();
+    }
+
+  // rows are computed a block at a time, the chunks of a block in
+  // parallel, and written in order before the next block starts
+  TraceSpan rowSpan ("rows", "enum");
+  const size_t ncols = cols.size();
+  const size_t block = max<size_t> (1, ROW_CHUNK * (_pool != NULL ? _pool->size() : 1) * 4);
+  vector<double> buffer;
+  vector<double> row (ncols);
+  for (size_t first=0; first<rows.size(); first+=block)
+    {
+      size_t last = min (rows.size(), first+block);
+      buffer.resize ((last-first) * ncols);
+      {
+        TaskGroup group (_pool);
+        for (size_t i=first; i<last; i+=ROW_CHUNK)
+          group.run (boost::bind (computeRows, &job, i, min (last, i+ROW_CHUNK),
+                                  buffer.empty() ? NULL : &buffer[(i-first)*ncols]));
+        group.wait ();
+      }
+      for (size_t i=first; i<last; i++)
+        {
+          if (ncols > 0)
+            std::copy (&buffer[(i-first)*ncols], &buffer[(i-first)*ncols] + ncols, row.begin());
+          writer.writeRow (row);
+        }
+    }
+
+  TraceSpan flushSpan ("flush", "output");
+  writer.flush ();
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_EQUITYMATRIXENUMERATOR_H_
+#define PENUM_EQUITYMATRIXENUMERATOR_H_
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include "CardDistribution.h"
+#include "EquityMatrix.h"
+#include "ThreadPool.h"
+
+namespace pokerstove
+{
+  /**
+   * Computes the heads up equity of every row hand against every
+   * column hand by exhaustive enumeration of the board runouts.  Rows
+   * are handed to the writer as soon as they are complete, so the
+   * full matrix is never held in memory.
+   *
+   * When it fits in the table limit, the evaluation of every hand on
+   * every runout is computed once up front.  Otherwise the column
+   * hands are re-evaluated for each row, which is much slower but
+   * needs no more memory than a single row.
+   *
+   * The table is filled in hand chunks, and the rows are computed in
+   * chunks of ROW_CHUNK rows, on the pool.  Rows are still written in
+   * order, a block of chunks at a time.
+   */
+  class EquityMatrixEnumerator
+  {
+  public:
+    static const size_t DEFAULT_TABLE_LIMIT = 256*1024*1024;
+    static const size_t TABLE_CHUNKS = 256;
+    static const size_t ROW_CHUNK = 4;
+
+    EquityMatrixEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                            const CardSet& board,
+                            const CardSet& dead=CardSet());
+
+    /**
+     * maximum size in bytes of the precomputed runout evaluations
+     */
+    void setTableLimit (size_t bytes) { _tableLimit = bytes; }
+
+    /**
+     * the pool the work is run on, ThreadPool::shared() by default; a
+     * null pool runs everything on the calling thread
+     */
+    void setPool (ThreadPool * pool) { _pool = pool; }
+    ThreadPool * pool () const { return _pool; }
+
+    /**
+     * Fill in the parts of the header which describe the job.
+     */
+    EquityMatrixHeader header (const std::string& game,
+                               const CardDistribution& rows,
+                               const CardDistribution& cols) const;
+
+    /**
+     * Write the rows x cols equity matrix.  The writer must have been
+     * created with a header for the same rows and columns.
+     */
+    void calculate (const CardDistribution& rows,
+                    const CardDistribution& cols,
+                    EquityMatrixWriter& writer) const;
+
+    size_t numRunouts () const { return _runouts.size(); }
+
+    /**
+     * Add the runout list to mem, as a cache.  The runout table of
+     * calculate() only lives for the call, and is at most the table
+     * limit.
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+  private:
+    boost::shared_ptr<PokerHandEvaluator> _peval;
+    CardSet              _board;
+    CardSet              _dead;
+    std::vector<CardSet> _runouts;     //!< every completion of the board
+    size_t               _tableLimit;
+    ThreadPool *         _pool;
+  };
+}
+
+#endif  // PENUM_EQUITYMATRIXENUMERATOR_H_
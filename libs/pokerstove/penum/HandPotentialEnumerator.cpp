@@ -0,0 +1,310 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <pokerstove/util/combinations.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include "HandPotentialEnumerator.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t HandPotentialEnumerator::TABLE_CHUNKS;
+const size_t HandPotentialEnumerator::HERO_CHUNK;
+
+HandPotential::HandPotential ()
+{
+  for (int i=0; i<3; i++)
+    for (int j=0; j<3; j++)
+      counts[i][j] = 0.0;
+}
+
+double HandPotential::total (int now) const
+{
+  return counts[now][AHEAD] + counts[now][TIED] + counts[now][BEHIND];
+}
+
+double HandPotential::strength () const
+{
+  double all = total (AHEAD) + total (TIED) + total (BEHIND);
+  if (all <= 0.0)
+    return 0.0;
+  return (total (AHEAD) + total (TIED)/2) / all;
+}
+
+double HandPotential::ppot () const
+{
+  double d = total (BEHIND) + total (TIED)/2;
+  if (d <= 0.0)
+    return 0.0;
+  return (counts[BEHIND][AHEAD] + counts[BEHIND][TIED]/2 + counts[TIED][AHEAD]/2) / d;
+}
+
+double HandPotential::npot () const
+{
+  double d = total (AHEAD) + total (TIED)/2;
+  if (d <= 0.0)
+    return 0.0;
+  return (counts[AHEAD][BEHIND] + counts[TIED][BEHIND]/2 + counts[AHEAD][TIED]/2) / d;
+}
+
+double HandPotential::ehs () const
+{
+  double hs = strength ();
+  return hs * (1.0 - npot ()) + (1.0 - hs) * ppot ();
+}
+
+/**
+ * outcome of one heads up showdown for the hero, with the pot split
+ * the same way as PokerHandEvaluator::evaluateShowdown
+ */
+static inline int outcome (const PokerHandEvaluation& hero,
+                           const PokerHandEvaluation& villain)
+{
+  size_t nevals = 1;
+  if (hero.eval(1) > PokerEvaluation(0) || villain.eval(1) > PokerEvaluation(0))
+    nevals = 2;
+
+  int halves = 0;
+  for (size_t e=0; e<nevals; e++)
+    {
+      if (hero.eval(e) > villain.eval(e))
+        halves += 2;
+      else if (hero.eval(e) == villain.eval(e))
+        halves += 1;
+    }
+  if (halves > static_cast<int>(nevals))
+    return HandPotential::AHEAD;
+  if (halves < static_cast<int>(nevals))
+    return HandPotential::BEHIND;
+  return HandPotential::TIED;
+}
+
+/**
+ * Everything the table and hero chunks share.  Each hand has a row
+ * of 1+runouts evaluations: on the board as it is, then on each
+ * completion.
+ */
+struct PotentialJob
+{
+  const PokerHandEvaluator *          peval;
+  CardSet                             board;
+  const vector<CardSet> *             runouts;
+  CardSet                             blocked;
+  const CardDistribution *            heroes;
+  const CardDistribution *            opponents;
+  const vector<CardSet> *             hands;
+  const vector<size_t> *              heroSlot;
+  const vector<size_t> *              oppSlot;
+  vector<PokerHandEvaluation> *       table;      //!< empty without a table
+};
+
+/**
+ * the row of evaluations of hand, skipping the runouts it or exclude
+ * conflict with
+ */
+static void evaluateRow (const PotentialJob * job, const CardSet& hand,
+                         const CardSet& exclude, PokerHandEvaluation * row)
+{
+  const vector<CardSet>& runouts = *job->runouts;
+  CardSet both = hand | exclude;
+  row[0] = job->peval->evaluateHand (hand, job->board);
+  for (size_t r=0; r<runouts.size(); r++)
+    if (both.disjoint (runouts[r]))
+      row[r+1] = job->peval->evaluateHand (hand, runouts[r]);
+}
+
+static void fillTable (const PotentialJob * job, size_t first, size_t last)
+{
+  const size_t stride = job->runouts->size() + 1;
+  for (size_t h=first; h<last; h++)
+    {
+      const CardSet& hand = (*job->hands)[h];
+      if (!hand.intersects (job->blocked))
+        evaluateRow (job, hand, CardSet(), &(*job->table)[h*stride]);
+    }
+}
+
+/**
+ * Heroes [first, last), into out.
+ */
+static void computeHeroes (const PotentialJob * job, size_t first, size_t last,
+                           vector<HandPotential> * out)
+{
+  const vector<CardSet>& runouts = *job->runouts;
+  const size_t nrunouts = runouts.size();
+  const size_t stride = nrunouts + 1;
+  const bool useTable = !job->table->empty();
+
+  vector<PokerHandEvaluation> heroEvals;
+  vector<PokerHandEvaluation> villainEvals;
+  if (!useTable)
+    {
+      heroEvals.resize (stride);
+      villainEvals.resize (stride);
+    }
+
+  for (size_t i=first; i<last; i++)
+    {
+      HandPotential& hp = (*out)[i];
+      const CardSet& hero = (*job->heroes)[i];
+      if (hero.intersects (job->blocked))
+        continue;
+
+      const PokerHandEvaluation * pHero;
+      if (useTable)
+        pHero = &(*job->table)[(*job->heroSlot)[i]*stride];
+      else
+        {
+          evaluateRow (job, hero, CardSet(), &heroEvals[0]);
+          pHero = &heroEvals[0];
+        }
+
+      for (size_t j=0; j<job->opponents->size(); j++)
+        {
+          const CardSet& villain = (*job->opponents)[j];
+          double weight = job->opponents->weight (j);
+          if (weight <= 0.0 || villain.intersects (hero) || villain.intersects (job->blocked))
+            continue;
+
+          CardSet both = hero | villain;
+          const PokerHandEvaluation * pVillain;
+          if (useTable)
+            pVillain = &(*job->table)[(*job->oppSlot)[j]*stride];
+          else
+            {
+              evaluateRow (job, villain, hero, &villainEvals[0]);
+              pVillain = &villainEvals[0];
+            }
+
+          // count the completions of each outcome, then weight them once
+          uint64_t later[3] = { 0, 0, 0 };
+          for (size_t r=0; r<nrunouts; r++)
+            {
+              if (both.intersects (runouts[r]))
+                continue;
+              PEVAL_COUNT(BOARDS);
+              later[outcome (pHero[r+1], pVillain[r+1])]++;
+            }
+          int now = outcome (pHero[0], pVillain[0]);
+          for (int k=0; k<3; k++)
+            hp.counts[now][k] += weight * static_cast<double>(later[k]);
+        }
+    }
+}
+
+HandPotentialEnumerator::HandPotentialEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                                                  const CardSet& board,
+                                                  const CardSet& dead)
+  : _peval(peval)
+  , _board(board)
+  , _dead(dead)
+  , _runouts()
+  , _tableLimit(DEFAULT_TABLE_LIMIT)
+  , _pool(&ThreadPool::shared ())
+{
+  if (_peval->boardSize() == 0)
+    throw std::invalid_argument ("HandPotentialEnumerator: the game has no board");
+  size_t bsize = _board.size();
+  if (bsize >= _peval->boardSize())
+    throw std::invalid_argument ("HandPotentialEnumerator: the board is complete");
+  size_t missing = _peval->boardSize() - bsize;
+
+  CardSet deck (((ONE64 << CardSet::STANDARD_DECK_SIZE) - 1) & ~(_board | _dead).mask());
+  vector<CardSet> cards = deck.cardSets ();
+  if (missing > cards.size())
+    throw std::invalid_argument ("HandPotentialEnumerator: not enough cards to complete the board");
+
+  combinations combo (cards.size(), missing);
+  do
+    {
+      CardSet runout = _board;
+      for (size_t i=0; i<missing; i++)
+        runout |= cards[combo[i]];
+      _runouts.push_back (runout);
+    }
+  while (combo.next ());
+}
+
+void HandPotentialEnumerator::memoryFootprint (MemoryFootprint& mem) const
+{
+  mem.add ("caches", "potential runouts", _runouts.empty() ? NULL : &_runouts[0],
+           _runouts.capacity() * sizeof(CardSet));
+}
+
+HandPotential HandPotentialEnumerator::calculate (const CardSet& hero,
+                                                  const CardDistribution& opponents) const
+{
+  return calculate (CardDistribution (hero), opponents)[0];
+}
+
+vector<HandPotential> HandPotentialEnumerator::calculate (const CardDistribution& heroes,
+                                                          const CardDistribution& opponents) const
+{
+  const size_t stride = _runouts.size() + 1;
+
+  // give every distinct hand one slot, so that a hand which is both a
+  // hero and an opponent is only evaluated once
+  map<uint64_t,size_t> slots;
+  vector<CardSet> hands;
+  vector<size_t> heroSlot (heroes.size());
+  vector<size_t> oppSlot (opponents.size());
+  for (size_t i=0; i<heroes.size()+opponents.size(); i++)
+    {
+      const CardSet& hand = i < heroes.size() ? heroes[i] : opponents[i-heroes.size()];
+      map<uint64_t,size_t>::iterator it = slots.find (hand.mask());
+      size_t slot;
+      if (it == slots.end())
+        {
+          slot = hands.size();
+          slots[hand.mask()] = slot;
+          hands.push_back (hand);
+        }
+      else
+        slot = it->second;
+      if (i < heroes.size())
+        heroSlot[i] = slot;
+      else
+        oppSlot[i-heroes.size()] = slot;
+    }
+
+  PotentialJob job;
+  job.peval     = _peval.get ();
+  job.board     = _board;
+  job.runouts   = &_runouts;
+  job.blocked   = _board | _dead;
+  job.heroes    = &heroes;
+  job.opponents = &opponents;
+  job.hands     = &hands;
+  job.heroSlot  = &heroSlot;
+  job.oppSlot   = &oppSlot;
+
+  vector<PokerHandEvaluation> table;
+  job.table = &table;
+  double tableBytes = static_cast<double>(hands.size()) * stride * sizeof(PokerHandEvaluation);
+  if (tableBytes <= static_cast<double>(_tableLimit) && !hands.empty())
+    {
+      TraceSpan span ("potential table", "table");
+      table.resize (hands.size() * stride);
+      TaskGroup group (_pool);
+      size_t nchunks = min (hands.size(), TABLE_CHUNKS);
+      for (size_t c=0; c<nchunks; c++)
+        group.run (boost::bind (fillTable, &job,
+                                hands.size() * c / nchunks,
+                                hands.size() * (c+1) / nchunks));
+      group.wait ();
+    }
+
+  TraceSpan span ("potential", "enum");
+  vector<HandPotential> results (heroes.size());
+  TaskGroup group (_pool);
+  for (size_t i=0; i<heroes.size(); i+=HERO_CHUNK)
+    group.run (boost::bind (computeHeroes, &job, i, min (heroes.size(), i+HERO_CHUNK), &results));
+  group.wait ();
+  return results;
+}
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_HANDPOTENTIALENUMERATOR_H_
+#define PENUM_HANDPOTENTIALENUMERATOR_H_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include "CardDistribution.h"
+#include "ThreadPool.h"
+
+namespace pokerstove
+{
+  /**
+   * Billings style hand potential of a hand against a range.  counts
+   * holds the opponent weighted number of board completions for each
+   * pair of outcomes, now and once the board is complete.  A hand is
+   * ahead when it takes more than half the pot, so a split high/low
+   * pot counts as tied.
+   *
+   * ppot is the chance a hand behind now ends up ahead, and npot the
+   * chance a hand ahead now ends up behind, with ties counted as half
+   * a step either way.
+   */
+  struct HandPotential
+  {
+    enum Outcome { AHEAD = 0, TIED = 1, BEHIND = 2 };
+
+    double counts[3][3];     //!< [now][once the board is complete]
+
+    HandPotential ();
+
+    double total (int now) const;
+
+    double strength () const;       //!< hand strength now
+    double ppot () const;
+    double npot () const;
+
+    /**
+     * effective hand strength, HS (1-NPot) + (1-HS) PPot
+     */
+    double ehs () const;
+  };
+
+  /**
+   * Computes the HandPotential of candidate hands against an opponent
+   * range on a partial board, by enumerating every completion of it.
+   *
+   * The evaluation of every hand on the board as it is and on every
+   * completion is computed once per call, in one table, and each
+   * candidate then only compares evaluations, so the whole set of
+   * candidates at a node should be passed in one call.  When the
+   * table does not fit in the table limit, the hands are re-evaluated
+   * for each candidate instead, which is much slower.  Candidates are
+   * computed in chunks of HERO_CHUNK on the pool.
+   */
+  class HandPotentialEnumerator
+  {
+  public:
+    static const size_t DEFAULT_TABLE_LIMIT = 256*1024*1024;
+    static const size_t TABLE_CHUNKS = 256;
+    static const size_t HERO_CHUNK = 8;
+
+    /**
+     * Throws std::invalid_argument for a game without a board, or a
+     * board which is already complete.
+     */
+    HandPotentialEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                             const CardSet& board,
+                             const CardSet& dead=CardSet());
+
+    /**
+     * maximum size in bytes of the precomputed evaluations
+     */
+    void setTableLimit (size_t bytes) { _tableLimit = bytes; }
+
+    /**
+     * the pool the work is run on, ThreadPool::shared() by default; a
+     * null pool runs everything on the calling thread
+     */
+    void setPool (ThreadPool * pool) { _pool = pool; }
+    ThreadPool * pool () const { return _pool; }
+
+    HandPotential calculate (const CardSet& hero,
+                             const CardDistribution& opponents) const;
+
+    /**
+     * The potential of every hand of heroes, in order; their weights
+     * are ignored.  A hand which conflicts with the board or dead
+     * cards has all zero counts.
+     */
+    std::vector<HandPotential> calculate (const CardDistribution& heroes,
+                                          const CardDistribution& opponents) const;
+
+    size_t numRunouts () const { return _runouts.size(); }
+
+    /**
+     * add the runout list to mem, as a cache
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+  private:
+    boost::shared_ptr<PokerHandEvaluator> _peval;
+    CardSet              _board;
+    CardSet              _dead;
+    std::vector<CardSet> _runouts;     //!< every completion of the board
+    size_t               _tableLimit;
+    ThreadPool *         _pool;
+  };
+}
+
+#endif  // PENUM_HANDPOTENTIALENUMERATOR_H_
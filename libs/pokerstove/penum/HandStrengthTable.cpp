@@ -0,0 +1,410 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <pokerstove/util/combinations.h>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/PokerEvaluation.h>
+#include "HandStrengthTable.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+namespace io = boost::iostreams;
+
+namespace
+{
+  const char     TABLE_MAGIC[4] = { 'P', 'S', 'H', 'S' };
+  const uint32_t TABLE_VERSION  = 1;
+  const size_t   HEADER_SIZE    = 128;
+  const size_t   DECK_SIZE      = CardSet::STANDARD_DECK_SIZE;
+
+  // number of opponent hands once the hero and a full board are dealt
+  const double   NUM_OPPONENTS  = (DECK_SIZE-7) * (DECK_SIZE-8) / 2;
+
+  // each street is split into this many chunks of contiguous work
+  const uint64_t NUM_CHUNKS     = 512;
+
+  void putU32 (uint8_t * p, uint32_t v)
+  {
+    for (int i=0; i<4; i++)
+      p[i] = static_cast<uint8_t>(v >> (8*i));
+  }
+
+  uint32_t getU32 (const uint8_t * p)
+  {
+    uint32_t v = 0;
+    for (int i=0; i<4; i++)
+      v |= static_cast<uint32_t>(p[i]) << (8*i);
+    return v;
+  }
+
+  void putU64 (uint8_t * p, uint64_t v)
+  {
+    putU32 (p, static_cast<uint32_t>(v));
+    putU32 (p+4, static_cast<uint32_t>(v >> 32));
+  }
+
+  uint64_t getU64 (const uint8_t * p)
+  {
+    return static_cast<uint64_t>(getU32 (p)) | (static_cast<uint64_t>(getU32 (p+4)) << 32);
+  }
+
+  // byte offset of each street, each one starts on a cache line
+  void layout (const HoldemHandIndexer& indexer, uint64_t offsets[], uint64_t& total)
+  {
+    uint64_t off = HEADER_SIZE;
+    for (size_t s=0; s<NUM_HOLDEM_ROUNDS; s++)
+      {
+        offsets[s] = off;
+        off += indexer.size (s) * sizeof(HandStrength);
+        off = (off + 63) & ~static_cast<uint64_t>(63);
+      }
+    total = off;
+  }
+
+  /**
+   * River strengths of every hand on boards [begin, end).  The hands
+   * on a board are ranked once, and the win and tie counts of each
+   * hand are corrected for card removal with per card counts of the
+   * hands below and at its rank.
+   */
+  void riverChunk (const HoldemHandIndexer * indexer,
+                   const vector<CardSet> * boards,
+                   size_t begin, size_t end,
+                   HandStrength * river)
+  {
+    TraceSpan span ("river", "generate");
+    if (span.active ())
+      span.setDetail ((boost::format("boards %d-%d") % begin % end).str());
+    vector<pair<int,int> > ranked;   // (eval code, hand number)
+    vector<int> cardA;
+    vector<int> cardB;
+    for (size_t b=begin; b<end; b++)
+      {
+        const CardSet& board = (*boards)[b];
+        vector<int> deck;
+        for (size_t c=0; c<DECK_SIZE; c++)
+          if (!(board.mask() & (ONE64 << c)))
+            deck.push_back (static_cast<int>(c));
+
+        ranked.clear ();
+        cardA.clear ();
+        cardB.clear ();
+        for (size_t i=0; i<deck.size(); i++)
+          for (size_t j=i+1; j<deck.size(); j++)
+            {
+              CardSet hand (board.mask() | (ONE64 << deck[i]) | (ONE64 << deck[j]));
+              ranked.push_back (make_pair (hand.evaluateHigh().code(),
+                                           static_cast<int>(cardA.size())));
+              cardA.push_back (deck[i]);
+              cardB.push_back (deck[j]);
+            }
+        sort (ranked.begin(), ranked.end());
+
+        int below = 0;
+        int belowCard[DECK_SIZE] = { 0 };
+        int groupCard[DECK_SIZE] = { 0 };
+        for (size_t g=0; g<ranked.size(); )
+          {
+            size_t e = g;
+            while (e < ranked.size() && ranked[e].first == ranked[g].first)
+              {
+                int h = ranked[e].second;
+                groupCard[cardA[h]]++;
+                groupCard[cardB[h]]++;
+                e++;
+              }
+
+            int groupSize = static_cast<int>(e - g);
+            for (size_t k=g; k<e; k++)
+              {
+                int h = ranked[k].second;
+                int a = cardA[h];
+                int c = cardB[h];
+                int win = below - belowCard[a] - belowCard[c];
+                int tie = groupSize - (groupCard[a] + groupCard[c] - 1);
+                float hs = static_cast<float>((win + 0.5*tie) / NUM_OPPONENTS);
+
+                CardSet hole ((ONE64 << a) | (ONE64 << c));
+                HandStrength& out = river[indexer->index (hole, board)];
+                out.ehs  = hs;
+                out.ehs2 = hs*hs;
+              }
+
+            for (size_t k=g; k<e; k++)
+              {
+                int h = ranked[k].second;
+                belowCard[cardA[h]]++;
+                belowCard[cardB[h]]++;
+                groupCard[cardA[h]] = 0;
+                groupCard[cardB[h]] = 0;
+              }
+            below += groupSize;
+            g = e;
+          }
+      }
+  }
+
+  /**
+   * Average the next street over the cards which can come, for the
+   * indices [begin, end).  Preflop deals the whole flop.
+   */
+  void averageChunk (const HoldemHandIndexer * indexer, size_t street,
+                     uint64_t begin, uint64_t end,
+                     const HandStrength * next, HandStrength * out)
+  {
+    TraceSpan span ("average", "generate");
+    if (span.active ())
+      span.setDetail ((boost::format("street %d index %d-%d") % street % begin % end).str());
+    size_t ncards = street == PREFLOP ? NUM_FLOP_CARDS : 1;
+    for (uint64_t idx=begin; idx<end; idx++)
+      {
+        CardSet hole, board;
+        indexer->unindex (street, idx, hole, board);
+        CardSet deck (((ONE64 << DECK_SIZE) - 1) & ~(hole | board).mask());
+        vector<CardSet> cards = deck.cardSets ();
+
+        double ehs = 0.0;
+        double ehs2 = 0.0;
+        size_t count = 0;
+        combinations combo (cards.size(), ncards);
+        do
+          {
+            CardSet nboard (board);
+            for (size_t i=0; i<ncards; i++)
+              nboard |= cards[combo[i]];
+            const HandStrength& hs = next[indexer->index (hole, nboard)];
+            ehs  += hs.ehs;
+            ehs2 += hs.ehs2;
+            count++;
+          }
+        while (combo.next ());
+
+        out[idx].ehs  = static_cast<float>(ehs / count);
+        out[idx].ehs2 = static_cast<float>(ehs2 / count);
+      }
+  }
+}
+
+HandStrengthTable::HandStrengthTable ()
+  : _file()
+  , _filename()
+  , _loadFaults()
+  , _indexer()
+{
+  std::fill (_streets, _streets+NUM_HOLDEM_ROUNDS, static_cast<const HandStrength*>(NULL));
+}
+
+HandStrengthTable::HandStrengthTable (const string& filename)
+  : _file()
+  , _filename()
+  , _loadFaults()
+  , _indexer()
+{
+  std::fill (_streets, _streets+NUM_HOLDEM_ROUNDS, static_cast<const HandStrength*>(NULL));
+  open (filename);
+}
+
+void HandStrengthTable::open (const string& filename)
+{
+  // only maps the file, the pages fault in on lookup
+  TraceSpan span ("load", "table", filename);
+  close ();
+  PageFaults before = MemoryFootprint::pageFaults ();
+  _file.open (filename);
+  _filename = filename;
+  const uint8_t * p = reinterpret_cast<const uint8_t*>(_file.data());
+  if (_file.size() < HEADER_SIZE || memcmp (p, TABLE_MAGIC, 4) != 0)
+    {
+      close ();
+      throw std::runtime_error ("HandStrengthTable: not a hand strength table: " + filename);
+    }
+  if (getU32 (p+4) != TABLE_VERSION || getU32 (p+8) != sizeof(HandStrength))
+    {
+      close ();
+      throw std::runtime_error ("HandStrengthTable: unsupported table version: " + filename);
+    }
+
+  for (size_t s=0; s<NUM_HOLDEM_ROUNDS; s++)
+    {
+      uint64_t count  = getU64 (p + 16 + 8*s);
+      uint64_t offset = getU64 (p + 48 + 8*s);
+      if (count != _indexer.size (s) || offset + count*sizeof(HandStrength) > _file.size())
+        {
+          close ();
+          throw std::runtime_error ("HandStrengthTable: truncated or mismatched table: " + filename);
+        }
+      _streets[s] = reinterpret_cast<const HandStrength*>(p + offset);
+    }
+  _loadFaults = MemoryFootprint::pageFaults () - before;
+}
+
+void HandStrengthTable::preload ()
+{
+  if (!_file.is_open())
+    return;
+  TraceSpan span ("preload", "table", _filename);
+  PageFaults before = MemoryFootprint::pageFaults ();
+  const volatile char * p = _file.data();
+  const size_t page = io::mapped_file_source::alignment ();
+  char sum = 0;
+  for (size_t i=0; i<_file.size(); i+=page)
+    sum ^= p[i];
+  (void) sum;
+  PageFaults faults = MemoryFootprint::pageFaults () - before;
+  _loadFaults.minor += faults.minor;
+  _loadFaults.major += faults.major;
+}
+
+void HandStrengthTable::memoryFootprint (MemoryFootprint& mem) const
+{
+  if (_file.is_open())
+    mem.add ("files", _filename, _file.data(), _file.size(), _loadFaults);
+}
+
+void HandStrengthTable::histogram (size_t street, uint64_t idx, size_t bins, float * out) const
+{
+  CardSet hole, board;
+  _indexer.unindex (street, idx, hole, board);
+  CardSet deck (((ONE64 << DECK_SIZE) - 1) & ~(hole | board).mask());
+  vector<CardSet> cards = deck.cardSets ();
+  size_t ncards = NUM_RIVER_CARDS - board.size();
+
+  std::fill (out, out+bins, 0.0f);
+  size_t count = 0;
+  combinations combo (cards.size(), max<size_t> (ncards, 1));
+  do
+    {
+      CardSet nboard (board);
+      for (size_t i=0; i<ncards; i++)
+        nboard |= cards[combo[i]];
+      float hs = lookup (RIVER, _indexer.index (hole, nboard)).ehs;
+      size_t bin = min (bins-1, static_cast<size_t>(hs * bins));
+      out[bin] += 1.0f;
+      count++;
+    }
+  while (ncards > 0 && combo.next ());
+
+  for (size_t b=0; b<bins; b++)
+    out[b] /= count;
+}
+
+/**
+ * histograms [begin, end) of a street, out points at the first
+ */
+static void histogramChunk (const HandStrengthTable * table, size_t street,
+                            uint64_t begin, uint64_t end, size_t bins, float * out)
+{
+  TraceSpan span ("histograms", "cluster");
+  if (span.active ())
+    span.setDetail ((boost::format("street %d index %d-%d") % street % begin % end).str());
+  for (uint64_t idx=begin; idx<end; idx++)
+    table->histogram (street, idx, bins, out + (idx-begin)*bins);
+}
+
+void HandStrengthTable::histograms (size_t street, uint64_t first, uint64_t last, size_t bins,
+                                    float * out, ThreadPool * pool) const
+{
+  if (!isOpen () || bins == 0 || last > _indexer.size (street) || first > last)
+    throw std::invalid_argument ("HandStrengthTable: bad histogram request");
+  TaskGroup group (pool);
+  uint64_t n = last - first;
+  uint64_t nchunks = min<uint64_t> (n, NUM_CHUNKS);
+  for (uint64_t c=0; c<nchunks; c++)
+    {
+      uint64_t b = first + n * c / nchunks;
+      uint64_t e = first + n * (c+1) / nchunks;
+      group.run (boost::bind (histogramChunk, this, street, b, e, bins, out + (b-first)*bins));
+    }
+  group.wait ();
+}
+
+void HandStrengthTable::close ()
+{
+  if (_file.is_open())
+    _file.close ();
+  _filename.clear ();
+  _loadFaults = PageFaults ();
+  std::fill (_streets, _streets+NUM_HOLDEM_ROUNDS, static_cast<const HandStrength*>(NULL));
+}
+
+void HandStrengthTable::generate (const string& filename, ThreadPool * pool)
+{
+  HoldemHandIndexer indexer;
+  uint64_t offsets[NUM_HOLDEM_ROUNDS];
+  uint64_t total;
+  layout (indexer, offsets, total);
+
+  io::mapped_file_params params (filename);
+  params.flags         = io::mapped_file::readwrite;
+  params.new_file_size = static_cast<io::stream_offset>(total);
+  io::mapped_file file (params);
+
+  uint8_t * p = reinterpret_cast<uint8_t*>(file.data());
+  memset (p, 0, HEADER_SIZE);
+  memcpy (p, TABLE_MAGIC, 4);
+  putU32 (p+4, TABLE_VERSION);
+  putU32 (p+8, sizeof(HandStrength));
+  putU32 (p+12, NUM_HOLDEM_ROUNDS);
+  HandStrength * streets[NUM_HOLDEM_ROUNDS];
+  for (size_t s=0; s<NUM_HOLDEM_ROUNDS; s++)
+    {
+      putU64 (p + 16 + 8*s, indexer.size (s));
+      putU64 (p + 48 + 8*s, offsets[s]);
+      streets[s] = reinterpret_cast<HandStrength*>(p + offsets[s]);
+    }
+
+  // the river only needs one board from each suit isomorphism class,
+  // the hole cards on it cover the rest of the states
+  vector<CardSet> boards;
+  {
+    vector<CardSet> cards = CardSet (((ONE64 << DECK_SIZE) - 1)).cardSets ();
+    combinations combo (cards.size(), NUM_RIVER_CARDS);
+    do
+      {
+        CardSet board;
+        for (size_t i=0; i<NUM_RIVER_CARDS; i++)
+          board |= cards[combo[i]];
+        if (board.canonize () == board)
+          boards.push_back (board);
+      }
+    while (combo.next ());
+  }
+
+  // every chunk writes its own entries, so the table does not depend
+  // on how the chunks are spread over the pool
+  {
+    TaskGroup group (pool);
+    size_t nchunks = min<size_t> (boards.size(), NUM_CHUNKS);
+    for (size_t c=0; c<nchunks; c++)
+      group.run (boost::bind (riverChunk, &indexer, &boards,
+                              boards.size() * c / nchunks,
+                              boards.size() * (c+1) / nchunks,
+                              streets[RIVER]));
+    group.wait ();
+  }
+
+  for (size_t street=TURN+1; street-- > PREFLOP; )
+    {
+      const HandStrength * next = streets[street+1];
+      uint64_t size = indexer.size (street);
+      uint64_t nchunks = min (size, NUM_CHUNKS);
+      TaskGroup group (pool);
+      for (uint64_t c=0; c<nchunks; c++)
+        group.run (boost::bind (averageChunk, &indexer, street,
+                                size * c / nchunks, size * (c+1) / nchunks,
+                                next, streets[street]));
+      group.wait ();
+    }
+
+  TraceSpan span ("write", "output", filename);
+  file.close ();
+}
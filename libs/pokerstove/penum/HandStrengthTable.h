@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_HANDSTRENGTHTABLE_H_
+#define PENUM_HANDSTRENGTHTABLE_H_
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/Holdem.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include "HoldemHandIndexer.h"
+#include "ThreadPool.h"
+
+namespace pokerstove
+{
+  /**
+   * Expected hand strength of a hold'em state against a single
+   * uniformly random opponent hand.  ehs is the mean and ehs2 the mean
+   * square of the river hand strength, taken over all board
+   * completions.  On the river they are HS and HS^2.
+   */
+  struct HandStrength
+  {
+    float ehs;
+    float ehs2;
+  };
+
+  /**
+   * Precomputed HandStrength for every suit isomorphic hold'em state,
+   * stored in a file which is memory mapped, so a lookup costs one
+   * HoldemHandIndexer::index call and one read.
+   *
+   * The file starts with a 128 byte header (the magic "PSHS", version,
+   * and the count and byte offset of each street), followed by the
+   * HandStrength values of each street in index order.  Header fields
+   * are little endian, the values are in host order.  The full table
+   * is about 1.1GB.
+   */
+  class HandStrengthTable
+  {
+  public:
+    HandStrengthTable ();
+    explicit HandStrengthTable (const std::string& filename);
+
+    void open (const std::string& filename);
+    void close ();
+    bool isOpen () const { return _file.is_open(); }
+
+    /**
+     * Strength of the hole cards with a 0, 3, 4, or 5 card board.
+     */
+    const HandStrength& lookup (const CardSet& hole, const CardSet& board) const
+    {
+      PEVAL_COUNT(STRENGTH_LOOKUP);
+      return _streets[HoldemHandIndexer::street (board)][_indexer.index (hole, board)];
+    }
+
+    const HandStrength& lookup (size_t street, uint64_t idx) const
+    {
+      return _streets[street][idx];
+    }
+
+    const HoldemHandIndexer& indexer () const { return _indexer; }
+
+    /**
+     * Histogram of the river strength of state idx of a street over
+     * every completion of its board, in bins equal bins of [0,1],
+     * normalized to sum to 1.  On the river it is the single value.
+     */
+    void histogram (size_t street, uint64_t idx, size_t bins, float * out) const;
+
+    /**
+     * The histograms of states [first, last) of a street, one after
+     * another in out, computed in chunks on pool.
+     */
+    void histograms (size_t street, uint64_t first, uint64_t last, size_t bins, float * out,
+                     ThreadPool * pool = &ThreadPool::shared ()) const;
+
+    /**
+     * Touch every page of the table, so that lookups never fault.
+     * The faults taken are added to the load faults.
+     */
+    void preload ();
+
+    /**
+     * page faults taken while opening and preloading the table
+     */
+    const PageFaults& loadFaults () const { return _loadFaults; }
+
+    /**
+     * add the mapped file to mem, with its load faults
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+    /**
+     * Compute every street and write the table to filename.  River
+     * strengths are computed once per suit isomorphic board by
+     * ranking all hands on the board, then each earlier street is the
+     * average of the street after it.  The work of each street is
+     * split into chunks run on pool, or on the calling thread if pool
+     * is null.
+     */
+    static void generate (const std::string& filename,
+                          ThreadPool * pool = &ThreadPool::shared ());
+
+  private:
+    boost::iostreams::mapped_file_source _file;
+    std::string                          _filename;
+    PageFaults                           _loadFaults;
+    const HandStrength *                 _streets[NUM_HOLDEM_ROUNDS];
+    HoldemHandIndexer                    _indexer;
+  };
+}
+
+#endif  // PENUM_HANDSTRENGTHTABLE_H_
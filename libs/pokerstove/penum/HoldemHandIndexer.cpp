@@ -0,0 +1,602 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <functional>
+#include <set>
+#include <stdexcept>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/Suit.h>
+#include "HoldemHandIndexer.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t HoldemHandIndexer::MAX_ROUNDS;
+
+namespace
+{
+  const int BOARD_CARDS[NUM_HOLDEM_ROUNDS] = { 0, NUM_FLOP_CARDS, NUM_TURN_CARDS, NUM_RIVER_CARDS };
+  const int STREET_CARDS[HoldemHandIndexer::MAX_ROUNDS] = { NUM_HOLDEM_POCKET, NUM_FLOP_CARDS, 1, 1 };
+  const int NUM_RANK = Rank::NUM_RANK;
+  const int NUM_SUIT = Suit::NUM_SUIT;
+
+  // small binomials, the multiplications stay well inside 64 bits for
+  // the sizes seen in hold'em
+  uint64_t nCr (uint64_t n, uint64_t k)
+  {
+    if (k > n)
+      return 0;
+    uint64_t ret = 1;
+    for (uint64_t i=0; i<k; i++)
+      ret = ret * (n - i) / (i + 1);
+    return ret;
+  }
+
+  /**
+   * nCr for the k of at most a suit per group, with constant divisors.
+   * When n < k one of the factors is zero.
+   */
+  inline uint64_t choose (uint64_t n, uint64_t k)
+  {
+    switch (k)
+      {
+      case 0: return 1;
+      case 1: return n;
+      case 2: return n*(n-1)/2;
+      case 3: return n*(n-1)*(n-2)/6;
+      case 4: return n*(n-1)*(n-2)*(n-3)/24;
+      default: return nCr (n, k);
+      }
+  }
+
+  const int HALF_RANK = 7;   //!< ranks in the low half of a suit
+
+  /**
+   * per rank set lookups: the colex number of a set among the sets of
+   * its size (their numeric order), and its size.  squeezeLow and
+   * squeezeHigh take the free ranks and a set of them in each half of
+   * the suit, and pack the set into the low bits, one bit per free
+   * rank, so squeezing the used ranks out of a round is two lookups.
+   */
+  struct RankTables
+  {
+    uint16_t colex[1 << NUM_RANK];
+    uint8_t  bits[1 << NUM_RANK];
+    uint64_t binomial[NUM_RANK+1][NUM_RANK+1];
+    uint8_t  squeezeLow[1 << HALF_RANK][1 << HALF_RANK];
+    uint8_t  squeezeHigh[1 << (NUM_RANK-HALF_RANK)][1 << (NUM_RANK-HALF_RANK)];
+
+    RankTables ()
+    {
+      uint16_t next[NUM_RANK+1] = { 0 };
+      for (int m=0; m<(1 << NUM_RANK); m++)
+        {
+          int c = 0;
+          for (int v=m; v; c++)
+            v &= v - 1;
+          bits[m] = static_cast<uint8_t>(c);
+          colex[m] = next[c]++;
+        }
+      for (int n=0; n<=NUM_RANK; n++)
+        for (int k=0; k<=NUM_RANK; k++)
+          binomial[n][k] = nCr (n, k);
+      for (int f=0; f<(1 << HALF_RANK); f++)
+        for (int m=0; m<(1 << HALF_RANK); m++)
+          squeezeLow[f][m] = squeeze (m, f);
+      for (int f=0; f<(1 << (NUM_RANK-HALF_RANK)); f++)
+        for (int m=0; m<(1 << (NUM_RANK-HALF_RANK)); m++)
+          squeezeHigh[f][m] = squeeze (m, f);
+    }
+
+    static uint8_t squeeze (int m, int free)
+    {
+      int ret = 0;
+      for (int r=0, pos=0; free >> r; r++)
+        if (free & (1 << r))
+          {
+            if (m & (1 << r))
+              ret |= 1 << pos;
+            pos++;
+          }
+      return static_cast<uint8_t>(ret);
+    }
+  };
+
+  const RankTables RANKS;
+
+  inline int suitMask (const CardSet& cards, int s)
+  {
+    return static_cast<int>((cards.mask() >> (NUM_RANK*s)) & ((1 << NUM_RANK) - 1));
+  }
+
+  inline int bitcount (int v)
+  {
+    return RANKS.bits[v];
+  }
+
+  /**
+   * colex number of m among the ranks the suit has not used, m being
+   * a subset of them
+   */
+  inline uint64_t subsetIndex (int m, int used)
+  {
+    const int LOW = (1 << HALF_RANK) - 1;
+    int free = ~used & ((1 << NUM_RANK) - 1);
+    int packed = RANKS.squeezeLow[free & LOW][m & LOW]
+      | (RANKS.squeezeHigh[free >> HALF_RANK][m >> HALF_RANK] << bitcount (free & LOW));
+    return RANKS.colex[packed];
+  }
+
+  /**
+   * subsetIndex of an empty set or a single card, the number of free
+   * ranks below the card
+   */
+  inline uint64_t cardIndex (int m, int used)
+  {
+    return bitcount ((m - 1) & ~used & -(m != 0));
+  }
+
+  /**
+   * the street of a board of ncards, -1 if there is none
+   */
+  inline int boardStreet (int ncards)
+  {
+    static const int STREET_BY_SIZE[NUM_RIVER_CARDS+1] = { PREFLOP, -1, -1, FLOP, TURN, RIVER };
+    return ncards >= 0 && ncards <= static_cast<int>(NUM_RIVER_CARDS) ? STREET_BY_SIZE[ncards] : -1;
+  }
+
+  // the count of cards a suit gets in round r, 4 bits per round with
+  // the hole cards in the high nibble
+  int shapeCount (int shape, size_t r, size_t nrounds)
+  {
+    return (shape >> (4*(nrounds-1-r))) & 0xF;
+  }
+
+  // number of distinct rank sequences a suit with this shape can have
+  uint64_t suitSize (int shape, size_t nrounds)
+  {
+    uint64_t size = 1;
+    int used = 0;
+    for (size_t r=0; r<nrounds; r++)
+      {
+        int c = shapeCount (shape, r, nrounds);
+        size *= nCr (NUM_RANK - used, c);
+        used += c;
+      }
+    return size;
+  }
+
+  uint64_t configKey (const int shapes[])
+  {
+    uint64_t key = 0;
+    for (int s=0; s<NUM_SUIT; s++)
+      key = (key << 16) | static_cast<uint64_t>(shapes[s]);
+    return key;
+  }
+
+  // number of hands in a configuration, the product over groups of
+  // equal shapes of the number of multisets of suit indices
+  uint64_t configSize (const int shapes[], size_t nrounds)
+  {
+    uint64_t size = 1;
+    for (int i=0; i<NUM_SUIT; )
+      {
+        int j = i;
+        while (j < NUM_SUIT && shapes[j] == shapes[i])
+          j++;
+        uint64_t k = j - i;
+        size *= nCr (suitSize (shapes[i], nrounds) + k - 1, k);
+        i = j;
+      }
+    return size;
+  }
+
+  // enumerate every way of dealing the cards of each round to the suits
+  void dealShapes (const int cards[], size_t nrounds, size_t r, int counts[][HoldemHandIndexer::MAX_ROUNDS],
+                   int suit, int remaining, set<uint64_t>& keys)
+  {
+    if (suit == NUM_SUIT-1)
+      {
+        counts[suit][r] = remaining;
+        if (r+1 < nrounds)
+          {
+            dealShapes (cards, nrounds, r+1, counts, 0, cards[r+1], keys);
+            return;
+          }
+
+        int shapes[NUM_SUIT];
+        for (int s=0; s<NUM_SUIT; s++)
+          {
+            int total = 0;
+            shapes[s] = 0;
+            for (size_t q=0; q<nrounds; q++)
+              {
+                total += counts[s][q];
+                shapes[s] |= counts[s][q] << (4*(nrounds-1-q));
+              }
+            if (total > NUM_RANK)
+              return;
+          }
+        sort (shapes, shapes+NUM_SUIT, greater<int>());
+        keys.insert (configKey (shapes));
+        return;
+      }
+
+    for (int c=0; c<=remaining; c++)
+      {
+        counts[suit][r] = c;
+        dealShapes (cards, nrounds, r, counts, suit+1, remaining-c, keys);
+      }
+  }
+
+  /**
+   * a suit's shape number, in mixed radix over the rounds, which
+   * orders the shapes as their nibbles do
+   */
+  int shapeNumber (int shape, const int cards[], size_t nrounds)
+  {
+    int id = 0;
+    for (size_t r=0; r<nrounds; r++)
+      id = id * (cards[r] + 1) + shapeCount (shape, r, nrounds);
+    return id;
+  }
+
+  /**
+   * dense number of the multiset of four shape numbers, sorted in
+   * decreasing order
+   */
+  inline uint64_t shapesRank (const int ids[])
+  {
+    return choose (ids[0] + 3, 4) + choose (ids[1] + 2, 3) + choose (ids[2] + 1, 2) + ids[3];
+  }
+
+  // a suit's shape number in the high word, its index in the low
+  const int SHAPE_SHIFT = 32;
+  const uint64_t INDEX_MASK = 0xFFFFFFFFuLL;
+
+  /**
+   * choose (n, k) for the k of at most a suit per group.  Groups of
+   * more than two suits are rare, so only they take a branch.
+   */
+  inline uint64_t multisetTerm (uint64_t n, int k)
+  {
+    if (k > 2)
+      return choose (n, k);
+    uint64_t pairs = n * (n-1) / 2;
+    return k == 2 ? pairs : n;
+  }
+
+  // without a branch, which the random order of the suits would
+  // mispredict
+  inline void sortPair (uint64_t& a, uint64_t& b)
+  {
+    uint64_t swap = (a ^ b) & (static_cast<uint64_t>(0) - (a < b));
+    a ^= swap;
+    b ^= swap;
+  }
+}
+
+HoldemHandIndexer::HoldemHandIndexer (Layout layout)
+  : _layout(layout)
+  , _rounds(layout == BOARD ? 2 : MAX_ROUNDS)
+{
+  for (size_t street=0; street<NUM_HOLDEM_ROUNDS; street++)
+    {
+      for (size_t r=0; r<MAX_ROUNDS; r++)
+        if (r == 0)
+          _cards[street][r] = NUM_HOLDEM_POCKET;
+        else if (_layout == BOARD)
+          _cards[street][r] = r == 1 ? BOARD_CARDS[street] : 0;
+        else
+          _cards[street][r] = r <= street ? STREET_CARDS[r] : 0;
+      buildConfigurations (street);
+    }
+}
+
+void HoldemHandIndexer::buildConfigurations (size_t street)
+{
+  const int * cards = _cards[street];
+  set<uint64_t> keys;
+  int counts[NUM_SUIT][MAX_ROUNDS];
+  dealShapes (cards, _rounds, 0, counts, 0, cards[0], keys);
+
+  _numShapes[street] = 1;
+  for (size_t r=0; r<_rounds; r++)
+    _numShapes[street] *= cards[r] + 1;
+  _shapeSize[street].assign (_numShapes[street], 0);
+  for (int id=0; id<static_cast<int>(_numShapes[street]); id++)
+    {
+      int shape = 0;
+      for (int r=static_cast<int>(_rounds)-1, rest=id; r>=0; r--)
+        {
+          shape |= (rest % (cards[r] + 1)) << (4*(_rounds-1-r));
+          rest /= cards[r] + 1;
+        }
+      _shapeSize[street][id] = suitSize (shape, _rounds);
+    }
+  _configByShapes[street].assign (choose (_numShapes[street] + 3, 4), -1);
+
+  uint64_t offset = 0;
+  for (set<uint64_t>::const_iterator it=keys.begin(); it!=keys.end(); ++it)
+    {
+      int shapes[NUM_SUIT];
+      int ids[NUM_SUIT];
+      for (int s=0; s<NUM_SUIT; s++)
+        {
+          shapes[s] = static_cast<int>((*it >> (16*(NUM_SUIT-1-s))) & 0xFFFF);
+          ids[s] = shapeNumber (shapes[s], cards, _rounds);
+        }
+
+      Configuration config;
+      config.key    = *it;
+      config.offset = offset;
+      config.size   = configSize (shapes, _rounds);
+      uint64_t mult = 1;
+      for (int i=0; i<NUM_SUIT; )
+        {
+          int j = i+1;
+          while (j < NUM_SUIT && ids[j] == ids[i])
+            j++;
+          int k = j - i;
+          for (int t=0; t<k; t++)
+            {
+              config.mult[i+t]  = mult;
+              config.shift[i+t] = static_cast<uint8_t>(k - 1 - t);
+              config.take[i+t]  = static_cast<uint8_t>(k - t);
+            }
+          mult *= choose (_shapeSize[street][ids[i]] + k - 1, k);
+          i = j;
+        }
+      _configByShapes[street][shapesRank (ids)] = static_cast<int32_t>(_configs[street].size());
+      _configs[street].push_back (config);
+      offset += config.size;
+    }
+  _sizes[street] = offset;
+}
+
+size_t HoldemHandIndexer::street (const CardSet& board)
+{
+  int street = boardStreet (static_cast<int>(board.size ()));
+  if (street < 0)
+    throw std::invalid_argument ("HoldemHandIndexer: wrong number of board cards");
+  return street;
+}
+
+uint64_t HoldemHandIndexer::index (const CardSet& hole, const CardSet& board) const
+{
+  // the card counts come from the rank set lookups, rather than a
+  // popcount of each set
+  int masks[NUM_SUIT][MAX_ROUNDS];
+  int nhole = 0;
+  int nboard = 0;
+  for (int s=0; s<NUM_SUIT; s++)
+    {
+      masks[s][0] = suitMask (hole, s);
+      masks[s][1] = suitMask (board, s);
+      masks[s][2] = 0;
+      masks[s][3] = 0;
+      nhole  += bitcount (masks[s][0]);
+      nboard += bitcount (masks[s][1]);
+    }
+  if (nhole != NUM_HOLDEM_POCKET)
+    throw std::invalid_argument ("HoldemHandIndexer: wrong number of hole cards");
+  int street = boardStreet (nboard);
+  if (street < 0)
+    throw std::invalid_argument ("HoldemHandIndexer: wrong number of board cards");
+  if (_layout == STREETS && street > static_cast<int>(FLOP))
+    throw std::invalid_argument ("HoldemHandIndexer: the board must be given by street");
+  return indexRounds (street, masks);
+}
+
+uint64_t HoldemHandIndexer::index (const CardSet& hole, const CardSet& flop,
+                                   const CardSet& turn, const CardSet& river) const
+{
+  int masks[NUM_SUIT][MAX_ROUNDS];
+  int n[MAX_ROUNDS] = { 0 };
+  for (int s=0; s<NUM_SUIT; s++)
+    {
+      masks[s][0] = suitMask (hole, s);
+      masks[s][1] = suitMask (flop, s);
+      masks[s][2] = suitMask (turn, s);
+      masks[s][3] = suitMask (river, s);
+      for (size_t r=0; r<MAX_ROUNDS; r++)
+        n[r] += bitcount (masks[s][r]);
+    }
+  size_t street = (n[1] > 0) + (n[2] > 0) + (n[3] > 0);
+  if ((street > 0 && n[1] != static_cast<int>(NUM_FLOP_CARDS))
+      || (street > 1 && n[2] != 1) || (street > 2 && n[3] != 1)
+      || (street < 2 && n[2] > 0) || (street < 3 && n[3] > 0))
+    throw std::invalid_argument ("HoldemHandIndexer: wrong number of cards on a street");
+  if (n[0] != NUM_HOLDEM_POCKET)
+    throw std::invalid_argument ("HoldemHandIndexer: wrong number of hole cards");
+
+  if (_layout == BOARD)
+    {
+      // a card on two streets would vanish in the merged board
+      if ((flop.mask() & turn.mask()) | ((flop.mask() | turn.mask()) & river.mask()))
+        throw std::invalid_argument ("HoldemHandIndexer: duplicate card");
+      for (int s=0; s<NUM_SUIT; s++)
+        {
+          masks[s][1] |= masks[s][2] | masks[s][3];
+          masks[s][2] = 0;
+          masks[s][3] = 0;
+        }
+    }
+  return indexRounds (street, masks);
+}
+
+uint64_t HoldemHandIndexer::indexRounds (size_t street, const int masks[][MAX_ROUNDS]) const
+{
+  const int * cards = _cards[street];
+  size_t nrounds = min (_rounds, street+1);   // the rounds to come are empty
+  uint64_t suits[NUM_SUIT];
+  for (int s=0; s<NUM_SUIT; s++)
+    {
+      // number the rank sets of each round among the ranks not yet
+      // used by this suit, as a mixed radix over the rounds; nothing
+      // is used in the first round
+      int used = masks[s][0];
+      int c = bitcount (used);
+      uint64_t idx = RANKS.colex[used];
+      uint64_t mult = RANKS.binomial[NUM_RANK][c];
+      int nused = c;
+      uint64_t id = c;
+      for (size_t r=1; r<nrounds; r++)
+        {
+          int m = masks[s][r];
+          if (m & used)
+            throw std::invalid_argument ("HoldemHandIndexer: duplicate card");
+          c = bitcount (m);
+          idx  += mult * (cards[r] == 1 ? cardIndex (m, used) : subsetIndex (m, used));
+          mult *= RANKS.binomial[NUM_RANK - nused][c];
+          used |= m;
+          nused += c;
+          id = id * (cards[r] + 1) + c;
+        }
+      suits[s] = (id << SHAPE_SHIFT) | idx;
+    }
+
+  // sort the four suits, decreasing
+  sortPair (suits[0], suits[1]);
+  sortPair (suits[2], suits[3]);
+  sortPair (suits[0], suits[2]);
+  sortPair (suits[1], suits[3]);
+  sortPair (suits[1], suits[2]);
+
+  int ids[NUM_SUIT];
+  for (int s=0; s<NUM_SUIT; s++)
+    ids[s] = static_cast<int>(suits[s] >> SHAPE_SHIFT);
+  int32_t c = _configByShapes[street][shapesRank (ids)];
+  if (c < 0)
+    throw std::invalid_argument ("HoldemHandIndexer: impossible configuration");
+
+  // combine suits of the same shape as a multiset, the indices are
+  // already sorted in decreasing order
+  const Configuration& config = _configs[street][c];
+  uint64_t local = 0;
+  for (int s=0; s<NUM_SUIT; s++)
+    local += config.mult[s] * multisetTerm ((suits[s] & INDEX_MASK) + config.shift[s], config.take[s]);
+  return config.offset + local;
+}
+
+void HoldemHandIndexer::unindex (size_t street, uint64_t idx,
+                                 CardSet& hole, CardSet& board) const
+{
+  CardSet rounds[MAX_ROUNDS];
+  unindexRounds (street, idx, rounds);
+  hole = rounds[0];
+  board = rounds[1] | rounds[2] | rounds[3];
+}
+
+void HoldemHandIndexer::unindex (size_t street, uint64_t idx, CardSet& hole,
+                                 CardSet& flop, CardSet& turn, CardSet& river) const
+{
+  CardSet rounds[MAX_ROUNDS];
+  unindexRounds (street, idx, rounds);
+  hole = rounds[0];
+  if (_layout == STREETS)
+    {
+      flop  = rounds[1];
+      turn  = rounds[2];
+      river = rounds[3];
+      return;
+    }
+
+  CardSet * streets[] = { &flop, &flop, &flop, &turn, &river };
+  flop.clear ();
+  turn.clear ();
+  river.clear ();
+  size_t n = 0;
+  for (int c=0; c<static_cast<int>(CardSet::STANDARD_DECK_SIZE); c++)
+    if (rounds[1].mask() & (ONE64 << c))
+      streets[n++]->insert (CardSet (ONE64 << c));
+}
+
+void HoldemHandIndexer::unindexRounds (size_t street, uint64_t idx, CardSet rounds[]) const
+{
+  if (street >= NUM_HOLDEM_ROUNDS || idx >= _sizes[street])
+    throw std::out_of_range ("HoldemHandIndexer: index out of range");
+
+  const vector<Configuration>& configs = _configs[street];
+  size_t lo = 0;
+  size_t hi = configs.size();
+  while (hi - lo > 1)
+    {
+      size_t mid = (lo + hi) / 2;
+      if (configs[mid].offset <= idx)
+        lo = mid;
+      else
+        hi = mid;
+    }
+  const Configuration& config = configs[lo];
+  uint64_t local = idx - config.offset;
+
+  int shapes[NUM_SUIT];
+  for (int s=0; s<NUM_SUIT; s++)
+    shapes[s] = static_cast<int>((config.key >> (16*(NUM_SUIT-1-s))) & 0xFFFF);
+
+  // undo the group multisets
+  uint64_t suitIdx[NUM_SUIT];
+  for (int i=0; i<NUM_SUIT; )
+    {
+      int j = i;
+      while (j < NUM_SUIT && shapes[j] == shapes[i])
+        j++;
+      uint64_t k = j - i;
+      uint64_t gsize = nCr (suitSize (shapes[i], _rounds) + k - 1, k);
+      uint64_t g = local % gsize;
+      local /= gsize;
+      for (uint64_t t=0; t<k; t++)
+        {
+          uint64_t size = k - t;
+          uint64_t b = size - 1;
+          while (nCr (b+1, size) <= g)
+            b++;
+          g -= nCr (b, size);
+          suitIdx[i+t] = b - (k - 1 - t);
+        }
+      i = j;
+    }
+
+  // undo the per suit numbering, dealing the ranks to the rounds
+  for (size_t r=0; r<MAX_ROUNDS; r++)
+    rounds[r].clear ();
+  for (int s=0; s<NUM_SUIT; s++)
+    {
+      int used = 0;
+      uint64_t sidx = suitIdx[s];
+      for (size_t r=0; r<_rounds; r++)
+        {
+          int c = shapeCount (shapes[s], r, _rounds);
+          uint64_t radix = nCr (NUM_RANK - bitcount (used), c);
+          uint64_t sub = sidx % radix;
+          sidx /= radix;
+
+          // colex unrank the positions among the unused ranks
+          int positions = 0;
+          for (int nth=c; nth>0; nth--)
+            {
+              int p = nth - 1;
+              while (nCr (p+1, nth) <= sub)
+                p++;
+              sub -= nCr (p, nth);
+              positions |= 1 << p;
+            }
+
+          int pos = 0;
+          for (int rank=0; rank<NUM_RANK; rank++)
+            {
+              if (used & (1<<rank))
+                continue;
+              if (positions & (1<<pos))
+                {
+                  rounds[r].insert (CardSet (ONE64 << (rank + NUM_RANK*s)));
+                  used |= 1<<rank;
+                }
+              pos++;
+            }
+        }
+    }
+}
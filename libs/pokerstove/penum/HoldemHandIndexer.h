@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_HOLDEMHANDINDEXER_H_
+#define PENUM_HOLDEMHANDINDEXER_H_
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/Holdem.h>
+#include <pokerstove/peval/Suit.h>
+
+namespace pokerstove
+{
+  /**
+   * A dense index over the suit isomorphic hold'em states of each
+   * street.  Two states get the same index if and only if one can be
+   * turned into the other by permuting suits.  A state is the hole
+   * cards and the board, which the layout splits into rounds:
+   *
+   * - BOARD: the board is one unordered set of cards, so a turn state
+   *   is the same whichever board card came last, as the expected hand
+   *   strength and bucket tables want.
+   * - STREETS: the flop, turn and river are rounds of their own, so
+   *   the index tells the street each card came on, as a game tree
+   *   wants.
+   *
+   * The index sizes are:
+   *
+   *                    BOARD          STREETS
+   *   preflop            169              169
+   *   flop         1,286,792        1,286,792
+   *   turn        13,960,050       55,190,538
+   *   river      123,156,254    2,428,287,420
+   *
+   * The construction follows Waugh, "A Fast and Optimal Hand
+   * Isomorphism Algorithm".  Each suit is reduced to its rank set in
+   * each round, which are numbered within the suit's shape (its number
+   * of cards in each round).  Suits with the same shape are combined as
+   * a multiset, and the sorted list of shapes (the configuration)
+   * selects a block of the index space.  Indexing is table driven: the
+   * colex number of a round's ranks among those the suit has left, and
+   * the configuration of the sorted shapes, are lookups, and nothing
+   * is allocated.
+   */
+  class HoldemHandIndexer
+  {
+  public:
+    enum Layout { BOARD, STREETS };
+
+    static const size_t MAX_ROUNDS = 4;
+
+    explicit HoldemHandIndexer (Layout layout=BOARD);
+
+    Layout layout () const { return _layout; }
+
+    /**
+     * number of isomorphism classes for the street, PREFLOP..RIVER
+     */
+    uint64_t size (size_t street) const { return _sizes[street]; }
+
+    /**
+     * street of a 0, 3, 4, or 5 card board
+     */
+    static size_t street (const CardSet& board);
+
+    /**
+     * Index a state.  The street is determined by the board size
+     * (0, 3, 4, or 5 cards).  With the STREETS layout, a turn or river
+     * board must be given by street instead, else this throws
+     * std::invalid_argument.
+     */
+    uint64_t index (const CardSet& hole, const CardSet& board) const;
+
+    /**
+     * Index a state by street, the cards still to come being empty.
+     * With the BOARD layout the streets are merged.
+     */
+    uint64_t index (const CardSet& hole, const CardSet& flop,
+                    const CardSet& turn, const CardSet& river) const;
+
+    /**
+     * Produce a canonical representative of an index.
+     */
+    void unindex (size_t street, uint64_t idx,
+                  CardSet& hole, CardSet& board) const;
+
+    /**
+     * unindex by street; with the BOARD layout the whole board is the
+     * flop, turn and river in order of the cards
+     */
+    void unindex (size_t street, uint64_t idx, CardSet& hole,
+                  CardSet& flop, CardSet& turn, CardSet& river) const;
+
+  private:
+    struct Configuration
+    {
+      uint64_t key;          //!< sorted suit shapes, 16 bits per suit
+      uint64_t offset;       //!< start of this configuration's block
+      uint64_t size;
+
+      // the multiset term of the suit in each sorted position: the
+      // multiplier of its group, and the size and the position of the
+      // suit in the group as choose(index + shift, take)
+      uint64_t mult[Suit::NUM_SUIT];
+      uint8_t  shift[Suit::NUM_SUIT];
+      uint8_t  take[Suit::NUM_SUIT];
+    };
+
+    uint64_t indexRounds (size_t street, const int masks[][MAX_ROUNDS]) const;
+    void unindexRounds (size_t street, uint64_t idx, CardSet rounds[]) const;
+    void buildConfigurations (size_t street);
+
+    Layout                         _layout;
+    size_t                         _rounds;        //!< 2 for BOARD, 4 for STREETS
+    int                            _cards[NUM_HOLDEM_ROUNDS][MAX_ROUNDS];  //!< per street and round
+    std::vector<Configuration>     _configs[NUM_HOLDEM_ROUNDS];
+    uint64_t                       _sizes[NUM_HOLDEM_ROUNDS];
+
+    // for indexing, a shape is numbered in mixed radix over the rounds
+    size_t                         _numShapes[NUM_HOLDEM_ROUNDS];
+    std::vector<uint64_t>          _shapeSize[NUM_HOLDEM_ROUNDS];  //!< rank sets per shape number
+    std::vector<int32_t>           _configByShapes[NUM_HOLDEM_ROUNDS]; //!< by multiset of shape numbers
+  };
+}
+
+#endif  // PENUM_HOLDEMHANDINDEXER_H_
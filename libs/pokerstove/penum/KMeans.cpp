@@ -0,0 +1,331 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <pokerstove/util/philox.h>
+#include "KMeans.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t KMeans::NUM_CHUNKS;
+const size_t KMeans::POINT_BLOCK;
+const size_t KMeans::CENTER_BLOCK;
+
+namespace
+{
+  inline float distance (const float * a, const float * b, size_t dim, KMeans::Distance d)
+  {
+    float sum = 0.0f;
+    if (d == KMeans::L2)
+      for (size_t i=0; i<dim; i++)
+        {
+          float x = a[i] - b[i];
+          sum += x*x;
+        }
+    else
+      for (size_t i=0; i<dim; i++)
+        sum += fabs (a[i] - b[i]);
+    return sum;
+  }
+
+  /**
+   * One pass over the points: the chunks share the inputs, and each
+   * writes its own outputs.
+   */
+  struct Pass
+  {
+    const float *             points;
+    size_t                    npoints;
+    size_t                    dim;
+    size_t                    k;
+    KMeans::Distance          distance;
+    const float *             centers;
+    uint32_t *                assignment;
+    float *                   nearest;     //!< distance of each point to its center
+    float *                   update;      //!< the centers the means are written to
+
+    vector<uint32_t>          order;       //!< points by center, in point order
+    vector<size_t>            start;       //!< of each center's points in order, k+1
+    vector<double>            cost;        //!< per chunk
+    vector<uint64_t>          changed;     //!< per chunk
+
+    size_t first (size_t chunk) const { return npoints * chunk / KMeans::NUM_CHUNKS; }
+    size_t firstCenter (size_t chunk) const { return k * chunk / KMeans::NUM_CHUNKS; }
+  };
+
+  /**
+   * Assign the points of a chunk to their nearest center, a block of
+   * points against a block of centers at a time.
+   */
+  void assignChunk (Pass * pass, size_t chunk)
+  {
+    const size_t dim = pass->dim;
+    const size_t k = pass->k;
+    size_t begin = pass->first (chunk);
+    size_t end = pass->first (chunk+1);
+
+    double cost = 0.0;
+    uint64_t changed = 0;
+
+    float best[KMeans::POINT_BLOCK];
+    uint32_t bestCenter[KMeans::POINT_BLOCK];
+    for (size_t p0=begin; p0<end; p0+=KMeans::POINT_BLOCK)
+      {
+        size_t p1 = min (end, p0+KMeans::POINT_BLOCK);
+        std::fill (best, best+KMeans::POINT_BLOCK, numeric_limits<float>::max());
+        for (size_t c0=0; c0<k; c0+=KMeans::CENTER_BLOCK)
+          {
+            size_t c1 = min (k, c0+KMeans::CENTER_BLOCK);
+            for (size_t p=p0; p<p1; p++)
+              {
+                const float * x = pass->points + p*dim;
+                for (size_t c=c0; c<c1; c++)
+                  {
+                    float d = distance (x, pass->centers + c*dim, dim, pass->distance);
+                    if (d < best[p-p0])
+                      {
+                        best[p-p0] = d;
+                        bestCenter[p-p0] = static_cast<uint32_t>(c);
+                      }
+                  }
+              }
+          }
+
+        for (size_t p=p0; p<p1; p++)
+          {
+            uint32_t c = bestCenter[p-p0];
+            if (pass->assignment[p] != c)
+              changed++;
+            pass->assignment[p] = c;
+            pass->nearest[p] = best[p-p0];
+            cost += best[p-p0];
+          }
+      }
+    pass->cost[chunk] = cost;
+    pass->changed[chunk] = changed;
+  }
+
+  /**
+   * Move the non empty centers of a chunk of centers to the mean of
+   * their points, summed in point order.
+   */
+  void centerChunk (Pass * pass, size_t chunk)
+  {
+    const size_t dim = pass->dim;
+    vector<double> sum (dim);
+    for (size_t c=pass->firstCenter (chunk); c<pass->firstCenter (chunk+1); c++)
+      {
+        size_t begin = pass->start[c];
+        size_t end = pass->start[c+1];
+        if (begin == end)
+          continue;
+        std::fill (sum.begin(), sum.end(), 0.0);
+        for (size_t j=begin; j<end; j++)
+          {
+            const float * x = pass->points + static_cast<size_t>(pass->order[j])*dim;
+            for (size_t i=0; i<dim; i++)
+              sum[i] += x[i];
+          }
+        for (size_t i=0; i<dim; i++)
+          pass->update[c*dim+i] = static_cast<float>(sum[i] / (end - begin));
+      }
+  }
+
+  /**
+   * Lower the nearest distance of the points of a chunk with a new
+   * center, and total the seeding weights of the chunk.
+   */
+  void seedChunk (Pass * pass, size_t chunk, const float * center, vector<double> * totals)
+  {
+    size_t begin = pass->first (chunk);
+    size_t end = pass->first (chunk+1);
+    double total = 0.0;
+    for (size_t p=begin; p<end; p++)
+      {
+        float d = distance (pass->points + p*pass->dim, center, pass->dim, pass->distance);
+        if (d < pass->nearest[p])
+          pass->nearest[p] = d;
+        // D^2 weighting, the L2 distance is already squared
+        double w = pass->nearest[p];
+        total += pass->distance == KMeans::L2 ? w : w*w;
+      }
+    (*totals)[chunk] = total;
+  }
+}
+
+KMeans::KMeans (size_t k, size_t dim, Distance distance)
+  : _k(k)
+  , _dim(dim)
+  , _distance(distance)
+  , _seed(0)
+  , _maxIterations(100)
+  , _tolerance(0.0)
+  , _pool(&ThreadPool::shared ())
+  , _iterations(0)
+  , _cost(0.0)
+{
+  if (_k == 0 || _dim == 0)
+    throw std::invalid_argument ("KMeans: k and the dimension must be positive");
+}
+
+void KMeans::cumulative (float * points, size_t npoints, size_t dim)
+{
+  for (size_t p=0; p<npoints; p++)
+    {
+      float * x = points + p*dim;
+      for (size_t i=1; i<dim; i++)
+        x[i] += x[i-1];
+    }
+}
+
+void KMeans::seed (const float * points, size_t npoints)
+{
+  TraceSpan span ("kmeans seed", "cluster");
+  Philox4x32 rng (_seed, 0);
+  _centers.resize (_k*_dim);
+
+  Pass pass;
+  pass.points   = points;
+  pass.npoints  = npoints;
+  pass.dim      = _dim;
+  pass.k        = _k;
+  pass.distance = _distance;
+  vector<float> nearest (npoints, numeric_limits<float>::max());
+  pass.nearest  = &nearest[0];
+  vector<double> totals (NUM_CHUNKS, 0.0);
+
+  size_t chosen = static_cast<size_t>(rng.below (npoints));
+  for (size_t c=0; c<_k; c++)
+    {
+      std::copy (points + chosen*_dim, points + (chosen+1)*_dim, &_centers[c*_dim]);
+      if (c+1 == _k)
+        break;
+
+      {
+        TaskGroup group (_pool);
+        for (size_t chunk=0; chunk<NUM_CHUNKS; chunk++)
+          group.run (boost::bind (seedChunk, &pass, chunk, &_centers[c*_dim], &totals));
+        group.wait ();
+      }
+
+      // draw the next center with probability proportional to its
+      // weight, finding the chunk first
+      double total = 0.0;
+      for (size_t chunk=0; chunk<NUM_CHUNKS; chunk++)
+        total += totals[chunk];
+      if (total <= 0.0)
+        {
+          // every point is on a center already
+          chosen = static_cast<size_t>(rng.below (npoints));
+          continue;
+        }
+      double r = rng.uniform () * total;
+      size_t chunk = 0;
+      while (chunk+1 < NUM_CHUNKS && r >= totals[chunk])
+        r -= totals[chunk++];
+      chosen = pass.first (chunk+1) - 1;
+      for (size_t p=pass.first (chunk); p<pass.first (chunk+1); p++)
+        {
+          double w = _distance == L2 ? nearest[p] : static_cast<double>(nearest[p]) * nearest[p];
+          if (r < w)
+            {
+              chosen = p;
+              break;
+            }
+          r -= w;
+        }
+    }
+}
+
+void KMeans::run (const float * points, size_t npoints)
+{
+  if (npoints < _k)
+    throw std::invalid_argument ("KMeans: fewer points than clusters");
+
+  seed (points, npoints);
+  _assignment.assign (npoints, static_cast<uint32_t>(_k));
+  vector<float> nearest (npoints, 0.0f);
+
+  Pass pass;
+  pass.points     = points;
+  pass.npoints    = npoints;
+  pass.dim        = _dim;
+  pass.k          = _k;
+  pass.distance   = _distance;
+  pass.centers    = &_centers[0];
+  pass.assignment = &_assignment[0];
+  pass.nearest    = &nearest[0];
+  pass.update     = &_centers[0];
+  pass.order.resize (npoints);
+  pass.start.resize (_k+1);
+  pass.cost.resize (NUM_CHUNKS);
+  pass.changed.resize (NUM_CHUNKS);
+
+  _iterations = 0;
+  while (_iterations < _maxIterations)
+    {
+      TraceSpan span ("kmeans iteration", "cluster");
+      if (span.active ())
+        span.setDetail ((boost::format("iteration %d") % _iterations).str());
+      {
+        TaskGroup group (_pool);
+        for (size_t chunk=0; chunk<NUM_CHUNKS; chunk++)
+          group.run (boost::bind (assignChunk, &pass, chunk));
+        group.wait ();
+      }
+      _iterations++;
+
+      uint64_t changed = 0;
+      _cost = 0.0;
+      for (size_t chunk=0; chunk<NUM_CHUNKS; chunk++)
+        {
+          _cost += pass.cost[chunk];
+          changed += pass.changed[chunk];
+        }
+
+      std::fill (pass.start.begin(), pass.start.end(), 0);
+      for (size_t p=0; p<npoints; p++)
+        pass.start[_assignment[p]+1]++;
+      size_t empty = static_cast<size_t>(std::count (pass.start.begin()+1, pass.start.end(), 0));
+
+      // stop before moving the centers, so the assignment and cost are
+      // those of the centers returned
+      if ((changed <= _tolerance * npoints && empty == 0) || _iterations == _maxIterations)
+        break;
+
+      // list the points by center, then average each center's points
+      // on its own, so no chunk holds sums for every center
+      for (size_t c=0; c<_k; c++)
+        pass.start[c+1] += pass.start[c];
+      {
+        vector<size_t> next (pass.start.begin(), pass.start.end()-1);
+        for (size_t p=0; p<npoints; p++)
+          pass.order[next[_assignment[p]]++] = static_cast<uint32_t>(p);
+      }
+      {
+        TaskGroup group (_pool);
+        for (size_t chunk=0; chunk<NUM_CHUNKS; chunk++)
+          group.run (boost::bind (centerChunk, &pass, chunk));
+        group.wait ();
+      }
+
+      for (size_t c=0; c<_k; c++)
+        {
+          if (pass.start[c] < pass.start[c+1])
+            continue;
+          // an empty cluster takes over the point furthest from its
+          // center, which then counts as on a center
+          size_t far = static_cast<size_t>(max_element (nearest.begin(), nearest.end()) - nearest.begin());
+          std::copy (points + far*_dim, points + (far+1)*_dim, &_centers[c*_dim]);
+          nearest[far] = 0.0f;
+        }
+    }
+}
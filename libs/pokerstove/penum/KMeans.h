@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_KMEANS_H_
+#define PENUM_KMEANS_H_
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "ThreadPool.h"
+
+namespace pokerstove
+{
+  /**
+   * Lloyd's k-means over dense float points, for clustering hands by
+   * their equity histograms.  Centers start from k-means++ seeding,
+   * drawn from a Philox4x32 stream of the seed.
+   *
+   * With EMD the points must be cumulative histograms (see
+   * cumulative()): the earth mover's distance between two one
+   * dimensional histograms is the L1 distance of their cumulative
+   * forms.  Centers are the mean of their points under either
+   * distance, which is exact for L2 and the usual approximation for
+   * EMD.
+   *
+   * Each iteration assigns the points in NUM_CHUNKS fixed chunks on
+   * the pool.  Within a chunk the distances are computed a block of
+   * POINT_BLOCK points against a block of CENTER_BLOCK centers at a
+   * time, so the centers being compared stay in cache.  The points
+   * are then listed by center, and the centers are averaged in
+   * NUM_CHUNKS chunks of centers, each summing its points in point
+   * order.  So the result does not depend on the number of threads,
+   * and the sums take dim doubles per chunk rather than k x dim.
+   */
+  class KMeans
+  {
+  public:
+    enum Distance { L2, EMD };
+
+    static const size_t NUM_CHUNKS = 256;
+    static const size_t POINT_BLOCK = 128;
+    static const size_t CENTER_BLOCK = 16;
+
+    KMeans (size_t k, size_t dim, Distance distance=L2);
+
+    void setSeed (uint64_t seed)              { _seed = seed; }
+    void setMaxIterations (size_t n)          { _maxIterations = n; }
+
+    /**
+     * stop once no more than this fraction of the points change
+     * cluster in an iteration
+     */
+    void setTolerance (double fraction)       { _tolerance = fraction; }
+
+    /**
+     * the pool the work is run on, ThreadPool::shared() by default; a
+     * null pool runs everything on the calling thread
+     */
+    void setPool (ThreadPool * pool) { _pool = pool; }
+    ThreadPool * pool () const { return _pool; }
+
+    /**
+     * Cluster npoints points of dim floats each, stored one after
+     * another.  The run ends on an assignment pass, so assignment()
+     * and cost() are those of the centers.  Throws
+     * std::invalid_argument if there are fewer points than clusters.
+     */
+    void run (const float * points, size_t npoints);
+
+    const std::vector<uint32_t>& assignment () const { return _assignment; }
+    const std::vector<float>& centers () const { return _centers; }
+
+    size_t iterations () const { return _iterations; }
+
+    /**
+     * sum of the distance of each point to its center, squared for L2
+     */
+    double cost () const { return _cost; }
+
+    /**
+     * Turn n histograms of dim bins in place into their cumulative
+     * sums, the form EMD clustering works on.
+     */
+    static void cumulative (float * points, size_t npoints, size_t dim);
+
+  private:
+    void seed (const float * points, size_t npoints);
+
+    size_t                 _k;
+    size_t                 _dim;
+    Distance               _distance;
+    uint64_t               _seed;
+    size_t                 _maxIterations;
+    double                 _tolerance;
+    ThreadPool *           _pool;
+
+    std::vector<float>     _centers;      //!< k x dim
+    std::vector<uint32_t>  _assignment;
+    size_t                 _iterations;
+    double                 _cost;
+  };
+}
+
+#endif  // PENUM_KMEANS_H_
@@ -0,0 +1,254 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/Rank.h>
+#include "OmahaHandIndexer.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t OmahaHandIndexer::MAX_CARDS;
+
+namespace
+{
+  const int NUM_RANK = Rank::NUM_RANK;
+  const int NUM_SUIT = Suit::NUM_SUIT;
+  const uint32_t KEY_BASE = OmahaHandIndexer::MAX_CARDS + 1;
+
+  uint64_t nCr (uint64_t n, uint64_t k)
+  {
+    if (k > n)
+      return 0;
+    uint64_t ret = 1;
+    for (uint64_t i=0; i<k; i++)
+      ret = ret * (n - i) / (i + 1);
+    return ret;
+  }
+
+  int bitcount (int v)
+  {
+    int c = 0;
+    for (; v; c++)
+      v &= v - 1;
+    return c;
+  }
+
+  uint32_t configKey (const int counts[])
+  {
+    uint32_t key = 0;
+    for (int s=0; s<NUM_SUIT; s++)
+      key = key * KEY_BASE + static_cast<uint32_t>(counts[s]);
+    return key;
+  }
+
+  // every way of splitting n cards into non increasing suit counts
+  void dealCounts (int counts[], int suit, int remaining, int most, vector<uint32_t>& keys)
+  {
+    if (suit == NUM_SUIT)
+      {
+        if (remaining == 0)
+          keys.push_back (configKey (counts));
+        return;
+      }
+    for (int c=min (remaining, most); c>=0; c--)
+      {
+        counts[suit] = c;
+        dealCounts (counts, suit+1, remaining-c, c, keys);
+      }
+  }
+
+  struct SuitIndex
+  {
+    int      count;
+    uint32_t index;
+    bool operator> (const SuitIndex& o) const
+    {
+      if (count != o.count)
+        return count > o.count;
+      return index > o.index;
+    }
+  };
+}
+
+OmahaHandIndexer::OmahaHandIndexer (size_t handSize)
+  : _handSize(handSize)
+  , _rankIndex(1 << NUM_RANK, 0)
+{
+  if (_handSize == 0 || _handSize > MAX_CARDS)
+    throw std::invalid_argument ("OmahaHandIndexer: unsupported hand size");
+
+  // rank sets in increasing order are in colex order within each size
+  for (int m=0; m<(1 << NUM_RANK); m++)
+    {
+      int c = bitcount (m);
+      if (c > static_cast<int>(MAX_CARDS))
+        continue;
+      _rankIndex[m] = static_cast<uint16_t>(_rankSets[c].size());
+      _rankSets[c].push_back (static_cast<uint16_t>(m));
+    }
+
+  buildConfigurations ();
+
+  uint32_t total = _configs.back().offset + _configs.back().size;
+  _hands.resize (total);
+  _multiplicity.resize (total);
+  for (uint32_t idx=0; idx<total; idx++)
+    {
+      uint32_t mult;
+      _hands[idx] = unrank (idx, mult).mask();
+      _multiplicity[idx] = static_cast<uint8_t>(mult);
+    }
+}
+
+void OmahaHandIndexer::buildConfigurations ()
+{
+  vector<uint32_t> keys;
+  int counts[NUM_SUIT];
+  dealCounts (counts, 0, static_cast<int>(_handSize), static_cast<int>(_handSize), keys);
+  sort (keys.begin(), keys.end());
+
+  _configByKey.assign (KEY_BASE * KEY_BASE * KEY_BASE * KEY_BASE, -1);
+  uint32_t offset = 0;
+  for (size_t i=0; i<keys.size(); i++)
+    {
+      // number of hands in a configuration, the product over groups of
+      // equal counts of the number of multisets of rank set numbers
+      uint32_t key = keys[i];
+      for (int s=NUM_SUIT-1; s>=0; s--, key/=KEY_BASE)
+        counts[s] = static_cast<int>(key % KEY_BASE);
+      uint64_t size = 1;
+      for (int a=0; a<NUM_SUIT; )
+        {
+          int b = a;
+          while (b < NUM_SUIT && counts[b] == counts[a])
+            b++;
+          size *= nCr (_rankSets[counts[a]].size() + (b-a) - 1, b-a);
+          a = b;
+        }
+
+      Configuration config;
+      config.key    = keys[i];
+      config.offset = offset;
+      config.size   = static_cast<uint32_t>(size);
+      _configByKey[config.key] = static_cast<int32_t>(_configs.size());
+      _configs.push_back (config);
+      offset += config.size;
+    }
+}
+
+uint32_t OmahaHandIndexer::index (const CardSet& hand) const
+{
+  SuitIndex suits[NUM_SUIT];
+  size_t cards = 0;
+  for (int s=0; s<NUM_SUIT; s++)
+    {
+      int m = hand.suitMask (Suit (static_cast<uint8_t>(s)));
+      suits[s].count = bitcount (m);
+      cards += suits[s].count;
+      if (suits[s].count > static_cast<int>(MAX_CARDS))
+        throw std::invalid_argument ("OmahaHandIndexer: wrong number of cards");
+      suits[s].index = _rankIndex[m];
+    }
+  if (cards != _handSize)
+    throw std::invalid_argument ("OmahaHandIndexer: wrong number of cards");
+  sort (suits, suits+NUM_SUIT, greater<SuitIndex>());
+
+  int counts[NUM_SUIT];
+  for (int s=0; s<NUM_SUIT; s++)
+    counts[s] = suits[s].count;
+  const Configuration& config = _configs[_configByKey[configKey (counts)]];
+
+  // combine suits of the same count as a multiset, the numbers are
+  // already sorted in decreasing order
+  uint64_t local = 0;
+  uint64_t mult = 1;
+  for (int i=0; i<NUM_SUIT; )
+    {
+      int j = i;
+      while (j < NUM_SUIT && suits[j].count == suits[i].count)
+        j++;
+      uint64_t k = j - i;
+      uint64_t g = 0;
+      for (uint64_t t=0; t<k; t++)
+        g += nCr (suits[i+t].index + k - 1 - t, k - t);
+      local += mult * g;
+      mult  *= nCr (_rankSets[suits[i].count].size() + k - 1, k);
+      i = j;
+    }
+  return config.offset + static_cast<uint32_t>(local);
+}
+
+CardSet OmahaHandIndexer::unrank (uint32_t idx, uint32_t& multiplicity) const
+{
+  size_t lo = 0;
+  size_t hi = _configs.size();
+  while (hi - lo > 1)
+    {
+      size_t mid = (lo + hi) / 2;
+      if (_configs[mid].offset <= idx)
+        lo = mid;
+      else
+        hi = mid;
+    }
+  const Configuration& config = _configs[lo];
+  uint64_t local = idx - config.offset;
+
+  int counts[NUM_SUIT];
+  uint32_t key = config.key;
+  for (int s=NUM_SUIT-1; s>=0; s--, key/=KEY_BASE)
+    counts[s] = static_cast<int>(key % KEY_BASE);
+
+  // undo the group multisets
+  uint32_t suitIdx[NUM_SUIT];
+  for (int i=0; i<NUM_SUIT; )
+    {
+      int j = i;
+      while (j < NUM_SUIT && counts[j] == counts[i])
+        j++;
+      uint64_t k = j - i;
+      uint64_t gsize = nCr (_rankSets[counts[i]].size() + k - 1, k);
+      uint64_t g = local % gsize;
+      local /= gsize;
+      for (uint64_t t=0; t<k; t++)
+        {
+          uint64_t size = k - t;
+          uint64_t b = size - 1;
+          while (nCr (b+1, size) <= g)
+            b++;
+          g -= nCr (b, size);
+          suitIdx[i+t] = static_cast<uint32_t>(b - (k - 1 - t));
+        }
+      i = j;
+    }
+
+  // the hand, and the order of the group of suit permutations which
+  // fix it: suits with the same rank set may be swapped
+  CardSet hand;
+  uint32_t fixing = 1;
+  for (int s=0; s<NUM_SUIT; s++)
+    {
+      hand |= CardSet (static_cast<uint64_t>(_rankSets[counts[s]][suitIdx[s]]) << (NUM_RANK*s));
+      int same = 1;
+      for (int t=0; t<s; t++)
+        if (counts[t] == counts[s] && suitIdx[t] == suitIdx[s])
+          same++;
+      fixing *= same;
+    }
+  multiplicity = 24 / fixing;
+  return hand;
+}
+
+void OmahaHandIndexer::memoryFootprint (MemoryFootprint& mem) const
+{
+  mem.add ("tables", "omaha index rank sets", &_rankIndex[0],
+           _rankIndex.size() * sizeof(uint16_t));
+  mem.add ("tables", "omaha index hands", &_hands[0],
+           _hands.size() * sizeof(uint64_t));
+  mem.add ("tables", "omaha index multiplicity", &_multiplicity[0],
+           _multiplicity.size() * sizeof(uint8_t));
+}
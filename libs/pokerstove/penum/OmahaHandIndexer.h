@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_OMAHAHANDINDEXER_H_
+#define PENUM_OMAHAHANDINDEXER_H_
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/Suit.h>
+
+namespace pokerstove
+{
+  /**
+   * A dense index over the suit isomorphic classes of starting hands
+   * of one size, two hands sharing an index if and only if one can be
+   * turned into the other by permuting suits.  The sizes are:
+   *
+   *   2 cards      169
+   *   4 cards   16,432    (omaha)
+   *   5 cards  134,459    (five card omaha)
+   *
+   * CardSet::canonize gives a canonical form of a hand by sorting its
+   * suits, but no dense number.  Here, as in HoldemHandIndexer with a
+   * single round, each suit's rank set is numbered in colex order among
+   * the sets of its size, suits with the same number of cards are
+   * combined as a multiset, and the sorted suit counts select a block
+   * of the index space.  Forward mapping uses a table of the colex
+   * number of every rank set; the canonical hand and multiplicity (the
+   * number of hands in the class) of every index are tabled at
+   * construction.
+   */
+  class OmahaHandIndexer
+  {
+  public:
+    static const size_t MAX_CARDS = 5;
+
+    /**
+     * Throws std::invalid_argument unless handSize is 1 to MAX_CARDS.
+     */
+    explicit OmahaHandIndexer (size_t handSize=4);
+
+    size_t handSize () const { return _handSize; }
+
+    /**
+     * number of isomorphism classes
+     */
+    uint32_t size () const { return static_cast<uint32_t>(_hands.size()); }
+
+    /**
+     * Throws std::invalid_argument if the hand has the wrong number of
+     * cards.
+     */
+    uint32_t index (const CardSet& hand) const;
+
+    /**
+     * the canonical hand of an index, which indexes back to it
+     */
+    CardSet unindex (uint32_t idx) const { return CardSet (_hands[idx]); }
+
+    /**
+     * the number of hands in the class of an index, from 1 to 24
+     */
+    uint32_t multiplicity (uint32_t idx) const { return _multiplicity[idx]; }
+
+    /**
+     * add the tables to mem
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+  private:
+    struct Configuration
+    {
+      uint32_t key;          //!< sorted suit counts, base MAX_CARDS+1
+      uint32_t offset;       //!< start of this configuration's block
+      uint32_t size;
+    };
+
+    void buildConfigurations ();
+    CardSet unrank (uint32_t idx, uint32_t& multiplicity) const;
+
+    size_t                     _handSize;
+    std::vector<uint16_t>      _rankIndex;     //!< colex number of each 13 bit rank set
+    std::vector<uint16_t>      _rankSets[MAX_CARDS+1];   //!< by size, in colex order
+    std::vector<Configuration> _configs;
+    std::vector<int32_t>       _configByKey;   //!< -1 where no configuration
+    std::vector<uint64_t>      _hands;         //!< canonical hand of each index
+    std::vector<uint8_t>       _multiplicity;
+  };
+}
+
+#endif  // PENUM_OMAHAHANDINDEXER_H_
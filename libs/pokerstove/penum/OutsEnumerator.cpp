@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <stdexcept>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include "OutsEnumerator.h"
+
+using namespace std;
+using namespace pokerstove;
+
+Outs::Outs ()
+{
+  std::fill (equity, equity+CardSet::STANDARD_DECK_SIZE, 0.0);
+}
+
+OutsEnumerator::OutsEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                                const CardSet& board,
+                                const CardSet& dead)
+  : _peval(peval)
+  , _board(board)
+  , _dead(dead)
+{
+  if (_peval->boardSize() == 0)
+    throw std::invalid_argument ("OutsEnumerator: the game has no board");
+  if (_board.size() >= _peval->boardSize())
+    throw std::invalid_argument ("OutsEnumerator: the board is complete");
+}
+
+Outs OutsEnumerator::calculate (const CardSet& hero, const CardDistribution& villain) const
+{
+  return calculate (hero, vector<CardDistribution> (1, villain));
+}
+
+Outs OutsEnumerator::calculate (const CardSet& hero, const vector<CardDistribution>& villains) const
+{
+  if (villains.empty())
+    throw std::invalid_argument ("OutsEnumerator: no villains");
+  const CardSet blocked = _board | _dead;
+  if (hero.intersects (blocked))
+    throw std::invalid_argument ("OutsEnumerator: the hero conflicts with the board");
+
+  vector<CardSet> cards;
+  vector<size_t> codes;
+  for (size_t c=0; c<CardSet::STANDARD_DECK_SIZE; c++)
+    if (!((blocked | hero).mask() & (ONE64 << c)))
+      {
+        cards.push_back (CardSet (ONE64 << c));
+        codes.push_back (c);
+      }
+  const size_t ncards = cards.size();
+  vector<CardSet> boards (ncards);
+  for (size_t k=0; k<ncards; k++)
+    boards[k] = _board | cards[k];
+
+  // every hand of every player on every card, hand major; the hero is
+  // player 0
+  const size_t nplayers = villains.size() + 1;
+  vector<vector<CardSet> > hands (nplayers);
+  vector<vector<double> > weights (nplayers);
+  vector<vector<PokerHandEvaluation> > evals (nplayers);
+  hands[0].push_back (hero);
+  weights[0].push_back (1.0);
+  for (size_t p=1; p<nplayers; p++)
+    {
+      const CardDistribution& range = villains[p-1];
+      for (size_t i=0; i<range.size(); i++)
+        if (range.weight (i) > 0.0 && !range[i].intersects (blocked | hero))
+          {
+            hands[p].push_back (range[i]);
+            weights[p].push_back (range.weight (i));
+          }
+    }
+  for (size_t p=0; p<nplayers; p++)
+    {
+      evals[p].resize (hands[p].size() * ncards);
+      for (size_t h=0; h<hands[p].size(); h++)
+        for (size_t k=0; k<ncards; k++)
+          if (hands[p][h].disjoint (cards[k]))
+            evals[p][h*ncards+k] = _peval->evaluateHand (hands[p][h], boards[k]);
+    }
+
+  // per card totals over the villain holdings
+  vector<double> weight (ncards, 0.0);
+  vector<double> share (ncards, 0.0);
+  vector<bool> scoops (ncards, true);
+  vector<bool> nothing (ncards, true);
+
+  const uint64_t unit = PokerHandEvaluator::shareUnit (nplayers);
+  vector<PokerHandEvaluation> showdown (nplayers);
+  vector<uint64_t> winUnits (nplayers);
+  vector<uint64_t> tieUnits (nplayers);
+
+  // step through every combination of villain hands, skipping those
+  // which share a card
+  vector<size_t> idx (nplayers, 0);
+  for (size_t p=1; p<nplayers; p++)
+    if (hands[p].empty())
+      return Outs ();
+  while (true)
+    {
+      CardSet used;
+      double w = 1.0;
+      bool conflict = false;
+      for (size_t p=1; p<nplayers && !conflict; p++)
+        {
+          const CardSet& hand = hands[p][idx[p]];
+          conflict = hand.intersects (used);
+          used |= hand;
+          w *= weights[p][idx[p]];
+        }
+
+      if (!conflict)
+        for (size_t k=0; k<ncards; k++)
+          {
+            if (used.intersects (cards[k]))
+              continue;
+            PEVAL_COUNT(BOARDS);
+            for (size_t p=0; p<nplayers; p++)
+              showdown[p] = evals[p][idx[p]*ncards+k];
+            std::fill (winUnits.begin(), winUnits.end(), 0);
+            std::fill (tieUnits.begin(), tieUnits.end(), 0);
+            PokerHandEvaluator::splitPot (showdown, winUnits, tieUnits, unit);
+
+            uint64_t units = winUnits[0] + tieUnits[0];
+            weight[k] += w;
+            share[k]  += w * units / unit;
+            if (winUnits[0] != unit)
+              scoops[k] = false;
+            if (units != 0)
+              nothing[k] = false;
+          }
+
+      size_t p = nplayers - 1;
+      while (p > 0 && ++idx[p] == hands[p].size())
+        idx[p--] = 0;
+      if (p == 0)
+        break;
+    }
+
+  Outs outs;
+  for (size_t k=0; k<ncards; k++)
+    {
+      if (weight[k] <= 0.0)
+        continue;
+      outs.cards |= cards[k];
+      if (scoops[k])
+        outs.win |= cards[k];
+      else if (nothing[k])
+        outs.lose |= cards[k];
+      else
+        outs.tie |= cards[k];
+      outs.equity[codes[k]] = share[k] / weight[k];
+    }
+  return outs;
+}
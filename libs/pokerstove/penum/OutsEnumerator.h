@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_OUTSENUMERATOR_H_
+#define PENUM_OUTSENUMERATOR_H_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include "CardDistribution.h"
+
+namespace pokerstove
+{
+  /**
+   * The outcome for the hero of each card which can come next.  A
+   * card is a win if the hero scoops against every villain holding it
+   * leaves possible, a loss if the hero gets none of the pot against
+   * any of them, and a tie otherwise: a split pot, or against ranges a
+   * result which depends on what the villains hold.  equity gives the
+   * hero's share of the pot on each card, by card code.
+   */
+  struct Outs
+  {
+    CardSet cards;      //!< every card which can come next
+    CardSet win;
+    CardSet tie;
+    CardSet lose;
+    double  equity[CardSet::STANDARD_DECK_SIZE];
+
+    Outs ();
+  };
+
+  /**
+   * Computes the outs of a hand against villain hands or ranges on a
+   * partial board, for any game with a board.  The outcome on a card
+   * is the showdown on the board with that card added, as outs are
+   * counted; on the turn it is the final result.
+   *
+   * Every hand is evaluated once on every next card, and the showdowns
+   * are then decided from those evaluations with the exact pot
+   * division of PokerHandEvaluator::splitPot, so a spot costs one
+   * evaluation per hand and card.  calculate is const and may be
+   * called from several threads at once.
+   */
+  class OutsEnumerator
+  {
+  public:
+    /**
+     * Throws std::invalid_argument for a game without a board, or a
+     * board which is already complete.
+     */
+    OutsEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                    const CardSet& board,
+                    const CardSet& dead=CardSet());
+
+    Outs calculate (const CardSet& hero, const CardDistribution& villain) const;
+
+    /**
+     * Outs against several villains, weighted by the product of the
+     * weights of their hands.  Throws std::invalid_argument if there
+     * are no villains or the hero conflicts with the board.
+     */
+    Outs calculate (const CardSet& hero, const std::vector<CardDistribution>& villains) const;
+
+  private:
+    boost::shared_ptr<PokerHandEvaluator> _peval;
+    CardSet              _board;
+    CardSet              _dead;
+  };
+}
+
+#endif  // PENUM_OUTSENUMERATOR_H_
@@ -0,0 +1,307 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <pokerstove/util/combinations.h>
+#include <pokerstove/util/utypes.h>
+#include "RangeEquityEnumerator.h"
+#include "SubsetWeights.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t RangeEquityEnumerator::RUNOUT_CHUNKS;
+
+namespace
+{
+  /**
+   * A range as the index of each live hand in the list of distinct
+   * hands, and its weight.
+   */
+  struct SparseRange
+  {
+    vector<uint32_t> slot;
+    vector<double>   weight;
+    vector<uint32_t> hand;      //!< index of the hand in its distribution
+  };
+
+  /**
+   * Everything the runout chunks share.
+   */
+  struct RangeJob
+  {
+    const PokerHandEvaluator * peval;
+    const vector<CardSet> *    runouts;
+    vector<CardSet>            hands;       //!< distinct live hands of both ranges
+    size_t                     depth;       //!< cards per hand
+    SparseRange                hero;
+    SparseRange                villain;
+    size_t                     nchunks;
+    vector<vector<double> >    shares;      //!< per chunk, per hero entry
+    vector<vector<double> >    matchups;
+  };
+
+  /**
+   * sort key of an evaluation, weakest first, with the entry in the
+   * low bits.  Flipping the sign bit keeps the order of negative codes.
+   */
+  inline uint64_t strengthKey (const PokerHandEvaluation& eval, size_t entry)
+  {
+    uint32_t code = static_cast<uint32_t>(eval.eval(0).code()) ^ 0x80000000u;
+    return (static_cast<uint64_t>(code) << 32) | static_cast<uint32_t>(entry);
+  }
+
+  /**
+   * the live entries of a range on a runout, sorted by strength
+   */
+  void sortLive (const SparseRange& range, const vector<int32_t>& live,
+                 const vector<PokerHandEvaluation>& evals, vector<uint64_t>& keys)
+  {
+    keys.clear ();
+    for (size_t e=0; e<range.slot.size(); e++)
+      {
+        int32_t l = live[range.slot[e]];
+        if (l >= 0)
+          keys.push_back (strengthKey (evals[l], e));
+      }
+    sort (keys.begin(), keys.end());
+  }
+
+  inline uint32_t keyEntry (uint64_t key) { return static_cast<uint32_t>(key); }
+  inline uint32_t keyCode (uint64_t key)  { return static_cast<uint32_t>(key >> 32); }
+
+  void runoutChunk (RangeJob * job, size_t chunk)
+  {
+    const vector<CardSet>& runouts = *job->runouts;
+    size_t first = runouts.size() * chunk / job->nchunks;
+    size_t last = runouts.size() * (chunk+1) / job->nchunks;
+    TraceSpan span ("range equity", "enum");
+    if (span.active ())
+      span.setDetail ((boost::format("runouts %d-%d") % first % last).str());
+
+    const SparseRange& hero = job->hero;
+    const SparseRange& villain = job->villain;
+    vector<double>& shares = job->shares[chunk];
+    vector<double>& matchups = job->matchups[chunk];
+    shares.assign (hero.slot.size(), 0.0);
+    matchups.assign (hero.slot.size(), 0.0);
+
+    SubsetWeights weaker (job->depth);
+    vector<int32_t> live (job->hands.size());
+    vector<CardSet> liveHands;
+    vector<PokerHandEvaluation> evals;
+    vector<uint64_t> heroKeys;
+    vector<uint64_t> villainKeys;
+    vector<double> below (hero.slot.size());
+
+    for (size_t r=first; r<last; r++)
+      {
+        // evaluate each distinct hand the runout leaves live once
+        liveHands.clear ();
+        for (size_t u=0; u<job->hands.size(); u++)
+          if (job->hands[u].disjoint (runouts[r]))
+            {
+              live[u] = static_cast<int32_t>(liveHands.size());
+              liveHands.push_back (job->hands[u]);
+            }
+          else
+            live[u] = -1;
+        job->peval->evaluateHands (liveHands, runouts[r], evals);
+        sortLive (hero, live, evals, heroKeys);
+        sortLive (villain, live, evals, villainKeys);
+
+        // sweep up in strength: for each group of equally strong hero
+        // hands, the villain weight below the group and then up to it
+        weaker.clear ();
+        size_t v = 0;
+        for (size_t h=0; h<heroKeys.size(); )
+          {
+            uint32_t code = keyCode (heroKeys[h]);
+            size_t end = h;
+            while (end < heroKeys.size() && keyCode (heroKeys[end]) == code)
+              end++;
+
+            for (; v<villainKeys.size() && keyCode (villainKeys[v]) < code; v++)
+              {
+                uint32_t e = keyEntry (villainKeys[v]);
+                weaker.add (job->hands[villain.slot[e]], villain.weight[e]);
+              }
+            for (size_t k=h; k<end; k++)
+              {
+                uint32_t e = keyEntry (heroKeys[k]);
+                below[e] = weaker.available (job->hands[hero.slot[e]]);
+              }
+            for (; v<villainKeys.size() && keyCode (villainKeys[v]) == code; v++)
+              {
+                uint32_t e = keyEntry (villainKeys[v]);
+                weaker.add (job->hands[villain.slot[e]], villain.weight[e]);
+              }
+            for (size_t k=h; k<end; k++)
+              {
+                uint32_t e = keyEntry (heroKeys[k]);
+                double upTo = weaker.available (job->hands[hero.slot[e]]);
+                shares[e] += below[e] + 0.5 * (upTo - below[e]);
+              }
+            h = end;
+          }
+
+        // every villain hand is in now, for the weight each hero meets
+        for (; v<villainKeys.size(); v++)
+          {
+            uint32_t e = keyEntry (villainKeys[v]);
+            weaker.add (job->hands[villain.slot[e]], villain.weight[e]);
+          }
+        for (size_t k=0; k<heroKeys.size(); k++)
+          {
+            uint32_t e = keyEntry (heroKeys[k]);
+            matchups[e] += weaker.available (job->hands[hero.slot[e]]);
+          }
+      }
+  }
+
+  /**
+   * the hands of dist which miss the blocked cards, as entries of the
+   * list of distinct hands, which is sorted by mask
+   */
+  void makeSparse (const CardDistribution& dist, const CardSet& blocked,
+                   const vector<uint64_t>& masks, SparseRange& range)
+  {
+    for (size_t i=0; i<dist.size(); i++)
+      {
+        if (dist[i].intersects (blocked) || dist.weight (i) <= 0.0)
+          continue;
+        range.slot.push_back (static_cast<uint32_t>(
+          lower_bound (masks.begin(), masks.end(), dist[i].mask()) - masks.begin()));
+        range.weight.push_back (dist.weight (i));
+        range.hand.push_back (static_cast<uint32_t>(i));
+      }
+  }
+}
+
+RangeEquity::RangeEquity ()
+  : shares()
+  , matchups()
+  , rangeShares(0.0)
+  , rangeMatchups(0.0)
+{}
+
+double RangeEquity::equity (size_t h) const
+{
+  return matchups[h] > 0.0 ? shares[h] / matchups[h] : 0.0;
+}
+
+double RangeEquity::equity () const
+{
+  return rangeMatchups > 0.0 ? rangeShares / rangeMatchups : 0.0;
+}
+
+RangeEquityEnumerator::RangeEquityEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                                              const CardSet& board,
+                                              const CardSet& dead)
+  : _peval(peval)
+  , _board(board)
+  , _dead(dead)
+  , _runouts()
+  , _pool(&ThreadPool::shared ())
+{
+  if (_peval->boardSize() == 0)
+    throw std::invalid_argument ("RangeEquityEnumerator: the game has no board");
+  if (_peval->evaluationSize() != 1)
+    throw std::invalid_argument ("RangeEquityEnumerator: split pot games are not supported");
+  if (_peval->handSize() > SubsetWeights::MAX_CARDS)
+    throw std::invalid_argument ("RangeEquityEnumerator: hands are too large");
+  size_t bsize = _board.size();
+  if (bsize > _peval->boardSize())
+    throw std::invalid_argument ("RangeEquityEnumerator: the board is too large");
+  size_t missing = _peval->boardSize() - bsize;
+
+  CardSet deck (((ONE64 << CardSet::STANDARD_DECK_SIZE) - 1) & ~(_board | _dead).mask());
+  vector<CardSet> cards = deck.cardSets ();
+  if (missing > cards.size())
+    throw std::invalid_argument ("RangeEquityEnumerator: not enough cards to complete the board");
+  if (missing == 0)
+    {
+      _runouts.push_back (_board);
+      return;
+    }
+
+  combinations combo (cards.size(), missing);
+  do
+    {
+      CardSet runout = _board;
+      for (size_t i=0; i<missing; i++)
+        runout |= cards[combo[i]];
+      _runouts.push_back (runout);
+    }
+  while (combo.next ());
+}
+
+void RangeEquityEnumerator::memoryFootprint (MemoryFootprint& mem) const
+{
+  mem.add ("caches", "range equity runouts", _runouts.empty() ? NULL : &_runouts[0],
+           _runouts.capacity() * sizeof(CardSet));
+}
+
+RangeEquity RangeEquityEnumerator::calculate (const CardDistribution& hero,
+                                              const CardDistribution& villain) const
+{
+  const CardSet blocked = _board | _dead;
+  RangeJob job;
+  job.peval   = _peval.get();
+  job.runouts = &_runouts;
+  job.depth   = 0;
+
+  // the distinct live hands of both ranges
+  vector<uint64_t> masks;
+  {
+    TraceSpan span ("sparse ranges", "enum");
+    for (size_t i=0; i<hero.size(); i++)
+      if (!hero[i].intersects (blocked))
+        masks.push_back (hero[i].mask());
+    for (size_t i=0; i<villain.size(); i++)
+      if (!villain[i].intersects (blocked))
+        masks.push_back (villain[i].mask());
+    sort (masks.begin(), masks.end());
+    masks.erase (unique (masks.begin(), masks.end()), masks.end());
+    for (size_t u=0; u<masks.size(); u++)
+      {
+        job.hands.push_back (CardSet (masks[u]));
+        job.depth = max (job.depth, job.hands[u].size());
+      }
+    if (job.depth > SubsetWeights::MAX_CARDS)
+      throw std::invalid_argument ("RangeEquityEnumerator: hands are too large");
+    makeSparse (hero, blocked, masks, job.hero);
+    makeSparse (villain, blocked, masks, job.villain);
+  }
+
+  job.nchunks = min (_runouts.size(), RUNOUT_CHUNKS);
+  job.shares.resize (job.nchunks);
+  job.matchups.resize (job.nchunks);
+  {
+    TaskGroup group (_pool);
+    for (size_t c=0; c<job.nchunks; c++)
+      group.run (boost::bind (runoutChunk, &job, c));
+    group.wait ();
+  }
+
+  RangeEquity ret;
+  ret.shares.assign (hero.size(), 0.0);
+  ret.matchups.assign (hero.size(), 0.0);
+  for (size_t c=0; c<job.nchunks; c++)
+    for (size_t e=0; e<job.hero.slot.size(); e++)
+      {
+        ret.shares[job.hero.hand[e]] += job.shares[c][e];
+        ret.matchups[job.hero.hand[e]] += job.matchups[c][e];
+      }
+  for (size_t e=0; e<job.hero.slot.size(); e++)
+    {
+      ret.rangeShares += job.hero.weight[e] * ret.shares[job.hero.hand[e]];
+      ret.rangeMatchups += job.hero.weight[e] * ret.matchups[job.hero.hand[e]];
+    }
+  return ret;
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_RANGEEQUITYENUMERATOR_H_
+#define PENUM_RANGEEQUITYENUMERATOR_H_
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include "CardDistribution.h"
+#include "ThreadPool.h"
+
+namespace pokerstove
+{
+  /**
+   * Heads up equity of a hero range against a villain range, per hero
+   * hand and for the whole range.  Shares are summed over every runout
+   * and every villain hand which does not conflict, weighted by the
+   * villain hand's weight, so shares/matchups is the hand's equity.
+   */
+  struct RangeEquity
+  {
+    std::vector<double> shares;          //!< per hero hand, pots won
+    std::vector<double> matchups;        //!< per hero hand, villain weight met
+    double              rangeShares;     //!< weighted by the hero hands
+    double              rangeMatchups;
+
+    RangeEquity ();
+
+    double equity (size_t h) const;
+    double equity () const;
+  };
+
+  /**
+   * Range against range equity for high games with a board, built for
+   * Omaha ranges of up to 270725 hands, where visiting every pair of
+   * hands is far too slow.
+   *
+   * For each runout, every distinct live hand of either range is
+   * evaluated once, with PokerHandEvaluator::evaluateHands, which
+   * does the work of the board once.  The hands of both ranges are
+   * then swept in order of strength: the villain hands weaker than the
+   * hero hand so far are held in SubsetWeights, and the weight of those
+   * which share no card with the hero hand follows by inclusion and
+   * exclusion over its cards.  So each runout costs one evaluation
+   * and a few table updates per hand, and a sort.
+   *
+   * Each range is kept as the index of each of its live hands in the
+   * list of distinct hands, and its weight.  The runouts are cut into
+   * at most RUNOUT_CHUNKS fixed chunks on the pool, each with its own
+   * table and hero sums, which are added in chunk order, so the result
+   * does not depend on the number of threads.
+   */
+  class RangeEquityEnumerator
+  {
+  public:
+    static const size_t RUNOUT_CHUNKS = 16;
+
+    /**
+     * Throws std::invalid_argument for a game without a board, a split
+     * pot game, or hands of more than SubsetWeights::MAX_CARDS cards.
+     */
+    RangeEquityEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                           const CardSet& board,
+                           const CardSet& dead=CardSet());
+
+    /**
+     * the pool the work is run on, ThreadPool::shared() by default; a
+     * null pool runs everything on the calling thread
+     */
+    void setPool (ThreadPool * pool) { _pool = pool; }
+    ThreadPool * pool () const { return _pool; }
+
+    size_t numRunouts () const { return _runouts.size(); }
+
+    /**
+     * equity of each hero hand, and of the hero range, against the
+     * villain range
+     */
+    RangeEquity calculate (const CardDistribution& hero,
+                           const CardDistribution& villain) const;
+
+    /**
+     * add the runout list to mem, as a cache
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+  private:
+    boost::shared_ptr<PokerHandEvaluator> _peval;
+    CardSet                               _board;
+    CardSet                               _dead;
+    std::vector<CardSet>                  _runouts;   //!< every completion of the board
+    ThreadPool *                          _pool;
+  };
+}
+
+#endif  // PENUM_RANGEEQUITYENUMERATOR_H_
@@ -0,0 +1,389 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/Rank.h>
+#include <pokerstove/peval/Suit.h>
+#include "RankShowdownEnumerator.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t RankShowdownEnumerator::ENUMERATE_CHUNKS;
+const size_t RankShowdownEnumerator::MAX_DEALT;
+
+namespace
+{
+  const int NUM_RANK = Rank::NUM_RANK;
+  const int NUM_SUIT = Suit::NUM_SUIT;
+
+  // C(n,k) for the cards of one rank
+  const uint64_t RANK_CHOOSE[NUM_SUIT+1][NUM_SUIT+1] =
+    {
+      { 1, 0, 0, 0, 0 },
+      { 1, 1, 0, 0, 0 },
+      { 1, 2, 1, 0, 0 },
+      { 1, 3, 3, 1, 0 },
+      { 1, 4, 6, 4, 1 },
+    };
+
+  double choose (size_t n, size_t k)
+  {
+    if (k > n)
+      return 0.0;
+    double ret = 1.0;
+    for (size_t i=0; i<k; i++)
+      ret = ret * (n - i) / (i + 1);
+    return ret;
+  }
+
+  /**
+   * The ranks of a player's cards to come, with at most MAX_DEALT
+   * distinct ranks, and the player's hand evaluated with them.
+   */
+  struct Pattern
+  {
+    PokerEvaluation eval;
+    uint8_t         nranks;
+    uint8_t         rank[RankShowdownEnumerator::MAX_DEALT];
+    uint8_t         count[RankShowdownEnumerator::MAX_DEALT];
+
+    bool operator> (const Pattern& other) const { return eval > other.eval; }
+
+    /**
+     * number of card deals of the pattern from the cards left of each
+     * rank, zero if there are too few
+     */
+    uint64_t deals (const int left[]) const
+    {
+      uint64_t w = 1;
+      for (int j=0; j<nranks; j++)
+        w *= RANK_CHOOSE[left[rank[j]]][count[j]];
+      return w;
+    }
+
+    void take (int left[]) const
+    {
+      for (int j=0; j<nranks; j++)
+        left[rank[j]] -= count[j];
+    }
+
+    void putBack (int left[]) const
+    {
+      for (int j=0; j<nranks; j++)
+        left[rank[j]] += count[j];
+    }
+  };
+
+  /**
+   * Every multiset of n ranks which the cards left allow, evaluated
+   * with the hand: each rank is given suits the hand does not hold.
+   */
+  void makePatterns (const PokerHandEvaluator& peval, const CardSet& hand, const int left[],
+                     int rank, size_t n, Pattern& pattern, CardSet& cards,
+                     vector<Pattern>& patterns)
+  {
+    if (n == 0)
+      {
+        pattern.eval = peval.evaluateRanks (hand | cards);
+        patterns.push_back (pattern);
+        return;
+      }
+    if (rank == NUM_RANK)
+      return;
+
+    makePatterns (peval, hand, left, rank+1, n, pattern, cards, patterns);
+    CardSet added;
+    for (int k=1; k<=left[rank] && k<=static_cast<int>(n); k++)
+      {
+        for (int s=0; s<NUM_SUIT; s++)
+          {
+            CardSet card (ONE64 << (rank + NUM_RANK*s));
+            if (!hand.contains (card) && !added.contains (card))
+              {
+                added |= card;
+                break;
+              }
+          }
+        pattern.rank[pattern.nranks]  = static_cast<uint8_t>(rank);
+        pattern.count[pattern.nranks] = static_cast<uint8_t>(k);
+        pattern.nranks++;
+        cards |= added;
+        makePatterns (peval, hand, left, rank+1, n-k, pattern, cards, patterns);
+        cards ^= added;
+        pattern.nranks--;
+      }
+  }
+
+  /**
+   * Everything the chunks of one hand combination share.
+   */
+  struct RankJob
+  {
+    size_t                   nplayers;
+    uint64_t                 unit;
+    int                      left[NUM_RANK];   //!< cards of each rank in the deck
+    vector<vector<Pattern> > patterns;         //!< per player, the last sorted strongest first
+    uint64_t                 lastDeals;        //!< deals of the last player's cards
+    vector<ShowdownResult>   results;          //!< per chunk
+
+    size_t first (size_t chunk) const
+    {
+      return patterns[0].size() * chunk / RankShowdownEnumerator::ENUMERATE_CHUNKS;
+    }
+  };
+
+  /**
+   * Settle the deals of the last player's cards after a prefix of
+   * weight deals, where the players of best hold the best hand so far.
+   * The patterns which lose are not visited.
+   */
+  void settleLast (const RankJob& job, const int left[], uint64_t deals,
+                   const PokerEvaluation& best, uint64_t bestMask,
+                   ShowdownResult& result)
+  {
+    const size_t last = job.nplayers - 1;
+    const vector<Pattern>& patterns = job.patterns[last];
+    uint64_t better = 0;
+    uint64_t tied = 0;
+    size_t nbest = 0;
+    for (size_t i=0; i<last; i++)
+      nbest += (bestMask >> i) & 1;
+
+    if (nbest == 0)
+      better = job.lastDeals;
+    else
+      for (size_t p=0; p<patterns.size() && !(patterns[p].eval < best); p++)
+        {
+          uint64_t w = patterns[p].deals (left);
+          if (patterns[p].eval > best)
+            better += w;
+          else
+            tied += w;
+        }
+    uint64_t worse = job.lastDeals - better - tied;
+
+    result.showdowns            += deals * job.lastDeals;
+    result.winUnits[last]       += deals * better * job.unit;
+    result.scoopCount[last]     += deals * better;
+    if (tied > 0)
+      {
+        uint64_t share = deals * tied * (job.unit / (nbest + 1));
+        result.tieUnits[last] += share;
+        for (size_t i=0; i<last; i++)
+          if (bestMask & (ONE64 << i))
+            result.tieUnits[i] += share;
+      }
+    if (worse > 0)
+      for (size_t i=0; i<last; i++)
+        if (bestMask & (ONE64 << i))
+          {
+            if (nbest == 1)
+              {
+                result.winUnits[i]   += deals * worse * job.unit;
+                result.scoopCount[i] += deals * worse;
+              }
+            else
+              result.tieUnits[i] += deals * worse * (job.unit / nbest);
+          }
+  }
+
+  /**
+   * visit the patterns of player i and those after, from first to last
+   * for the first player
+   */
+  void dealPlayer (const RankJob& job, size_t i, size_t first, size_t last,
+                   int left[], uint64_t deals,
+                   const PokerEvaluation& best, uint64_t bestMask,
+                   ShowdownResult& result)
+  {
+    if (i+1 == job.nplayers)
+      {
+        settleLast (job, left, deals, best, bestMask, result);
+        return;
+      }
+
+    const vector<Pattern>& patterns = job.patterns[i];
+    for (size_t p=first; p<last; p++)
+      {
+        const Pattern& pattern = patterns[p];
+        uint64_t w = pattern.deals (left);
+        if (w == 0)
+          continue;
+
+        PokerEvaluation nextBest = best;
+        uint64_t nextMask = bestMask;
+        if (bestMask == 0 || pattern.eval > best)
+          {
+            nextBest = pattern.eval;
+            nextMask = ONE64 << i;
+          }
+        else if (pattern.eval == best)
+          nextMask |= ONE64 << i;
+
+        pattern.take (left);
+        dealPlayer (job, i+1, 0, job.patterns[i+1].size(), left, deals * w,
+                    nextBest, nextMask, result);
+        pattern.putBack (left);
+      }
+  }
+
+  void rankChunk (RankJob * job, size_t chunk)
+  {
+    TraceSpan span ("rank enumerate", "enum");
+    if (span.active ())
+      span.setDetail ((boost::format("chunk %d") % chunk).str());
+    ShowdownResult& result = job->results[chunk];
+    int left[NUM_RANK];
+    copy (job->left, job->left+NUM_RANK, left);
+    if (job->nplayers == 1)
+      {
+        if (chunk == 0)
+          settleLast (*job, left, 1, PokerEvaluation(), 0, result);
+        return;
+      }
+    dealPlayer (*job, 0, job->first (chunk), job->first (chunk+1), left, 1,
+                PokerEvaluation(), 0, result);
+  }
+}
+
+RankShowdownEnumerator::RankShowdownEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                                                const vector<CardDistribution>& players,
+                                                const CardSet& dead)
+  : _peval(peval)
+  , _players(players)
+  , _dead(dead)
+  , _pool(&ThreadPool::shared ())
+  , _unit(0)
+{
+  if (_players.empty())
+    throw std::invalid_argument ("RankShowdownEnumerator: no players");
+  if (_players.size() > 64)
+    throw std::invalid_argument ("RankShowdownEnumerator: too many players");
+  if (_peval->usesSuits() || _peval->boardSize() > 0 || _peval->evaluationSize() != 1)
+    throw std::invalid_argument ("RankShowdownEnumerator: needs a high only game without suits or a board");
+
+  bool weighted = false;
+  size_t needed = _dead.size();
+  for (size_t i=0; i<_players.size(); i++)
+    {
+      if (_players[i].empty())
+        throw std::invalid_argument ("RankShowdownEnumerator: empty distribution");
+      for (size_t j=0; j<_players[i].size(); j++)
+        {
+          weighted = weighted || _players[i].weight (j) != 1.0;
+          if (_players[i][j].size() > _peval->handSize())
+            throw std::invalid_argument ("RankShowdownEnumerator: too many cards in hand");
+          if (_peval->handSize() - _players[i][j].size() > MAX_DEALT)
+            throw std::invalid_argument ("RankShowdownEnumerator: too many cards to deal");
+        }
+      needed += _peval->handSize();
+    }
+  if (needed > CardSet::STANDARD_DECK_SIZE)
+    throw std::invalid_argument ("RankShowdownEnumerator: not enough cards to deal");
+  if (!weighted)
+    _unit = PokerHandEvaluator::shareUnit (_players.size());
+}
+
+ShowdownResult RankShowdownEnumerator::enumerate () const
+{
+  const size_t nplayers = _players.size();
+  const uint64_t unit = PokerHandEvaluator::shareUnit (nplayers);
+  ShowdownResult ret (nplayers, _unit);
+
+  // visit every combination of hands which do not conflict
+  vector<size_t> combo (nplayers, 0);
+  while (true)
+    {
+      CardSet known = _dead;
+      double weight = 1.0;
+      bool conflict = false;
+      for (size_t i=0; i<nplayers && !conflict; i++)
+        {
+          const CardSet& hand = _players[i][combo[i]];
+          conflict = known.intersects (hand);
+          known |= hand;
+          weight *= _players[i].weight (combo[i]);
+        }
+
+      if (!conflict && weight > 0.0)
+        {
+          RankJob job;
+          job.nplayers = nplayers;
+          job.unit = unit;
+          for (int r=0; r<NUM_RANK; r++)
+            job.left[r] = NUM_SUIT - static_cast<int>(known.count (Rank (static_cast<uint8_t>(r))));
+
+          // the deals must count in 64 bits, in units
+          size_t deck = CardSet::STANDARD_DECK_SIZE - known.size();
+          double deals = 1.0;
+          job.patterns.resize (nplayers);
+          for (size_t i=0; i<nplayers; i++)
+            {
+              const CardSet& hand = _players[i][combo[i]];
+              size_t n = _peval->handSize() - hand.size();
+              deals *= choose (deck, n);
+              deck -= n;
+              if (i+1 == nplayers)
+                job.lastDeals = static_cast<uint64_t>(choose (deck + n, n));
+
+              Pattern pattern;
+              pattern.nranks = 0;
+              CardSet cards;
+              makePatterns (*_peval, hand, job.left, 0, n, pattern, cards, job.patterns[i]);
+            }
+          if (deals * unit >= 9.2e18)
+            throw std::runtime_error ("RankShowdownEnumerator: too many deals to count");
+          // past 64 bits of units in total, the rest adds up inexactly
+          if (ret.exact () && (deals + ret.showdowns) * unit >= 9.2e18)
+            ret.dropExact ();
+          stable_sort (job.patterns[nplayers-1].begin(), job.patterns[nplayers-1].end(),
+                       greater<Pattern>());
+
+          size_t nchunks = nplayers == 1 ? 1 : ENUMERATE_CHUNKS;
+          job.results.assign (nchunks, ShowdownResult (nplayers, unit));
+          {
+            TaskGroup group (_pool);
+            for (size_t c=0; c<nchunks; c++)
+              group.run (boost::bind (rankChunk, &job, c));
+            group.wait ();
+          }
+
+          ShowdownResult sum (nplayers, unit);
+          for (size_t c=0; c<nchunks; c++)
+            {
+              job.results[c].syncExact ();
+              sum += job.results[c];
+            }
+          if (exactShares ())
+            ret += sum;
+          else
+            {
+              // a weighted combination adds its shares in pots
+              for (size_t i=0; i<nplayers; i++)
+                {
+                  ret.shares[i].winShares += weight * sum.shares[i].winShares;
+                  ret.shares[i].tieShares += weight * sum.shares[i].tieShares;
+                  ret.scoops[i]           += weight * sum.scoops[i];
+                }
+              ret.weight    += weight * sum.weight;
+              ret.showdowns += sum.showdowns;
+            }
+        }
+
+      // next combination
+      size_t i = 0;
+      while (i < nplayers && ++combo[i] == _players[i].size())
+        combo[i++] = 0;
+      if (i == nplayers)
+        break;
+    }
+  ret.syncExact ();
+  return ret;
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_RANKSHOWDOWNENUMERATOR_H_
+#define PENUM_RANKSHOWDOWNENUMERATOR_H_
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include "CardDistribution.h"
+#include "ShowdownEnumerator.h"
+#include "ThreadPool.h"
+
+namespace pokerstove
+{
+  /**
+   * Exact equity for games where suits do not matter, whose evaluator
+   * reports usesSuits() false (razz, or A-5 and 2-7 lowball after
+   * useSuits(false) where flushes do not count), by dealing the
+   * missing cards of each player as a multiset of ranks rather than as
+   * cards.  A player's cards to come take one of at most
+   * C(16,4) = 1820 rank multisets on 3rd street of razz, where there
+   * are up to C(49,4) = 211876 sets of cards, and each multiset stands
+   * for the product over its ranks of C(left, taken) card deals, where
+   * left is the number of cards of the rank still in the deck.
+   *
+   * Each player's multisets are evaluated once per hand combination,
+   * with PokerHandEvaluator::evaluateRanks on cards of arbitrary
+   * suits.  The deals are then visited player by player, but for the
+   * last player, whose multisets are kept sorted by strength: only
+   * those which beat or tie the best hand so far are visited, and the
+   * rest, which lose, are counted as the number of deals of the
+   * remaining cards less those.
+   *
+   * The result is the one ShowdownEnumerator::enumerate() gives, and
+   * showdowns counts the card deals the multisets stand for.  It is
+   * exact when every hand has weight 1.  The first player's multisets
+   * are cut into ENUMERATE_CHUNKS fixed chunks on the pool, which add
+   * up in order, so the result does not depend on the pool.
+   */
+  class RankShowdownEnumerator
+  {
+  public:
+    static const size_t ENUMERATE_CHUNKS = 64;
+    static const size_t MAX_DEALT        = 7;    //!< cards dealt to a player
+
+    /**
+     * Throws std::invalid_argument if the evaluator uses suits, has a
+     * board, or is a split pot game, or if a player is missing more
+     * than MAX_DEALT cards.
+     */
+    RankShowdownEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                            const std::vector<CardDistribution>& players,
+                            const CardSet& dead=CardSet());
+
+    /**
+     * the pool the chunks run on, ThreadPool::shared() by default; a
+     * null pool runs them on the calling thread
+     */
+    void setPool (ThreadPool * pool) { _pool = pool; }
+    ThreadPool * pool () const { return _pool; }
+
+    size_t numPlayers () const { return _players.size(); }
+
+    /**
+     * true if enumerate() counts shares exactly, which it does when
+     * every hand has weight 1
+     */
+    bool exactShares () const { return _unit > 0; }
+
+    /**
+     * Equity over every deal.  Throws std::runtime_error if the share
+     * units of the deals of one hand combination would not fit in 64
+     * bits.  An exact result whose total would not fit is made
+     * inexact, as ShowdownResult does on adding another unit.
+     */
+    ShowdownResult enumerate () const;
+
+  private:
+    boost::shared_ptr<PokerHandEvaluator> _peval;
+    std::vector<CardDistribution>         _players;
+    CardSet                               _dead;
+    ThreadPool *                          _pool;
+    uint64_t                              _unit;
+  };
+}
+
+#endif  // PENUM_RANKSHOWDOWNENUMERATOR_H_
@@ -0,0 +1,857 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+#include <pokerstove/util/combinations.h>
+#include <pokerstove/util/philox.h>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include "ShowdownEnumerator.h"
+#include "SubsetWeights.h"
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+namespace
+{
+  const uint64_t DECK_MASK = (ONE64 << CardSet::STANDARD_DECK_SIZE) - 1;
+
+  double choose (size_t n, size_t k)
+  {
+    if (k > n)
+      return 0.0;
+    double ret = 1.0;
+    for (size_t i=0; i<k; i++)
+      ret = ret * (n - i) / (i + 1);
+    return ret;
+  }
+
+  /**
+   * The per thread state of a deal in progress.  Slots 0..n-1 are the
+   * players' hands and slot n is the board.
+   */
+  struct Deal
+  {
+    const PokerHandEvaluator *        peval;
+    vector<CardSet>                   hands;
+    CardSet                           board;
+    vector<size_t>                    missing;   //!< cards to deal to each slot
+    vector<PokerHandEvaluation>       evals;
+    uint64_t                          unit;      //!< share units of one showdown
+    vector<uint64_t>                  winUnits;  //!< one showdown
+    vector<uint64_t>                  tieUnits;
+    const vector<SidePot> *           pots;
+    vector<uint64_t>                  potUnits;  //!< one showdown, side pots
+    double                            weight;
+    ShowdownResult *                  result;
+
+    Deal (const PokerHandEvaluator * pe, size_t nplayers, ShowdownResult * r,
+          const vector<SidePot>& sidePots)
+      : peval(pe)
+      , hands(nplayers)
+      , board()
+      , missing(nplayers+1, 0)
+      , evals(nplayers)
+      , unit(PokerHandEvaluator::shareUnit (nplayers))
+      , winUnits(nplayers)
+      , tieUnits(nplayers)
+      , pots(&sidePots)
+      , potUnits(nplayers * sidePots.size())
+      , weight(1.0)
+      , result(r)
+    {}
+
+    CardSet& slot (size_t s)
+    {
+      return s < hands.size() ? hands[s] : board;
+    }
+
+    void showdown ()
+    {
+      PEVAL_COUNT(BOARDS);
+      ShowdownResult& r = *result;
+      std::fill (winUnits.begin(), winUnits.end(), 0);
+      std::fill (tieUnits.begin(), tieUnits.end(), 0);
+      peval->evaluateShowdown (hands, board, evals, winUnits, tieUnits, unit);
+      if (r.exact ())
+        {
+          // every deal has unit weight
+          for (size_t i=0; i<winUnits.size(); i++)
+            {
+              r.winUnits[i] += winUnits[i];
+              r.tieUnits[i] += tieUnits[i];
+              if (winUnits[i] == r.unit)
+                r.scoopCount[i]++;
+            }
+          if (!pots->empty())
+            PokerHandEvaluator::splitPots (evals, *pots, r.potUnits, r.unit);
+          r.showdowns++;
+          return;
+        }
+
+      // the shares of one deal are exact, before its weight
+      for (size_t i=0; i<winUnits.size(); i++)
+        {
+          r.shares[i].winShares += static_cast<double>(winUnits[i]) / unit * weight;
+          r.shares[i].tieShares += static_cast<double>(tieUnits[i]) / unit * weight;
+          if (winUnits[i] == unit)
+            r.scoops[i] += weight;
+        }
+      if (!pots->empty())
+        {
+          std::fill (potUnits.begin(), potUnits.end(), 0);
+          PokerHandEvaluator::splitPots (evals, *pots, potUnits, unit);
+          for (size_t k=0; k<potUnits.size(); k++)
+            r.potShares[k] += static_cast<double>(potUnits[k]) / unit * weight;
+        }
+      r.weight += weight;
+      r.showdowns++;
+    }
+  };
+
+  /**
+   * Deal every completion of the slots from s on.
+   */
+  void dealSlots (Deal& deal, size_t s, uint64_t deck)
+  {
+    if (s == deal.missing.size())
+      {
+        deal.showdown ();
+        return;
+      }
+
+    size_t m = deal.missing[s];
+    if (m == 0)
+      {
+        dealSlots (deal, s+1, deck);
+        return;
+      }
+
+    vector<CardSet> cards = CardSet (deck).cardSets ();
+    CardSet before = deal.slot (s);
+    combinations combo (cards.size(), m);
+    do
+      {
+        CardSet dealt;
+        for (size_t i=0; i<m; i++)
+          dealt |= cards[combo[i]];
+        deal.slot (s) = before | dealt;
+        dealSlots (deal, s+1, deck & ~dealt.mask());
+      }
+    while (combo.next ());
+    deal.slot (s) = before;
+  }
+
+  /**
+   * Deal the completions of slot s whose first depth cards, as
+   * indices into the remaining deck, are prefix[0..depth), then the
+   * slots after it.
+   */
+  void dealPrefix (Deal& deal, size_t s, uint64_t deck, size_t depth, const size_t * prefix)
+  {
+    vector<CardSet> cards = CardSet (deck).cardSets ();
+    CardSet fixed;
+    size_t start = 0;
+    for (size_t i=0; i<depth; i++)
+      {
+        fixed |= cards[prefix[i]];
+        start = prefix[i] + 1;
+      }
+
+    CardSet before = deal.slot (s);
+    size_t rest = deal.missing[s] - depth;
+    if (rest == 0)
+      {
+        deal.slot (s) = before | fixed;
+        dealSlots (deal, s+1, deck & ~fixed.mask());
+      }
+    else
+      {
+        combinations combo (cards.size() - start, rest);
+        do
+          {
+            CardSet dealt = fixed;
+            for (size_t i=0; i<rest; i++)
+              dealt |= cards[start + combo[i]];
+            deal.slot (s) = before | dealt;
+            dealSlots (deal, s+1, deck & ~dealt.mask());
+          }
+        while (combo.next ());
+      }
+    deal.slot (s) = before;
+  }
+
+  /**
+   * Complete the hands and board of a sampled deal with a partial
+   * shuffle of the cards not in used.
+   */
+  void completeDeal (Deal& deal, const CardSet& used, size_t boardMissing,
+                     Philox4x32& rng, vector<int>& deck)
+  {
+    deck.clear ();
+    for (int c=0; c<static_cast<int>(CardSet::STANDARD_DECK_SIZE); c++)
+      if (!(used.mask() & (ONE64 << c)))
+        deck.push_back (c);
+    size_t next = 0;
+    const size_t nplayers = deal.hands.size();
+    for (size_t s=0; s<=nplayers; s++)
+      {
+        size_t m = s < nplayers ? deal.peval->handSize() - deal.hands[s].size() : boardMissing;
+        for (size_t k=0; k<m; k++, next++)
+          {
+            size_t pick = next + static_cast<size_t>(rng.below (deck.size() - next));
+            swap (deck[next], deck[pick]);
+            deal.slot (s) |= CardSet (ONE64 << deck[next]);
+          }
+      }
+  }
+}
+
+const size_t   ShowdownEnumerator::ENUMERATE_CHUNKS;
+const uint64_t ShowdownEnumerator::SAMPLE_CHUNK;
+
+ShowdownResult::ShowdownResult (size_t nplayers, uint64_t u, size_t npots)
+  : shares(nplayers)
+  , scoops(nplayers, 0.0)
+  , weight(0.0)
+  , showdowns(0)
+  , unit(u)
+  , winUnits(u > 0 ? nplayers : 0, 0)
+  , tieUnits(u > 0 ? nplayers : 0, 0)
+  , scoopCount(u > 0 ? nplayers : 0, 0)
+  , potShares(npots*nplayers, 0.0)
+  , potUnits(u > 0 ? npots*nplayers : 0, 0)
+{}
+
+ShowdownResult& ShowdownResult::operator+= (const ShowdownResult& other)
+{
+  if (shares.size() < other.shares.size())
+    {
+      shares.resize (other.shares.size());
+      scoops.resize (other.scoops.size(), 0.0);
+      if (exact ())
+        {
+          winUnits.resize (shares.size(), 0);
+          tieUnits.resize (shares.size(), 0);
+          scoopCount.resize (shares.size(), 0);
+        }
+    }
+  if (potShares.size() < other.potShares.size())
+    {
+      potShares.resize (other.potShares.size(), 0.0);
+      if (exact ())
+        potUnits.resize (potShares.size(), 0);
+    }
+
+  // an empty result takes on the other's unit, a mismatch of two
+  // non empty results can only be added inexactly
+  bool empty = showdowns == 0 && weight == 0.0;
+  bool otherEmpty = other.showdowns == 0 && other.weight == 0.0;
+  if (empty && other.exact() && !exact())
+    {
+      unit = other.unit;
+      winUnits.assign (shares.size(), 0);
+      tieUnits.assign (shares.size(), 0);
+      scoopCount.assign (shares.size(), 0);
+      potUnits.assign (potShares.size(), 0);
+    }
+  else if (!otherEmpty && other.unit != unit)
+    dropExact ();
+
+  if (exact () && other.exact ())
+    {
+      for (size_t i=0; i<other.winUnits.size(); i++)
+        {
+          winUnits[i]   += other.winUnits[i];
+          tieUnits[i]   += other.tieUnits[i];
+          scoopCount[i] += other.scoopCount[i];
+        }
+      for (size_t k=0; k<other.potUnits.size(); k++)
+        potUnits[k] += other.potUnits[k];
+      showdowns += other.showdowns;
+      syncExact ();
+      return *this;
+    }
+
+  for (size_t i=0; i<other.shares.size(); i++)
+    {
+      shares[i] += other.shares[i];
+      scoops[i] += other.scoops[i];
+    }
+  for (size_t k=0; k<other.potShares.size(); k++)
+    potShares[k] += other.potShares[k];
+  weight    += other.weight;
+  showdowns += other.showdowns;
+  return *this;
+}
+
+void ShowdownResult::syncExact ()
+{
+  if (!exact ())
+    return;
+  for (size_t i=0; i<winUnits.size(); i++)
+    {
+      shares[i].winShares = static_cast<double>(winUnits[i]) / unit;
+      shares[i].tieShares = static_cast<double>(tieUnits[i]) / unit;
+      scoops[i]           = static_cast<double>(scoopCount[i]);
+    }
+  for (size_t k=0; k<potUnits.size(); k++)
+    potShares[k] = static_cast<double>(potUnits[k]) / unit;
+  weight = static_cast<double>(showdowns);
+}
+
+void ShowdownResult::dropExact ()
+{
+  unit = 0;
+  winUnits.clear ();
+  tieUnits.clear ();
+  scoopCount.clear ();
+  potUnits.clear ();
+}
+
+double ShowdownResult::equity (size_t i) const
+{
+  if (exact ())
+    return showdowns > 0
+      ? static_cast<double>(winUnits[i] + tieUnits[i]) / (static_cast<double>(unit) * showdowns)
+      : 0.0;
+  if (weight <= 0.0)
+    return 0.0;
+  return (shares[i].winShares + shares[i].tieShares) / weight;
+}
+
+double ShowdownResult::scoopEquity (size_t i) const
+{
+  if (exact ())
+    return showdowns > 0 ? static_cast<double>(scoopCount[i]) / showdowns : 0.0;
+  if (weight <= 0.0)
+    return 0.0;
+  return scoops[i] / weight;
+}
+
+double ShowdownResult::potEquity (size_t p, size_t i) const
+{
+  size_t k = p*shares.size() + i;
+  if (exact ())
+    return showdowns > 0
+      ? static_cast<double>(potUnits[k]) / (static_cast<double>(unit) * showdowns)
+      : 0.0;
+  if (weight <= 0.0)
+    return 0.0;
+  return potShares[k] / weight;
+}
+
+double ShowdownResult::winnings (size_t i, const vector<SidePot>& pots) const
+{
+  double sum = 0.0;
+  for (size_t p=0; p<pots.size() && p<numPots(); p++)
+    sum += pots[p].amount * potEquity (p, i);
+  return sum;
+}
+
+ShowdownEnumerator::ShowdownEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                                        const vector<CardDistribution>& players,
+                                        const CardSet& board,
+                                        const CardSet& dead)
+  : _peval(peval)
+  , _players(players)
+  , _board(board)
+  , _dead(dead)
+  , _pots()
+  , _pool(&ThreadPool::shared ())
+  , _unit(0)
+{
+  if (_players.empty())
+    throw std::invalid_argument ("ShowdownEnumerator: no players");
+
+  // shares are counted exactly unless some hand is weighted
+  bool weighted = false;
+  for (size_t i=0; i<_players.size(); i++)
+    for (size_t j=0; j<_players[i].size(); j++)
+      weighted = weighted || _players[i].weight (j) != 1.0;
+  if (!weighted)
+    _unit = PokerHandEvaluator::shareUnit (_players.size());
+
+  size_t needed = _board.size() + _dead.size();
+  for (size_t i=0; i<_players.size(); i++)
+    {
+      if (_players[i].empty())
+        throw std::invalid_argument ("ShowdownEnumerator: empty distribution");
+      if (_players[i].handSize() > _peval->handSize())
+        throw std::invalid_argument ("ShowdownEnumerator: too many cards in hand");
+      needed += _peval->handSize();
+    }
+  if (_board.size() < _peval->boardSize())
+    needed += _peval->boardSize() - _board.size();
+  if (needed > CardSet::STANDARD_DECK_SIZE)
+    throw std::invalid_argument ("ShowdownEnumerator: not enough cards to deal");
+}
+
+double ShowdownEnumerator::enumerationSize () const
+{
+  double size = 1.0;
+  size_t remaining = CardSet::STANDARD_DECK_SIZE - _board.size() - _dead.size();
+  for (size_t i=0; i<_players.size(); i++)
+    {
+      size *= _players[i].size();
+      remaining -= _players[i].handSize();
+    }
+  for (size_t i=0; i<_players.size(); i++)
+    {
+      size_t m = _peval->handSize() - _players[i].handSize();
+      size *= choose (remaining, m);
+      remaining -= m;
+    }
+  if (_board.size() < _peval->boardSize())
+    size *= choose (remaining, _peval->boardSize() - _board.size());
+  return size;
+}
+
+void ShowdownEnumerator::enumerateChunk (const Plan * plan, uint64_t first, uint64_t last,
+                                         ShowdownResult * result) const
+{
+  TraceSpan span ("enumerate", "enum");
+  if (span.active ())
+    span.setDetail ((boost::format("items %d-%d") % first % last).str());
+  const size_t nplayers = _players.size();
+  *result = ShowdownResult (nplayers, _unit, _pots.size());
+  const CardSet blocked = _board | _dead;
+  Deal deal (_peval.get(), nplayers, result, _pots);
+  deal.board = _board;
+  for (size_t i=0; i<nplayers; i++)
+    deal.missing[i] = _peval->handSize() - _players[i].handSize();
+  if (_board.size() < _peval->boardSize())
+    deal.missing[nplayers] = _peval->boardSize() - _board.size();
+
+  vector<size_t> idx (nplayers);
+  size_t prefix[2];
+  for (uint64_t item=first; item<last; item++)
+    {
+      // the hand combination is a mixed radix number, last player fastest
+      uint64_t combo = item / plan->prefixes;
+      for (size_t p=nplayers; p-- > 0; )
+        {
+          idx[p] = static_cast<size_t>(combo % _players[p].size());
+          combo /= _players[p].size();
+        }
+
+      CardSet used = blocked;
+      double weight = 1.0;
+      bool conflict = false;
+      for (size_t i=0; i<nplayers && !conflict; i++)
+        {
+          const CardSet& hand = _players[i][idx[i]];
+          if (hand.intersects (used))
+            conflict = true;
+          used |= hand;
+          deal.hands[i] = hand;
+          weight *= _players[i].weight (idx[i]);
+        }
+      if (conflict)
+        continue;
+
+      deal.weight = weight;
+      uint64_t deck = DECK_MASK & ~used.mask();
+      if (plan->firstSlot > nplayers)
+        deal.showdown ();
+      else if (plan->depth == 0)
+        dealSlots (deal, 0, deck);
+      else
+        {
+          plan->prefix (item % plan->prefixes, deal.missing[plan->firstSlot], prefix);
+          dealPrefix (deal, plan->firstSlot, deck, plan->depth, prefix);
+        }
+    }
+  result->syncExact ();
+  if (span.active ())
+    span.setDetail ((boost::format("items %d-%d showdowns %d") % first % last % result->showdowns).str());
+}
+
+void ShowdownEnumerator::makePlan (Plan& plan) const
+{
+  const size_t nplayers = _players.size();
+  plan.ncombinations = 1;
+  plan.deckSize = CardSet::STANDARD_DECK_SIZE - _board.size() - _dead.size();
+  for (size_t i=0; i<nplayers; i++)
+    {
+      if (plan.ncombinations > numeric_limits<uint64_t>::max() / _players[i].size())
+        throw std::invalid_argument ("ShowdownEnumerator: too many hand combinations to enumerate");
+      plan.ncombinations *= _players[i].size();
+      plan.deckSize -= _players[i].handSize();
+    }
+
+  // split the first slot which is dealt cards until there are enough
+  // items for ENUMERATE_CHUNKS chunks
+  plan.firstSlot = nplayers + 1;
+  for (size_t s=0; s<=nplayers && plan.firstSlot > nplayers; s++)
+    {
+      size_t m = s < nplayers ? _peval->handSize() - _players[s].handSize()
+        : (_board.size() < _peval->boardSize() ? _peval->boardSize() - _board.size() : 0);
+      if (m > 0)
+        plan.firstSlot = s;
+    }
+  plan.depth = 0;
+  plan.prefixes = 1;
+  if (plan.firstSlot <= nplayers)
+    {
+      size_t m = plan.firstSlot < nplayers
+        ? _peval->handSize() - _players[plan.firstSlot].handSize()
+        : _peval->boardSize() - _board.size();
+      uint64_t firstCards = plan.deckSize - m + 1;
+      while (plan.depth < min<size_t> (m, 2) && plan.ncombinations * plan.prefixes < ENUMERATE_CHUNKS)
+        {
+          plan.depth++;
+          plan.prefixes = plan.depth == 1 ? firstCards : firstCards * (firstCards + 1) / 2;
+        }
+    }
+
+}
+
+void ShowdownEnumerator::setPots (const vector<SidePot>& pots)
+{
+  uint64_t players = _players.size() < 64 ? (ONE64 << _players.size()) - 1 : ~static_cast<uint64_t>(0);
+  for (size_t p=0; p<pots.size(); p++)
+    if (pots[p].eligible == 0 || (pots[p].eligible & ~players) != 0)
+      throw std::invalid_argument ("ShowdownEnumerator: a pot's eligible players are not in the showdown");
+  _pots = pots;
+}
+
+uint64_t ShowdownEnumerator::enumerateChunks () const
+{
+  Plan plan;
+  makePlan (plan);
+  return min<uint64_t> (plan.size(), ENUMERATE_CHUNKS);
+}
+
+vector<ShowdownResult> ShowdownEnumerator::enumerateRange (uint64_t first, uint64_t last) const
+{
+  Plan plan;
+  makePlan (plan);
+  uint64_t nitems = plan.size();
+  uint64_t nchunks = min<uint64_t> (nitems, ENUMERATE_CHUNKS);
+  if (first > last || last > nchunks)
+    throw std::invalid_argument ("ShowdownEnumerator: chunk range out of bounds");
+
+  vector<ShowdownResult> results (last-first, ShowdownResult (_players.size()));
+  TaskGroup group (_pool);
+  for (uint64_t c=first; c<last; c++)
+    group.run (boost::bind (&ShowdownEnumerator::enumerateChunk, this, &plan,
+                            plan.chunkBegin (c, nchunks), plan.chunkBegin (c+1, nchunks),
+                            &results[c-first]));
+  group.wait ();
+  return results;
+}
+
+ShowdownResult ShowdownEnumerator::enumerate () const
+{
+  return merge (enumerateRange (0, enumerateChunks ()), _players.size());
+}
+
+ShowdownResult ShowdownEnumerator::merge (const vector<ShowdownResult>& chunks, size_t nplayers)
+{
+  TraceSpan span ("merge", "merge");
+  ShowdownResult total (nplayers);
+  for (size_t c=0; c<chunks.size(); c++)
+    total += chunks[c];
+  return total;
+}
+
+void ShowdownEnumerator::sampleChunk (const vector<vector<double> > * cumulative,
+                                      uint64_t first, uint64_t last, uint32_t seed,
+                                      ShowdownResult * result) const
+{
+  TraceSpan span ("sample", "enum");
+  if (span.active ())
+    span.setDetail ((boost::format("deals %d-%d") % first % last).str());
+  const size_t nplayers = _players.size();
+  const CardSet blocked = _board | _dead;
+
+  // sampled deals all have unit weight
+  *result = ShowdownResult (nplayers, PokerHandEvaluator::shareUnit (nplayers), _pots.size());
+  Deal deal (_peval.get(), nplayers, result, _pots);
+  size_t boardMissing = _board.size() < _peval->boardSize() ? _peval->boardSize() - _board.size() : 0;
+  vector<int> deck;
+  for (uint64_t trial=first; trial<last; )
+    {
+      // a deal which collides is redrawn from the rest of its stream
+      Philox4x32 rng (seed, trial);
+      CardSet used;
+      bool conflict = true;
+      while (conflict)
+        {
+          used = blocked;
+          conflict = false;
+          for (size_t i=0; i<nplayers && !conflict; i++)
+            {
+              const vector<double>& cw = (*cumulative)[i];
+              size_t j = lower_bound (cw.begin(), cw.end(), rng.uniform () * cw.back()) - cw.begin();
+              const CardSet& hand = _players[i][min (j, cw.size()-1)];
+              if (hand.intersects (used))
+                conflict = true;
+              used |= hand;
+              deal.hands[i] = hand;
+            }
+        }
+
+      deal.board = _board;
+      completeDeal (deal, used, boardMissing, rng, deck);
+      deal.weight = 1.0;
+      deal.showdown ();
+      trial++;
+    }
+  result->syncExact ();
+}
+
+void ShowdownEnumerator::memoryFootprint (MemoryFootprint& mem) const
+{
+  for (size_t i=0; i<_players.size(); i++)
+    _players[i].memoryFootprint (mem, (boost::format("player %d") % i).str());
+}
+
+/**
+ * true if players order[k..] can be dealt hands of positive weight
+ * which miss used and each other
+ */
+bool ShowdownEnumerator::dealable (const vector<size_t>& order, size_t k, const CardSet& used) const
+{
+  if (k == order.size())
+    return true;
+  const CardDistribution& range = _players[order[k]];
+  for (size_t j=0; j<range.size(); j++)
+    if (range.weight (j) > 0.0 && !range[j].intersects (used)
+        && dealable (order, k+1, used | range[j]))
+      return true;
+  return false;
+}
+
+/**
+ * Cumulative weights for drawing hands in proportion to their weight.
+ * Throws std::invalid_argument if the ranges admit no deal, where the
+ * redraws of sampleChunk would never end.
+ */
+void ShowdownEnumerator::cumulativeWeights (vector<vector<double> >& cumulative) const
+{
+  // narrowest range first, so a dead end shows early
+  vector<size_t> order (_players.size());
+  for (size_t k=0; k<order.size(); k++)
+    {
+      order[k] = k;
+      for (size_t m=k; m>0 && _players[order[m]].size() < _players[order[m-1]].size(); m--)
+        swap (order[m], order[m-1]);
+    }
+  if (!dealable (order, 0, _board | _dead))
+    throw std::invalid_argument ("ShowdownEnumerator: the ranges admit no deal");
+
+  cumulative.assign (_players.size(), vector<double> ());
+  for (size_t i=0; i<_players.size(); i++)
+    {
+      double sum = 0.0;
+      for (size_t j=0; j<_players[i].size(); j++)
+        {
+          sum += _players[i].weight (j);
+          cumulative[i].push_back (sum);
+        }
+    }
+}
+
+vector<ShowdownResult> ShowdownEnumerator::sampleDeals (uint64_t offset, uint64_t trials, uint32_t seed,
+                                                        uint64_t first, uint64_t last) const
+{
+  const size_t nplayers = _players.size();
+  if (first > last || last > sampleChunks (trials))
+    throw std::invalid_argument ("ShowdownEnumerator: chunk range out of bounds");
+
+  vector<vector<double> > cumulative;
+  cumulativeWeights (cumulative);
+
+  vector<ShowdownResult> results (last-first, ShowdownResult (nplayers));
+  TaskGroup group (_pool);
+  for (uint64_t c=first; c<last; c++)
+    group.run (boost::bind (&ShowdownEnumerator::sampleChunk, this, &cumulative,
+                            offset + c*SAMPLE_CHUNK,
+                            offset + min (trials, (c+1)*SAMPLE_CHUNK),
+                            seed, &results[c-first]));
+  group.wait ();
+  return results;
+}
+
+uint64_t ShowdownEnumerator::sampleChunks (uint64_t trials)
+{
+  return (trials + SAMPLE_CHUNK - 1) / SAMPLE_CHUNK;
+}
+
+vector<ShowdownResult> ShowdownEnumerator::sampleRange (uint64_t trials, uint32_t seed,
+                                                        uint64_t first, uint64_t last) const
+{
+  return sampleDeals (0, trials, seed, first, last);
+}
+
+ShowdownResult ShowdownEnumerator::sample (uint64_t trials, uint32_t seed, uint64_t first) const
+{
+  return merge (sampleDeals (first, trials, seed, 0, sampleChunks (trials)), _players.size());
+}
+
+/**
+ * A player's range for sequential sampling: cumulative weights to
+ * draw from, and SubsetWeights to find the weight left available by
+ * the cards already out.  Ranges of hands too long for the table are
+ * scanned instead.
+ */
+struct ShowdownEnumerator::RemovalTable
+{
+  static const size_t REDRAW_LIMIT = 16;     //!< redraw while 1/16 of the range is available
+
+  const CardDistribution * range;
+  vector<double>           cumulative;
+  double                   total;
+  bool                     scan;
+  SubsetWeights            holding;
+
+  explicit RemovalTable (const CardDistribution& r)
+    : range(&r)
+    , cumulative()
+    , total(0.0)
+    , scan(r.handSize() > SubsetWeights::MAX_CARDS)
+    , holding(scan ? 0 : r.handSize())
+  {
+    for (size_t j=0; j<r.size(); j++)
+      {
+        total += r.weight (j);
+        cumulative.push_back (total);
+        if (!scan)
+          holding.add (r[j], r.weight (j));
+      }
+  }
+
+  /**
+   * weight of the hands which miss every card of used
+   */
+  double available (const CardSet& used) const
+  {
+    if (!scan)
+      return holding.available (used);
+    double sum = 0.0;
+    for (size_t j=0; j<range->size(); j++)
+      if (!(*range)[j].intersects (used))
+        sum += range->weight (j);
+    return sum;
+  }
+
+  /**
+   * A hand which misses used, drawn in proportion to its weight.
+   * While most of the range is available the draw is redrawn until it
+   * misses, otherwise the available hands are scanned.
+   */
+  size_t draw (const CardSet& used, double avail, Philox4x32& rng) const
+  {
+    if (avail * REDRAW_LIMIT >= total)
+      while (true)
+        {
+          size_t j = lower_bound (cumulative.begin(), cumulative.end(), rng.uniform () * total)
+            - cumulative.begin();
+          j = min (j, cumulative.size()-1);
+          if (!(*range)[j].intersects (used))
+            return j;
+        }
+
+    double r = rng.uniform () * avail;
+    size_t last = 0;
+    for (size_t j=0; j<range->size(); j++)
+      {
+        if ((*range)[j].intersects (used) || range->weight (j) <= 0.0)
+          continue;
+        last = j;
+        if (r < range->weight (j))
+          return j;
+        r -= range->weight (j);
+      }
+    return last;
+  }
+};
+
+const size_t ShowdownEnumerator::RemovalTable::REDRAW_LIMIT;
+
+void ShowdownEnumerator::sequentialChunk (const vector<RemovalTable> * tables,
+                                          const vector<size_t> * order,
+                                          uint64_t first, uint64_t last, uint32_t seed,
+                                          ShowdownResult * result) const
+{
+  TraceSpan span ("sample", "enum");
+  if (span.active ())
+    span.setDetail ((boost::format("sequential deals %d-%d") % first % last).str());
+  const size_t nplayers = _players.size();
+  const CardSet blocked = _board | _dead;
+  // below this fraction of its weight, a range counts as blocked,
+  // which only rounding leaves behind
+  const double epsilon = 1e-12;
+
+  // deals carry importance weights, so the shares are not exact
+  *result = ShowdownResult (nplayers, 0, _pots.size());
+  Deal deal (_peval.get(), nplayers, result, _pots);
+  size_t boardMissing = _board.size() < _peval->boardSize() ? _peval->boardSize() - _board.size() : 0;
+  vector<int> deck;
+  for (uint64_t trial=first; trial<last; trial++)
+    {
+      Philox4x32 rng (seed, trial);
+      CardSet used = blocked;
+      double weight = 1.0;
+      for (size_t k=0; k<nplayers && weight > 0.0; k++)
+        {
+          size_t i = (*order)[k];
+          const RemovalTable& table = (*tables)[i];
+          double avail = table.available (used);
+          if (avail <= table.total * epsilon)
+            {
+              // the earlier hands block the whole range
+              weight = 0.0;
+              break;
+            }
+          deal.hands[i] = _players[i][table.draw (used, avail, rng)];
+          used |= deal.hands[i];
+          weight *= avail / table.total;
+        }
+      if (weight <= 0.0)
+        continue;
+
+      deal.board = _board;
+      completeDeal (deal, used, boardMissing, rng, deck);
+      deal.weight = weight;
+      deal.showdown ();
+    }
+}
+
+ShowdownResult ShowdownEnumerator::sampleSequential (uint64_t trials, uint32_t seed, uint64_t first) const
+{
+  const size_t nplayers = _players.size();
+  vector<RemovalTable> tables;
+  vector<size_t> order;
+  {
+    TraceSpan span ("removal tables", "enum");
+    for (size_t i=0; i<nplayers; i++)
+      {
+        tables.push_back (RemovalTable (_players[i]));
+        order.push_back (i);
+      }
+  }
+  // the narrowest ranges go first, while the fewest cards are out
+  for (size_t k=1; k<nplayers; k++)
+    for (size_t m=k; m>0 && _players[order[m]].size() < _players[order[m-1]].size(); m--)
+      swap (order[m], order[m-1]);
+
+  uint64_t nchunks = sampleChunks (trials);
+  vector<ShowdownResult> results (nchunks, ShowdownResult (nplayers));
+  TaskGroup group (_pool);
+  for (uint64_t c=0; c<nchunks; c++)
+    group.run (boost::bind (&ShowdownEnumerator::sequentialChunk, this, &tables, &order,
+                            first + c*SAMPLE_CHUNK, first + min (trials, (c+1)*SAMPLE_CHUNK),
+                            seed, &results[c]));
+  group.wait ();
+  return merge (results, nplayers);
+}
@@ -0,0 +1,275 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_SHOWDOWNENUMERATOR_H_
+#define PENUM_SHOWDOWNENUMERATOR_H_
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include "CardDistribution.h"
+#include "ThreadPool.h"
+
+namespace pokerstove
+{
+  class EquityJob;
+
+  /**
+   * Accumulated outcome of a set of showdowns.  Shares are weighted
+   * by the product of the hand weights, so equity(i) is the share of
+   * the pot player i expects.  A scoop is a showdown where the player
+   * wins every pot outright.
+   *
+   * When every showdown has unit weight, the result is exact: shares
+   * are counted as integers, in units of 1/unit of a pot (see
+   * PokerHandEvaluator::shareUnit), and the doubles are derived from
+   * the counts.  Exact results add up the same in any order, so
+   * merges across chunks, threads and shards do not depend on it.
+   * Adding an inexact result makes the sum inexact.
+   *
+   * With side pots (see ShowdownEnumerator::setPots), the share of
+   * each pot taken by each player is kept as well, in units when the
+   * result is exact.
+   */
+  struct ShowdownResult
+  {
+    std::vector<EquityResult> shares;
+    std::vector<double>       scoops;
+    double                    weight;      //!< total weight of the showdowns
+    uint64_t                  showdowns;   //!< number of showdowns evaluated
+
+    uint64_t                  unit;        //!< share units per pot, zero if inexact
+    std::vector<uint64_t>     winUnits;
+    std::vector<uint64_t>     tieUnits;
+    std::vector<uint64_t>     scoopCount;
+
+    std::vector<double>       potShares;   //!< of pot p by player i at p*nplayers+i
+    std::vector<uint64_t>     potUnits;    //!< the same in units, if exact
+
+    explicit ShowdownResult (size_t nplayers=0, uint64_t unit=0, size_t npots=0);
+
+    ShowdownResult& operator+= (const ShowdownResult& other);
+
+    bool exact () const { return unit > 0; }
+
+    /**
+     * set the shares, scoops and weight from the exact counts
+     */
+    void syncExact ();
+
+    /**
+     * keep only the doubles, as when adding a result of another unit
+     */
+    void dropExact ();
+
+    double equity (size_t i) const;
+    double scoopEquity (size_t i) const;
+
+    size_t numPots () const { return shares.empty() ? 0 : potShares.size() / shares.size(); }
+
+    /**
+     * the share of pot p player i expects
+     */
+    double potEquity (size_t p, size_t i) const;
+
+    /**
+     * the amount player i expects to take from the pots
+     */
+    double winnings (size_t i, const std::vector<SidePot>& pots) const;
+  };
+
+  /**
+   * Equity of several players, each holding a CardDistribution, by
+   * visiting every deal of the cards still to come.  Players whose
+   * hands are short of the game's hand size (stud) get their missing
+   * cards dealt, as does the board.
+   *
+   * The deals are the product of the hand combinations and the ways
+   * of completing each of them.  This space is flattened, down to the
+   * first cards of the first completion step when there are only a few
+   * combinations, and cut into a fixed number of chunks which run on a
+   * ThreadPool.  So a single matchup such as AA vs KK still spreads
+   * over every thread, and the results do not depend on the pool.
+   *
+   * When the space is too large, sample() plays random deals instead.
+   */
+  class ShowdownEnumerator
+  {
+  public:
+    static const size_t   ENUMERATE_CHUNKS = 1024;
+    static const uint64_t SAMPLE_CHUNK     = 16384;
+
+    ShowdownEnumerator (boost::shared_ptr<PokerHandEvaluator> peval,
+                        const std::vector<CardDistribution>& players,
+                        const CardSet& board=CardSet(),
+                        const CardSet& dead=CardSet());
+
+    /**
+     * The pool the chunks run on, ThreadPool::shared() by default.  A
+     * null pool runs them on the calling thread.
+     */
+    void setPool (ThreadPool * pool) { _pool = pool; }
+    ThreadPool * pool () const { return _pool; }
+
+    size_t numPlayers () const { return _players.size(); }
+
+    /**
+     * Side pots to settle at each showdown, besides the pot all the
+     * players contest which equity() reports.  Each hand is still
+     * evaluated once per deal, and the results get the share of every
+     * pot of every player, so one enumeration reports the equity of
+     * each pot of an all in.
+     */
+    void setPots (const std::vector<SidePot>& pots);
+    const std::vector<SidePot>& pots () const { return _pots; }
+
+    /**
+     * true if enumerate() counts shares exactly, which it does when
+     * every hand has weight 1; sample() always does
+     */
+    bool exactShares () const { return _unit > 0; }
+
+    /**
+     * Number of showdowns enumerate() will evaluate, counting
+     * conflicting hand combinations.
+     */
+    double enumerationSize () const;
+
+    /**
+     * Exact equity over every deal.  Throws std::invalid_argument if
+     * the hand combinations do not count in 64 bits.
+     */
+    ShowdownResult enumerate () const;
+
+    /**
+     * Monte Carlo equity over deals first to first+trials-1 of the
+     * sequence for seed.  Deal t draws from its own Philox4x32 stream
+     * (seed, t), so it is the same deal whichever chunk, thread, shard
+     * or machine makes it, and results repeat bit for bit for a given
+     * seed whatever the pool.  Shards [0,k) and [k,n) add up to the
+     * run of n deals, to within the rounding of the merge.  Throws
+     * std::invalid_argument if the ranges admit no deal.
+     */
+    ShowdownResult sample (uint64_t trials, uint32_t seed=0, uint64_t first=0) const;
+
+    /**
+     * Monte Carlo equity for ranges which block each other, where
+     * sample() redraws most deals.  Each deal draws the players' hands
+     * in turn, narrowest range first, each from the hands the cards
+     * already out leave, and carries the product over the players of
+     * the fraction of their range's weight which was left, so the
+     * weighted deals follow the joint distribution of the ranges.
+     * The result is the ratio of weighted shares to total weight, so
+     * it is not exact, and weight/trials estimates the chance that
+     * independent draws from the ranges do not collide; it is zero
+     * when the ranges admit no deal.
+     * Deals are numbered and streamed as for sample(), though they
+     * differ from its deals.
+     */
+    ShowdownResult sampleSequential (uint64_t trials, uint32_t seed=0, uint64_t first=0) const;
+
+    /**
+     * enumerate() and sample() split their work into a fixed list of
+     * chunks, which does not depend on the pool.  These run chunks
+     * [first, last) of it and return each chunk's result, so a job can
+     * be spread over processes or hosts, and merging every chunk in
+     * order gives bit for bit the result of the single call.  See
+     * ShowdownShard.
+     */
+    uint64_t enumerateChunks () const;
+    std::vector<ShowdownResult> enumerateRange (uint64_t first, uint64_t last) const;
+    static uint64_t sampleChunks (uint64_t trials);
+    std::vector<ShowdownResult> sampleRange (uint64_t trials, uint32_t seed,
+                                             uint64_t first, uint64_t last) const;
+
+    /**
+     * sum of chunk results, in order
+     */
+    static ShowdownResult merge (const std::vector<ShowdownResult>& chunks, size_t nplayers);
+
+    /**
+     * add each player's distribution to mem
+     */
+    void memoryFootprint (MemoryFootprint& mem) const;
+
+  private:
+    friend class EquityJob;
+
+    /**
+     * How enumerate() flattens the deals.  Item i of the flat space
+     * is hand combination i / prefixes, dealing prefix i % prefixes
+     * of the first slot which needs cards.
+     */
+    struct Plan
+    {
+      uint64_t ncombinations;
+      size_t   firstSlot;          //!< nplayers+1 if nothing is dealt
+      size_t   depth;              //!< cards of the first slot fixed per item
+      size_t   deckSize;           //!< cards left once the hands are out
+      uint64_t prefixes;
+
+      uint64_t size () const { return ncombinations * prefixes; }
+
+      /**
+       * the first item of chunk c of n, c*size()/n without overflow
+       */
+      uint64_t chunkBegin (uint64_t c, uint64_t n) const
+      {
+        return c * (size() / n) + c * (size() % n) / n;
+      }
+
+      /**
+       * the first cards of prefix p, in the order combinations deals them
+       */
+      void prefix (uint64_t p, size_t m, size_t * out) const
+      {
+        if (depth == 0)
+          return;
+        if (depth == 1)
+          {
+            out[0] = static_cast<size_t>(p);
+            return;
+          }
+        size_t i0 = 0;
+        while (p >= deckSize - m + 1 - i0)
+          {
+            p -= deckSize - m + 1 - i0;
+            i0++;
+          }
+        out[0] = i0;
+        out[1] = i0 + 1 + static_cast<size_t>(p);
+      }
+    };
+
+    void makePlan (Plan& plan) const;
+
+    void enumerateChunk (const Plan * plan, uint64_t first, uint64_t last,
+                         ShowdownResult * result) const;
+    void sampleChunk (const std::vector<std::vector<double> > * cumulative,
+                      uint64_t first, uint64_t last, uint32_t seed,
+                      ShowdownResult * result) const;
+    struct RemovalTable;
+
+    void sequentialChunk (const std::vector<RemovalTable> * tables,
+                          const std::vector<size_t> * order,
+                          uint64_t first, uint64_t last, uint32_t seed,
+                          ShowdownResult * result) const;
+    bool dealable (const std::vector<size_t>& order, size_t k, const CardSet& used) const;
+    void cumulativeWeights (std::vector<std::vector<double> >& cumulative) const;
+    std::vector<ShowdownResult> sampleDeals (uint64_t offset, uint64_t trials, uint32_t seed,
+                                             uint64_t first, uint64_t last) const;
+
+    boost::shared_ptr<PokerHandEvaluator> _peval;
+    std::vector<CardDistribution>         _players;
+    CardSet                               _board;
+    CardSet                               _dead;
+    std::vector<SidePot>                  _pots;
+    ThreadPool *                          _pool;
+    uint64_t                              _unit;     //!< of exact results, zero if weighted
+  };
+}
+
+#endif  // PENUM_SHOWDOWNENUMERATOR_H_
@@ -0,0 +1,377 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include "ShowdownShard.h"
+
+using namespace std;
+using namespace pokerstove;
+
+static const char     SHARD_MAGIC[4] = { 'P', 'S', 'S', 'D' };
+static const uint32_t SHARD_VERSION  = 3;   //!< version 1 has no exact counts, 2 no pots
+
+namespace
+{
+  /**
+   * little endian serialization into and out of a byte buffer, so
+   * that the checksum can cover the whole file
+   */
+  class Packer
+  {
+  public:
+    void u32 (uint32_t v)
+    {
+      for (int i=0; i<4; i++)
+        _bytes.push_back (static_cast<uint8_t>(v >> (8*i)));
+    }
+
+    void u64 (uint64_t v)
+    {
+      u32 (static_cast<uint32_t>(v));
+      u32 (static_cast<uint32_t>(v >> 32));
+    }
+
+    void f64 (double d)
+    {
+      uint64_t v;
+      memcpy (&v, &d, sizeof(v));
+      u64 (v);
+    }
+
+    void str (const string& s)
+    {
+      u32 (static_cast<uint32_t>(s.size()));
+      _bytes.insert (_bytes.end(), s.begin(), s.end());
+    }
+
+    vector<uint8_t>& bytes () { return _bytes; }
+
+  private:
+    vector<uint8_t> _bytes;
+  };
+
+  class Unpacker
+  {
+  public:
+    Unpacker (const vector<uint8_t>& bytes, size_t begin, size_t end)
+      : _bytes(bytes)
+      , _pos(begin)
+      , _end(end)
+    {}
+
+    uint32_t u32 ()
+    {
+      need (4);
+      uint32_t v = 0;
+      for (int i=0; i<4; i++)
+        v |= static_cast<uint32_t>(_bytes[_pos++]) << (8*i);
+      return v;
+    }
+
+    uint64_t u64 ()
+    {
+      uint64_t lo = u32 ();
+      uint64_t hi = u32 ();
+      return lo | (hi << 32);
+    }
+
+    double f64 ()
+    {
+      uint64_t v = u64 ();
+      double d;
+      memcpy (&d, &v, sizeof(d));
+      return d;
+    }
+
+    string str ()
+    {
+      uint32_t n = u32 ();
+      need (n);
+      string s (_bytes.begin() + _pos, _bytes.begin() + _pos + n);
+      _pos += n;
+      return s;
+    }
+
+    bool done () const { return _pos == _end; }
+
+  private:
+    void need (size_t n)
+    {
+      if (_end - _pos < n)
+        throw std::runtime_error ("ShowdownShard: unexpected end of file");
+    }
+
+    const vector<uint8_t>& _bytes;
+    size_t                 _pos;
+    size_t                 _end;
+  };
+
+  // FNV-1a, as for the equity matrix chunks
+  uint32_t checksum (const uint8_t * p, size_t n)
+  {
+    uint32_t h = 2166136261u;
+    for (size_t i=0; i<n; i++)
+      {
+        h ^= p[i];
+        h *= 16777619u;
+      }
+    return h;
+  }
+
+  void packJob (Packer& out, const ShowdownShard& s)
+  {
+    out.str (s.game);
+    out.str (s.board);
+    out.str (s.dead);
+    out.u32 (static_cast<uint32_t>(s.ranges.size()));
+    for (size_t i=0; i<s.ranges.size(); i++)
+      out.str (s.ranges[i]);
+    out.u64 (s.trials);
+    out.u32 (s.seed);
+    out.u64 (s.totalChunks);
+    out.u32 (static_cast<uint32_t>(s.pots.size()));
+    for (size_t p=0; p<s.pots.size(); p++)
+      {
+        out.f64 (s.pots[p].amount);
+        out.u64 (s.pots[p].eligible);
+      }
+  }
+
+  bool samePots (const vector<SidePot>& a, const vector<SidePot>& b)
+  {
+    if (a.size() != b.size())
+      return false;
+    for (size_t p=0; p<a.size(); p++)
+      if (a[p].amount != b[p].amount || a[p].eligible != b[p].eligible)
+        return false;
+    return true;
+  }
+
+  bool byFirstChunk (const ShowdownShard * a, const ShowdownShard * b)
+  {
+    return a->firstChunk < b->firstChunk;
+  }
+
+  /**
+   * the shards in chunk order, which must all be of one job
+   */
+  vector<const ShowdownShard*> sortedShards (const vector<ShowdownShard>& shards)
+  {
+    vector<const ShowdownShard*> sorted;
+    uint64_t job = shards.empty() ? 0 : shards[0].jobId ();
+    for (size_t i=0; i<shards.size(); i++)
+      {
+        if (shards[i].jobId () != job)
+          throw std::runtime_error ("ShowdownShard: shards of different jobs");
+        sorted.push_back (&shards[i]);
+      }
+    sort (sorted.begin(), sorted.end(), byFirstChunk);
+    return sorted;
+  }
+}
+
+uint64_t ShowdownShard::jobId () const
+{
+  Packer job;
+  packJob (job, *this);
+  // 64 bit FNV-1a
+  uint64_t h = 14695981039346656037uLL;
+  const vector<uint8_t>& b = job.bytes ();
+  for (size_t i=0; i<b.size(); i++)
+    {
+      h ^= b[i];
+      h *= 1099511628211uLL;
+    }
+  return h;
+}
+
+pair<uint64_t,uint64_t> ShowdownShard::shardRange (uint64_t total, uint64_t k, uint64_t n)
+{
+  if (n == 0 || k >= n)
+    throw std::invalid_argument ("ShowdownShard: shard out of range");
+  // the product can not overflow for any realistic chunk count
+  return make_pair (total * k / n, total * (k+1) / n);
+}
+
+void ShowdownShard::run (const ShowdownEnumerator& enumerator, uint64_t first, uint64_t last)
+{
+  if (ranges.size() != enumerator.numPlayers() || !samePots (pots, enumerator.pots()))
+    throw std::invalid_argument ("ShowdownShard: the job and the enumerator differ");
+  totalChunks = trials > 0 ? ShowdownEnumerator::sampleChunks (trials)
+                           : enumerator.enumerateChunks ();
+  firstChunk  = first;
+  chunks      = trials > 0 ? enumerator.sampleRange (trials, seed, first, last)
+                           : enumerator.enumerateRange (first, last);
+}
+
+void ShowdownShard::write (ostream& out) const
+{
+  Packer p;
+  p.bytes().insert (p.bytes().end(), SHARD_MAGIC, SHARD_MAGIC+4);
+  p.u32 (SHARD_VERSION);
+  packJob (p, *this);
+  p.u64 (firstChunk);
+  p.u64 (chunks.size());
+  for (size_t c=0; c<chunks.size(); c++)
+    {
+      const ShowdownResult& r = chunks[c];
+      p.f64 (r.weight);
+      p.u64 (r.showdowns);
+      for (size_t i=0; i<ranges.size(); i++)
+        {
+          p.f64 (i < r.shares.size() ? r.shares[i].winShares : 0.0);
+          p.f64 (i < r.shares.size() ? r.shares[i].tieShares : 0.0);
+          p.f64 (i < r.scoops.size() ? r.scoops[i] : 0.0);
+        }
+      size_t npot = pots.size() * ranges.size();
+      for (size_t k=0; k<npot; k++)
+        p.f64 (k < r.potShares.size() ? r.potShares[k] : 0.0);
+      p.u64 (r.unit);
+      if (r.exact ())
+        {
+          for (size_t i=0; i<ranges.size(); i++)
+            {
+              p.u64 (i < r.winUnits.size() ? r.winUnits[i] : 0);
+              p.u64 (i < r.tieUnits.size() ? r.tieUnits[i] : 0);
+              p.u64 (i < r.scoopCount.size() ? r.scoopCount[i] : 0);
+            }
+          for (size_t k=0; k<npot; k++)
+            p.u64 (k < r.potUnits.size() ? r.potUnits[k] : 0);
+        }
+    }
+  p.u32 (checksum (&p.bytes()[0], p.bytes().size()));
+  out.write (reinterpret_cast<const char*>(&p.bytes()[0]), p.bytes().size());
+  if (!out)
+    throw std::runtime_error ("ShowdownShard: write failed");
+}
+
+ShowdownShard ShowdownShard::read (istream& in)
+{
+  vector<uint8_t> bytes ((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  if (bytes.size() < 12 || memcmp (&bytes[0], SHARD_MAGIC, 4) != 0)
+    throw std::runtime_error ("ShowdownShard: not a shard file");
+
+  size_t body = bytes.size() - 4;
+  uint32_t stored = 0;
+  for (int i=0; i<4; i++)
+    stored |= static_cast<uint32_t>(bytes[body+i]) << (8*i);
+  if (stored != checksum (&bytes[0], body))
+    throw std::runtime_error ("ShowdownShard: checksum mismatch");
+
+  Unpacker p (bytes, 4, body);
+  uint32_t version = p.u32 ();
+  if (version < 1 || version > SHARD_VERSION)
+    throw std::runtime_error ("ShowdownShard: unsupported version");
+
+  ShowdownShard s;
+  s.game  = p.str ();
+  s.board = p.str ();
+  s.dead  = p.str ();
+  uint32_t nplayers = p.u32 ();
+  for (uint32_t i=0; i<nplayers; i++)
+    s.ranges.push_back (p.str ());
+  s.trials      = p.u64 ();
+  s.seed        = p.u32 ();
+  s.totalChunks = p.u64 ();
+  uint32_t npots = version < 3 ? 0 : p.u32 ();
+  for (uint32_t k=0; k<npots; k++)
+    {
+      double amount = p.f64 ();
+      s.pots.push_back (SidePot (amount, p.u64 ()));
+    }
+  s.firstChunk  = p.u64 ();
+  uint64_t nchunks = p.u64 ();
+  if (s.firstChunk > s.totalChunks || nchunks > s.totalChunks - s.firstChunk)
+    throw std::runtime_error ("ShowdownShard: chunks out of range");
+
+  s.chunks.assign (nchunks, ShowdownResult (nplayers, 0, npots));
+  for (uint64_t c=0; c<nchunks; c++)
+    {
+      ShowdownResult& r = s.chunks[c];
+      r.weight    = p.f64 ();
+      r.showdowns = p.u64 ();
+      for (uint32_t i=0; i<nplayers; i++)
+        {
+          r.shares[i].winShares = p.f64 ();
+          r.shares[i].tieShares = p.f64 ();
+          r.scoops[i]           = p.f64 ();
+        }
+      for (size_t k=0; k<r.potShares.size(); k++)
+        r.potShares[k] = p.f64 ();
+      if (version < 2)
+        continue;
+      uint64_t unit = p.u64 ();
+      if (unit == 0)
+        continue;
+      ShowdownResult exact (nplayers, unit, npots);
+      exact.showdowns = r.showdowns;
+      for (uint32_t i=0; i<nplayers; i++)
+        {
+          exact.winUnits[i]   = p.u64 ();
+          exact.tieUnits[i]   = p.u64 ();
+          exact.scoopCount[i] = p.u64 ();
+        }
+      for (size_t k=0; k<exact.potUnits.size(); k++)
+        exact.potUnits[k] = p.u64 ();
+      exact.syncExact ();
+      r = exact;
+    }
+  if (!p.done ())
+    throw std::runtime_error ("ShowdownShard: trailing bytes");
+  return s;
+}
+
+vector<pair<uint64_t,uint64_t> > ShowdownShard::missing (const vector<ShowdownShard>& shards)
+{
+  vector<pair<uint64_t,uint64_t> > ret;
+  if (shards.empty())
+    return ret;
+
+  vector<const ShowdownShard*> sorted = sortedShards (shards);
+
+  uint64_t next = 0;
+  for (size_t i=0; i<sorted.size(); i++)
+    {
+      if (sorted[i]->firstChunk > next)
+        ret.push_back (make_pair (next, sorted[i]->firstChunk));
+      next = max (next, sorted[i]->lastChunk ());
+    }
+  if (next < shards[0].totalChunks)
+    ret.push_back (make_pair (next, shards[0].totalChunks));
+  return ret;
+}
+
+ShowdownResult ShowdownShard::merge (const vector<ShowdownShard>& shards)
+{
+  if (shards.empty())
+    throw std::runtime_error ("ShowdownShard: nothing to merge");
+
+  vector<const ShowdownShard*> sorted = sortedShards (shards);
+
+  uint64_t next = 0;
+  for (size_t i=0; i<sorted.size(); i++)
+    {
+      if (sorted[i]->firstChunk < next)
+        throw std::runtime_error ((boost::format("ShowdownShard: chunks %d-%d are covered twice")
+                                   % sorted[i]->firstChunk % min (next, sorted[i]->lastChunk ())).str());
+      if (sorted[i]->firstChunk > next)
+        throw std::runtime_error ((boost::format("ShowdownShard: chunks %d-%d are missing")
+                                   % next % sorted[i]->firstChunk).str());
+      next = sorted[i]->lastChunk ();
+    }
+  if (next != shards[0].totalChunks)
+    throw std::runtime_error ((boost::format("ShowdownShard: chunks %d-%d are missing")
+                               % next % shards[0].totalChunks).str());
+
+  vector<ShowdownResult> chunks;
+  for (size_t i=0; i<sorted.size(); i++)
+    chunks.insert (chunks.end(), sorted[i]->chunks.begin(), sorted[i]->chunks.end());
+  return ShowdownEnumerator::merge (chunks, shards[0].ranges.size());
+}
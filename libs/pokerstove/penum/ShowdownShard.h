@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_SHOWDOWNSHARD_H_
+#define PENUM_SHOWDOWNSHARD_H_
+
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "ShowdownEnumerator.h"
+
+namespace pokerstove
+{
+  /**
+   * The partial result of a ShowdownEnumerator job: the job it belongs
+   * to, the chunks [firstChunk, firstChunk+chunks.size()) of it that
+   * were run, and each chunk's result.  Shards are run as separate
+   * processes, written to files, and merged once every chunk of the
+   * job is covered.  Keeping the chunks separate means the merge adds
+   * them in the same order as a single run, so the result is the same
+   * bit for bit.  Exact chunks (see ShowdownResult) keep their
+   * counts, and side pots (see ShowdownEnumerator::setPots) are part
+   * of the job, with each chunk's share of every pot.  Version 1
+   * files, which have no counts, and version 2 files, which have no
+   * pots, are still read.
+   *
+   * file layout, all integers little endian, doubles as their bits:
+   *   "PSSD" version:u32
+   *   game board dead                       (u32 length + bytes each)
+   *   nplayers:u32 ranges[nplayers]
+   *   trials:u64 seed:u32 totalChunks:u64
+   *   npots:u32 (amount:f64 eligible:u64)[npots]
+   *   firstChunk:u64 nchunks:u64
+   *   chunks: weight:f64 showdowns:u64 (win:f64 tie:f64 scoop:f64)[nplayers]
+   *           potShares:f64[npots*nplayers]
+   *           unit:u64, and if it is not zero
+   *           (winUnits:u64 tieUnits:u64 scoopCount:u64)[nplayers]
+   *           potUnits:u64[npots*nplayers]
+   *   checksum:u32 of everything before it
+   */
+  struct ShowdownShard
+  {
+    std::string              game;          //!< PokerHandEvaluator::alloc id
+    std::string              board;
+    std::string              dead;
+    std::vector<std::string> ranges;        //!< CardDistribution descriptors
+    uint64_t                 trials;        //!< zero for exact enumeration
+    uint32_t                 seed;
+    uint64_t                 totalChunks;   //!< chunks in the whole job
+    std::vector<SidePot>     pots;          //!< side pots settled at each showdown
+    uint64_t                 firstChunk;
+    std::vector<ShowdownResult> chunks;
+
+    ShowdownShard ()
+      : trials(0)
+      , seed(0)
+      , totalChunks(0)
+      , firstChunk(0)
+    {}
+
+    uint64_t lastChunk () const { return firstChunk + chunks.size(); }
+
+    /**
+     * hash of the job description, the same for every shard of a job
+     */
+    uint64_t jobId () const;
+
+    /**
+     * Chunks [first, last) of shard k out of n, for a job of total
+     * chunks.  The shards cover the job with no gaps or overlaps.
+     */
+    static std::pair<uint64_t,uint64_t> shardRange (uint64_t total, uint64_t k, uint64_t n);
+
+    /**
+     * Run chunks [first, last) of the job with enumerator, which must
+     * have been built from the same description, pots included.
+     * Throws std::invalid_argument if the players or pots differ.
+     */
+    void run (const ShowdownEnumerator& enumerator, uint64_t first, uint64_t last);
+
+    void write (std::ostream& out) const;
+
+    /**
+     * Throws std::runtime_error on malformed or corrupted input.
+     */
+    static ShowdownShard read (std::istream& in);
+
+    /**
+     * The chunk ranges of the job which none of the shards cover.
+     * Throws std::runtime_error if they belong to different jobs.
+     */
+    static std::vector<std::pair<uint64_t,uint64_t> >
+    missing (const std::vector<ShowdownShard>& shards);
+
+    /**
+     * Combine the shards of one job.  Throws std::runtime_error if
+     * they belong to different jobs, overlap, or leave chunks out.
+     */
+    static ShowdownResult merge (const std::vector<ShowdownShard>& shards);
+  };
+}
+
+#endif  // PENUM_SHOWDOWNSHARD_H_
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <algorithm>
+#include <stdexcept>
+#include <pokerstove/util/lastbit.h>
+#include "SubsetWeights.h"
+
+using namespace std;
+using namespace pokerstove;
+
+const size_t SubsetWeights::MAX_CARDS;
+
+namespace
+{
+  /**
+   * binomial coefficients, for the colex rank of a set of cards
+   * c0 < c1 < ... which is the sum of choose(ci, i+1)
+   */
+  struct Binomials
+  {
+    uint32_t choose[CardSet::STANDARD_DECK_SIZE+1][SubsetWeights::MAX_CARDS+1];
+
+    Binomials ()
+    {
+      for (size_t n=0; n<=CardSet::STANDARD_DECK_SIZE; n++)
+        for (size_t k=0; k<=SubsetWeights::MAX_CARDS; k++)
+          choose[n][k] = k == 0 ? 1 : (n == 0 ? 0 : choose[n-1][k-1] + choose[n-1][k]);
+    }
+  };
+
+  const Binomials BINOMIALS;
+
+  /**
+   * the cards of mask, in increasing order
+   */
+  size_t cardsOf (uint64_t mask, int * cards)
+  {
+    size_t n = 0;
+    for (; mask; n++)
+      {
+        cards[n] = static_cast<int>(firstbit (mask));
+        mask &= ~(ONE64 << cards[n]);
+      }
+    std::reverse (cards, cards+n);
+    return n;
+  }
+}
+
+SubsetWeights::SubsetWeights (size_t depth)
+  : _depth(depth)
+  , _total(0.0)
+{
+  if (_depth > MAX_CARDS)
+    throw std::invalid_argument ("SubsetWeights: hands are too large");
+  for (size_t k=1; k<=_depth; k++)
+    _weights[k].assign (BINOMIALS.choose[CardSet::STANDARD_DECK_SIZE][k], 0.0);
+}
+
+void SubsetWeights::clear ()
+{
+  _total = 0.0;
+  for (size_t k=1; k<=_depth; k++)
+    std::fill (_weights[k].begin(), _weights[k].end(), 0.0);
+}
+
+void SubsetWeights::add (const CardSet& hand, double weight)
+{
+  int cards[CardSet::STANDARD_DECK_SIZE];
+  size_t n = cardsOf (hand.mask(), cards);
+  if (n > _depth)
+    throw std::invalid_argument ("SubsetWeights: hand is larger than the table");
+  _total += weight;
+  for (uint32_t subset=1; subset<(1u << n); subset++)
+    {
+      size_t k = 0;
+      uint32_t rank = 0;
+      for (size_t i=0; i<n; i++)
+        if (subset & (1u << i))
+          rank += BINOMIALS.choose[cards[i]][++k];
+      _weights[k][rank] += weight;
+    }
+}
+
+double SubsetWeights::blocked (const CardSet& cards) const
+{
+  if (_depth == 0)
+    return 0.0;
+  int held[CardSet::STANDARD_DECK_SIZE];
+  size_t n = cardsOf (cards.mask(), held);
+  // only the cards some hand holds matter
+  size_t m = 0;
+  for (size_t i=0; i<n; i++)
+    if (_weights[1][held[i]] > 0.0)
+      held[m++] = held[i];
+  return blocked (held, m, 0, 0, 0);
+}
+
+/**
+ * the weight of the hands which hold the set of size cards and rank,
+ * made of cards before start, and at least one of cards[start..n),
+ * by inclusion and exclusion
+ */
+double SubsetWeights::blocked (const int * cards, size_t n, size_t start, size_t size, uint32_t rank) const
+{
+  double sum = 0.0;
+  for (size_t i=start; i<n; i++)
+    {
+      uint32_t r = rank + BINOMIALS.choose[cards[i]][size+1];
+      double w = _weights[size+1][r];
+      // no hand holds this set, or any set containing it
+      if (w <= 0.0)
+        continue;
+      sum += w;
+      if (size+1 < _depth)
+        sum -= blocked (cards, n, i+1, size+1, r);
+    }
+  return sum;
+}
+
+void SubsetWeights::memoryFootprint (MemoryFootprint& mem, const string& name) const
+{
+  for (size_t k=1; k<=_depth; k++)
+    mem.add ("caches", name, &_weights[k][0], _weights[k].size() * sizeof(double));
+}
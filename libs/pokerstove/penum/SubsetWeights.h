@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_SUBSETWEIGHTS_H_
+#define PENUM_SUBSETWEIGHTS_H_
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+
+namespace pokerstove
+{
+  /**
+   * The weight of the hands of a range which hold each set of up to
+   * MAX_CARDS cards, indexed by the size and colex rank of the set.
+   * The weight of the hands which share a card with some other cards
+   * then follows by inclusion and exclusion over the subsets of those
+   * cards, pruned at subsets no hand holds: a few lookups for hold'em
+   * hands and no more than a few thousand for Omaha hands, rather than
+   * a pass over the range.
+   *
+   * Hands are added one at a time, so a table can also hold a range
+   * which grows, as in a sweep over hands sorted by strength.
+   */
+  class SubsetWeights
+  {
+  public:
+    static const size_t MAX_CARDS = 4;
+
+    /**
+     * A table for hands of up to depth cards.  Throws
+     * std::invalid_argument if depth is more than MAX_CARDS.
+     */
+    explicit SubsetWeights (size_t depth=MAX_CARDS);
+
+    size_t depth () const { return _depth; }
+    double total () const { return _total; }
+
+    void clear ();
+
+    /**
+     * credit weight to every subset of the hand's cards
+     */
+    void add (const CardSet& hand, double weight);
+
+    /**
+     * the weight of the hands which share a card with cards
+     */
+    double blocked (const CardSet& cards) const;
+
+    /**
+     * the weight of the hands which share no card with cards
+     */
+    double available (const CardSet& cards) const { return _total - blocked (cards); }
+
+    /**
+     * add the tables to mem, as a cache
+     */
+    void memoryFootprint (MemoryFootprint& mem, const std::string& name) const;
+
+  private:
+    double blocked (const int * cards, size_t n, size_t start, size_t size, uint32_t rank) const;
+
+    size_t              _depth;
+    double              _total;
+    std::vector<double> _weights[MAX_CARDS+1];    //!< by set size, then colex rank
+  };
+}
+
+#endif  // PENUM_SUBSETWEIGHTS_H_
@@ -0,0 +1,309 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <memory>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/thread/tss.hpp>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace pokerstove;
+
+namespace
+{
+  /**
+   * which pool, if any, the current thread works for
+   */
+  struct WorkerTag
+  {
+    const ThreadPool * pool;
+    size_t             index;
+
+    WorkerTag (const ThreadPool * p, size_t i) : pool(p), index(i) {}
+  };
+
+  boost::thread_specific_ptr<WorkerTag> currentWorker;
+
+  boost::mutex   sharedLock;
+  ThreadPool *   sharedPool = NULL;
+
+  void pinToCpu (size_t index)
+  {
+#ifdef __linux__
+    size_t ncpus = ThreadPool::hardwareThreads ();
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (index % ncpus, &set);
+    pthread_setaffinity_np (pthread_self (), sizeof(set), &set);
+#else
+    (void) index;
+#endif
+  }
+}
+
+ThreadPool::ThreadPool (size_t nthreads, bool pin)
+  : _workers()
+  , _threads()
+  , _pin(pin)
+  , _queued(0)
+  , _stop(false)
+  , _nextWorker(0)
+  , _tasksRun(0)
+  , _steals(0)
+{
+  start (nthreads, pin);
+}
+
+ThreadPool::~ThreadPool ()
+{
+  stop ();
+}
+
+void ThreadPool::start (size_t nthreads, bool pin)
+{
+  if (nthreads == 0)
+    nthreads = hardwareThreads ();
+  _pin  = pin;
+  _stop = false;
+  _threads.reset (new boost::thread_group);
+  for (size_t i=0; i<nthreads; i++)
+    _workers.push_back (new Worker);
+  for (size_t i=0; i<nthreads; i++)
+    _threads->create_thread (boost::bind (&ThreadPool::workerLoop, this, i));
+}
+
+void ThreadPool::stop ()
+{
+  {
+    boost::mutex::scoped_lock guard (_sleepLock);
+    _stop = true;
+  }
+  _wake.notify_all ();
+  _threads->join_all ();
+  _threads.reset ();
+  for (size_t i=0; i<_workers.size(); i++)
+    delete _workers[i];
+  _workers.clear ();
+}
+
+size_t ThreadPool::hardwareThreads ()
+{
+  size_t n = boost::thread::hardware_concurrency ();
+  return n > 0 ? n : 1;
+}
+
+void ThreadPool::submit (const Task& task)
+{
+  size_t self = workerIndex ();
+  size_t w = self < size() ? self : _nextWorker.fetch_add (1, boost::memory_order_relaxed) % size();
+  // counted before it is queued, so the count never drops below zero
+  {
+    boost::mutex::scoped_lock guard (_sleepLock);
+    _queued++;
+  }
+  {
+    boost::mutex::scoped_lock guard (_workers[w]->lock);
+    _workers[w]->tasks.push_back (task);
+  }
+  _wake.notify_one ();
+}
+
+size_t ThreadPool::workerIndex () const
+{
+  WorkerTag * tag = currentWorker.get ();
+  if (tag != NULL && tag->pool == this)
+    return tag->index;
+  return size ();
+}
+
+bool ThreadPool::take (size_t self, Task& task)
+{
+  const size_t n = size();
+
+  // newest task of our own first, it is the most likely to be cached
+  if (self < n)
+    {
+      Worker& w = *_workers[self];
+      boost::mutex::scoped_lock guard (w.lock);
+      if (!w.tasks.empty())
+        {
+          task = w.tasks.back ();
+          w.tasks.pop_back ();
+          boost::mutex::scoped_lock queued (_sleepLock);
+          _queued--;
+          return true;
+        }
+    }
+
+  // then the oldest task of someone else, which is likely the largest
+  for (size_t i=1; i<=n; i++)
+    {
+      size_t victim = (self + i) % n;
+      if (victim == self)
+        continue;
+      Worker& w = *_workers[victim];
+      boost::mutex::scoped_lock guard (w.lock);
+      if (!w.tasks.empty())
+        {
+          task = w.tasks.front ();
+          w.tasks.pop_front ();
+          boost::mutex::scoped_lock queued (_sleepLock);
+          _queued--;
+          if (self < n)
+            _steals.fetch_add (1, boost::memory_order_relaxed);
+          return true;
+        }
+    }
+  return false;
+}
+
+bool ThreadPool::runOne ()
+{
+  Task task;
+  if (!take (workerIndex (), task))
+    return false;
+  task ();
+  _tasksRun.fetch_add (1, boost::memory_order_relaxed);
+  return true;
+}
+
+void ThreadPool::workerLoop (size_t index)
+{
+  currentWorker.reset (new WorkerTag (this, index));
+  if (_pin)
+    pinToCpu (index);
+
+  Task task;
+  while (true)
+    {
+      if (take (index, task))
+        {
+          task ();
+          task.clear ();
+          _tasksRun.fetch_add (1, boost::memory_order_relaxed);
+          continue;
+        }
+
+      boost::mutex::scoped_lock guard (_sleepLock);
+      while (_queued == 0 && !_stop)
+        _wake.wait (guard);
+      if (_queued == 0 && _stop)
+        return;
+    }
+}
+
+ThreadPool& ThreadPool::shared ()
+{
+  boost::mutex::scoped_lock guard (sharedLock);
+  if (sharedPool == NULL)
+    sharedPool = new ThreadPool ();
+  return *sharedPool;
+}
+
+void ThreadPool::configureShared (size_t nthreads, bool pin)
+{
+  boost::mutex::scoped_lock guard (sharedLock);
+  // restarted in place, as engines keep a pointer to it
+  if (sharedPool == NULL)
+    sharedPool = new ThreadPool (nthreads, pin);
+  else
+    {
+      sharedPool->stop ();
+      sharedPool->start (nthreads, pin);
+    }
+}
+
+TaskGroup::TaskGroup (ThreadPool * pool)
+  : _pool(pool)
+  , _pending(0)
+  , _failed(false)
+{}
+
+TaskGroup::~TaskGroup ()
+{
+  try
+    {
+      wait ();
+    }
+  catch (...)
+    {}
+}
+
+void TaskGroup::run (const ThreadPool::Task& task)
+{
+  {
+    boost::mutex::scoped_lock guard (_lock);
+    _pending++;
+  }
+  if (_pool == NULL)
+    execute (task);
+  else
+    _pool->submit (boost::bind (&TaskGroup::execute, this, task));
+}
+
+void TaskGroup::execute (const ThreadPool::Task& task)
+{
+  string error;
+  bool failed = false;
+  try
+    {
+      task ();
+    }
+  catch (std::exception& e)
+    {
+      failed = true;
+      error = e.what ();
+    }
+  catch (...)
+    {
+      failed = true;
+      error = "TaskGroup: unknown exception in task";
+    }
+
+  boost::mutex::scoped_lock guard (_lock);
+  if (failed && !_failed)
+    {
+      _failed = true;
+      _error  = error;
+    }
+  if (--_pending == 0)
+    _done.notify_all ();
+}
+
+void TaskGroup::wait ()
+{
+  if (_pool != NULL && _pool->workerIndex () < _pool->size ())
+    {
+      // a worker waiting on its own pool helps, rather than block a
+      // thread the group's tasks may need
+      while (true)
+        {
+          {
+            boost::mutex::scoped_lock guard (_lock);
+            if (_pending == 0)
+              break;
+          }
+          if (!_pool->runOne ())
+            {
+              boost::mutex::scoped_lock guard (_lock);
+              if (_pending > 0)
+                _done.timed_wait (guard, boost::posix_time::milliseconds (1));
+            }
+        }
+    }
+
+  boost::mutex::scoped_lock guard (_lock);
+  while (_pending > 0)
+    _done.wait (guard);
+  if (_failed)
+    {
+      _failed = false;
+      throw std::runtime_error (_error);
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_THREADPOOL_H_
+#define PENUM_THREADPOOL_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace pokerstove
+{
+  /**
+   * A fixed set of worker threads which run submitted tasks.  Each
+   * worker has its own deque: it runs its newest task first, and when
+   * it runs out it steals the oldest task of another worker.  Engines
+   * split their work into many more chunks than there are threads, so
+   * cheap and expensive chunks even out between the workers.
+   *
+   * Tasks are normally submitted through a TaskGroup, which waits for
+   * them.  Tasks submitted from a worker go on that worker's deque,
+   * others are dealt round robin.
+   *
+   * The engines run on ThreadPool::shared() unless they are given a
+   * pool of their own; programs size it once with configureShared.
+   */
+  class ThreadPool
+  {
+  public:
+    typedef boost::function<void ()> Task;
+
+    /**
+     * nthreads of zero means one per hardware thread.  With pin set,
+     * worker i is bound to cpu i modulo the number of cpus (linux).
+     */
+    explicit ThreadPool (size_t nthreads=0, bool pin=false);
+
+    /**
+     * runs the queued tasks, then stops the workers
+     */
+    ~ThreadPool ();
+
+    size_t size () const { return _workers.size(); }
+    bool pinned () const { return _pin; }
+
+    void submit (const Task& task);
+
+    /**
+     * Run one queued task on the calling thread, if there is one.
+     * Used by threads waiting on a TaskGroup from inside the pool.
+     */
+    bool runOne ();
+
+    /**
+     * the index of the calling worker of this pool, or size() if the
+     * caller is not one of its workers
+     */
+    size_t workerIndex () const;
+
+    uint64_t tasksRun () const { return _tasksRun.load (boost::memory_order_relaxed); }
+    uint64_t steals () const { return _steals.load (boost::memory_order_relaxed); }
+
+    static size_t hardwareThreads ();
+    static ThreadPool& shared ();
+
+    /**
+     * Resize the shared pool.  Its tasks already queued are finished
+     * and its workers replaced, so no engine may be using it, but
+     * engines made before keep a valid pointer to it.
+     */
+    static void configureShared (size_t nthreads, bool pin=false);
+
+  private:
+    ThreadPool (const ThreadPool&);
+    ThreadPool& operator= (const ThreadPool&);
+
+    struct Worker
+    {
+      boost::mutex       lock;
+      std::deque<Task>   tasks;
+    };
+
+    void start (size_t nthreads, bool pin);
+    void stop ();                               //!< runs the queued tasks first
+    bool take (size_t self, Task& task);
+    void workerLoop (size_t index);
+
+    std::vector<Worker*>        _workers;
+    boost::scoped_ptr<boost::thread_group> _threads;
+    bool                        _pin;
+
+    boost::mutex                _sleepLock;
+    boost::condition_variable   _wake;
+    size_t                      _queued;        //!< guarded by _sleepLock
+    bool                        _stop;
+
+    boost::atomic<size_t>       _nextWorker;
+    boost::atomic<uint64_t>     _tasksRun;
+    boost::atomic<uint64_t>     _steals;
+  };
+
+  /**
+   * A batch of tasks run on a pool, and waited for together.  A null
+   * pool runs each task in run(), on the calling thread.
+   *
+   * wait() rethrows the first exception thrown by a task, as a
+   * std::runtime_error with the same message.  A worker which waits
+   * on a group runs queued tasks while it waits, so nested groups do
+   * not deadlock.
+   */
+  class TaskGroup
+  {
+  public:
+    explicit TaskGroup (ThreadPool * pool);
+    ~TaskGroup ();
+
+    void run (const ThreadPool::Task& task);
+    void wait ();
+
+  private:
+    TaskGroup (const TaskGroup&);
+    TaskGroup& operator= (const TaskGroup&);
+
+    void execute (const ThreadPool::Task& task);
+
+    ThreadPool *                _pool;
+    boost::mutex                _lock;
+    boost::condition_variable   _done;
+    size_t                      _pending;
+    bool                        _failed;
+    std::string                 _error;
+  };
+}
+
+#endif  // PENUM_THREADPOOL_H_
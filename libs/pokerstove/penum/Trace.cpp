@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <fstream>
+#include <stdexcept>
+#ifdef __linux__
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include "Trace.h"
+
+using namespace std;
+using namespace pokerstove;
+
+namespace
+{
+  // written once before the threads start, read without the lock
+  volatile bool tracing = false;
+
+  boost::mutex           spanLock;
+  vector<Trace::Span>    recorded;
+
+  string jsonEscape (const string& s)
+  {
+    string ret;
+    for (size_t i=0; i<s.size(); i++)
+      {
+        unsigned char c = s[i];
+        if (c == '"' || c == '\\')
+          {
+            ret += '\\';
+            ret += c;
+          }
+        else if (c < 0x20)
+          ret += (boost::format("\\u%04x") % static_cast<int>(c)).str();
+        else
+          ret += c;
+      }
+    return ret;
+  }
+
+  void writeFile (const string& filename, const string& contents)
+  {
+    ofstream out (filename.c_str(), ios::out | ios::binary);
+    if (!out)
+      throw std::runtime_error ("Trace: cannot open " + filename);
+    out << contents;
+    if (!out)
+      throw std::runtime_error ("Trace: failed writing " + filename);
+  }
+}
+
+void Trace::enable ()
+{
+  tracing = true;
+}
+
+bool Trace::enabled ()
+{
+  return tracing;
+}
+
+void Trace::clear ()
+{
+  boost::mutex::scoped_lock guard (spanLock);
+  recorded.clear ();
+}
+
+uint64_t Trace::now ()
+{
+#ifdef __linux__
+  timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+#else
+  // wall clock microseconds, which do not line up with perf
+  boost::posix_time::time_duration t = boost::posix_time::microsec_clock::universal_time ()
+    - boost::posix_time::ptime (boost::gregorian::date (1970, 1, 1));
+  return static_cast<uint64_t>(t.total_microseconds ()) * 1000u;
+#endif
+}
+
+uint64_t Trace::threadId ()
+{
+#ifdef __linux__
+  return static_cast<uint64_t>(syscall (SYS_gettid));
+#else
+  return static_cast<uint64_t>(boost::hash<boost::thread::id>() (boost::this_thread::get_id ()));
+#endif
+}
+
+void Trace::record (const Span& span)
+{
+  boost::mutex::scoped_lock guard (spanLock);
+  recorded.push_back (span);
+}
+
+vector<Trace::Span> Trace::spans ()
+{
+  boost::mutex::scoped_lock guard (spanLock);
+  return recorded;
+}
+
+string Trace::chromeJson ()
+{
+  vector<Span> all = spans ();
+  long pid = static_cast<long>(getpid ());
+  string ret = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  for (size_t i=0; i<all.size(); i++)
+    {
+      const Span& s = all[i];
+      ret += (boost::format("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"detail\":\"%s\"}}%s\n")
+              % jsonEscape (s.name) % jsonEscape (s.category) % pid % s.tid
+              % (s.start / 1000.0) % ((s.end - s.start) / 1000.0)
+              % jsonEscape (s.detail) % (i+1 < all.size() ? "," : "")).str();
+    }
+  ret += "]}\n";
+  return ret;
+}
+
+void Trace::writeChrome (const string& filename)
+{
+  writeFile (filename, chromeJson ());
+}
+
+string Trace::perfMarkers ()
+{
+  vector<Span> all = spans ();
+  string ret;
+  for (size_t i=0; i<all.size(); i++)
+    {
+      const Span& s = all[i];
+      ret += (boost::format("%d %d.%06d %d.%06d %s %s %s\n")
+              % s.tid
+              % (s.start / 1000000000u) % (s.start % 1000000000u / 1000)
+              % (s.end / 1000000000u) % (s.end % 1000000000u / 1000)
+              % s.category % s.name % s.detail).str();
+    }
+  return ret;
+}
+
+void Trace::writePerfMarkers (const string& filename)
+{
+  writeFile (filename, perfMarkers ());
+}
+
+TraceSpan::TraceSpan (const char * name, const char * category)
+  : _active(Trace::enabled ())
+{
+  if (!_active)
+    return;
+  _span.name     = name;
+  _span.category = category;
+  _span.tid      = Trace::threadId ();
+  _span.start    = Trace::now ();
+}
+
+TraceSpan::TraceSpan (const char * name, const char * category, const string& detail)
+  : _active(Trace::enabled ())
+{
+  if (!_active)
+    return;
+  _span.name     = name;
+  _span.category = category;
+  _span.detail   = detail;
+  _span.tid      = Trace::threadId ();
+  _span.start    = Trace::now ();
+}
+
+TraceSpan::~TraceSpan ()
+{
+  if (!_active)
+    return;
+  _span.end = Trace::now ();
+  Trace::record (_span);
+}
+
+void TraceSpan::setDetail (const string& detail)
+{
+  if (_active)
+    _span.detail = detail;
+}
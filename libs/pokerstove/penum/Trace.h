@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PENUM_TRACE_H_
+#define PENUM_TRACE_H_
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace pokerstove
+{
+  /**
+   * Timed spans of the coarse phases of a job: parsing, table loads,
+   * each thread's share of an enumeration, merges and output.
+   * Tracing is off until Trace::enable is called, and a disabled span
+   * costs one flag test, so spans are left in the library code.  A
+   * detail which takes work to build is set with TraceSpan::setDetail
+   * only when the span is active().
+   *
+   * Times are CLOCK_MONOTONIC and thread ids are the kernel's, so a
+   * trace lines up with "perf record -k mono" (linux; elsewhere they
+   * are wall clock times and hashed boost thread ids).  The spans can be
+   * written as Chrome trace event JSON (chrome://tracing, perfetto),
+   * or as one marker line per span for merging with "perf script".
+   */
+  class Trace
+  {
+  public:
+    struct Span
+    {
+      std::string name;
+      std::string category;
+      std::string detail;     //!< free text, shown as an argument
+      uint64_t    tid;
+      uint64_t    start;      //!< nanoseconds
+      uint64_t    end;
+    };
+
+    static void enable ();
+    static bool enabled ();
+
+    /**
+     * drop the recorded spans, tracing stays enabled
+     */
+    static void clear ();
+
+    static uint64_t now ();
+    static uint64_t threadId ();
+    static void record (const Span& span);
+    static std::vector<Span> spans ();
+
+    /**
+     * Chrome trace event JSON, complete ("X") events in microseconds
+     */
+    static std::string chromeJson ();
+    static void writeChrome (const std::string& filename);
+
+    /**
+     * One line per span: "tid start end category name detail", times
+     * in seconds with the precision perf script uses.
+     */
+    static std::string perfMarkers ();
+    static void writePerfMarkers (const std::string& filename);
+  };
+
+  /**
+   * Records a span from construction to destruction, when tracing is
+   * enabled.
+   */
+  class TraceSpan
+  {
+  public:
+    TraceSpan (const char * name, const char * category);
+    TraceSpan (const char * name, const char * category, const std::string& detail);
+    ~TraceSpan ();
+
+    bool active () const { return _active; }     //!< true if recorded
+    void setDetail (const std::string& detail);
+
+  private:
+    TraceSpan (const TraceSpan&);
+    TraceSpan& operator= (const TraceSpan&);
+
+    bool        _active;
+    Trace::Span _span;
+  };
+}
+
+#endif  // PENUM_TRACE_H_
@@ -6,6 +6,7 @@
 #define PEVAL_BADUGIHANDEVALUATOR_H_
 
 #include "PokerHandEvaluator.h"
+#include "PerfCounters.h"
 
 namespace pokerstove 
 {
@@ -22,6 +23,7 @@ namespace pokerstove
 
     virtual PokerHandEvaluation evaluateHand (const CardSet & hand, const CardSet&) const
     {
+      PEVAL_COUNT(EVAL_BADUGI);
       return PokerHandEvaluation(hand.evaluateBadugi ());
     }
 
@@ -20,6 +20,7 @@
 #include "CardSet.h"
 #include "PokerEvaluation.h"
 #include "PokerEvaluationTables.h"
+#include "PerfCounters.h"
 
 using namespace std;
 using namespace boost;
@@ -215,11 +216,9 @@ CardSet CardSet::canonize () const
 
 CardSet CardSet::canonize (const CardSet& other) const
 {
-  CardSet cother = other.canonize();
-  vector<int> perms = findSuitPermutation (other, cother);
-  CardSet hand = *this;
-  CardSet chand = hand.rotateSuits (perms[0],perms[1],perms[2],perms[3]);
-  return chand;
+  int perms[Suit::NUM_SUIT];
+  findSuitPermutation (other, other.canonize(), perms);
+  return rotateSuits (perms[0],perms[1],perms[2],perms[3]);
 }
 
 
@@ -410,6 +409,7 @@ bool CardSet::hasStraight () const
 // note, there are no function calls in this function
 PokerEvaluation CardSet::evaluateHigh () const
 {
+  PEVAL_COUNT(HIGH);
   // first the easy stuff
   int c = C();
   int d = D();
@@ -443,6 +443,7 @@ PokerEvaluation CardSet::evaluateHigh () const
         }
       if (suitindex >= 0)
         {
+          PEVAL_COUNT(HIGH_FLUSH);
           int strval = straightTable[sranks];
           if (strval > 0)
             return PokerEvaluation ((STRAIGHT_FLUSH<<VSHIFT) ^ strval<<MAJOR_SHIFT);
@@ -560,6 +561,7 @@ PokerEvaluation CardSet::evaluateHigh () const
 // elided
 PokerEvaluation CardSet::evaluateHighFlush () const
 {
+  PEVAL_COUNT(HIGH_FLUSH_ONLY);
   // first the easy stuff
   int c = C();
   int d = D();
@@ -607,6 +609,7 @@ PokerEvaluation CardSet::evaluateHighFlush () const
 // elided
 PokerEvaluation CardSet::evaluateHighRanks () const
 {
+  PEVAL_COUNT(HIGH_RANKS);
   // first the easy stuff
   int c = C();
   int d = D();
@@ -725,6 +728,7 @@ PokerEvaluation CardSet::evaluateHighRanks () const
 // this is just evaluateHigh without the straight or flush code
 PokerEvaluation CardSet::evaluatePairing () const
 {
+  PEVAL_COUNT(PAIRING);
   // first the easy stuff
   int c = C();
   int d = D();
@@ -835,6 +839,7 @@ PokerEvaluation CardSet::evaluatePairing () const
 // This one is not fully optimized
 PokerEvaluation CardSet::evaluateLow2to7 () const
 {
+  PEVAL_COUNT(LOW_2TO7);
   PokerEvaluation high;
 
   // if there are five or fewer cards, we just evaluate the high, 
@@ -977,6 +982,7 @@ PokerEvaluation CardSet::evaluateSuitsLow2to7 () const
 // This one is not fully optimized
 PokerEvaluation CardSet::evaluateLowA5 () const
 {
+  PEVAL_COUNT(LOW_A5);
   //PokerEvaluation::generateLowballLookupA5();
 
   // this is a rank only evaluator, so we just get
@@ -1000,6 +1006,7 @@ PokerEvaluation CardSet::evaluateLowA5 () const
   // 2) 5 or more ranks
   if (ndups == 0 || nranks >= FULL_HAND_SIZE)
     {
+      PEVAL_COUNT(LOW_A5_FAST);
       PokerEvaluation ret ((NO_PAIR<<VSHIFT) ^ lowballA5Ranks[rankmask] ^ ACE_LOW_BIT);
       ret.flip ();
       return ret;
@@ -1008,6 +1015,7 @@ PokerEvaluation CardSet::evaluateLowA5 () const
   // *) we have five or fewer cards
   else if (ncards <= FULL_HAND_SIZE)
     {
+      PEVAL_COUNT(LOW_A5_SHORT);
       PokerEvaluation ret = evaluatePairing();
       ret.playAceLow ();
       ret.flip ();
@@ -1016,6 +1024,7 @@ PokerEvaluation CardSet::evaluateLowA5 () const
   else
     {
       // now the general case
+      PEVAL_COUNT(LOW_A5_GENERAL);
       // the algorithm is as follows:
       // cycle through the "pairing list" till a total of five 
       // cards are found
@@ -1033,39 +1042,16 @@ PokerEvaluation CardSet::evaluateLowA5 () const
       rset[2] = LOWBALL_ROTATE_RANKS(rset[2]);
       rset[3] = LOWBALL_ROTATE_RANKS(rset[3]);
 
-      // we add pairs first, then trips, then quads
+      // we add pairs first, then trips, then quads.  The masks are
+      // rotated so the ace is bit zero, and lower ranks go in first.
       int nc=0;
-      for (int i=0; i<4; i++)
-        {
-          // do the ace first
-          if (rset[i] & (0x01<<Rank::AceVal()))
+      for (int i=0; i<4 && nc<FULL_HAND_SIZE; i++)
+        for (int r=0; r<static_cast<int>(Rank::NUM_RANK) && nc<FULL_HAND_SIZE; r++)
+          if (rset[i] & (0x01<<r))
             {
-              chash |= (ONE64<<(Rank::AceVal()+Rank::NUM_RANK*i));
+              chash |= (ONE64<<(r+Rank::NUM_RANK*i));
               nc++;
             }
-          if (nc == FULL_HAND_SIZE)
-            {
-              break;
-            }
-
-          // now the rest of the ranks
-          for (int r=0; r<11; r++)
-            {
-              if (rset[i] & (0x01<<r))
-                {
-                  chash |= (ONE64<<(r+Rank::NUM_RANK*i));
-                  nc++;
-                }
-              if (nc == FULL_HAND_SIZE)
-                {
-                  break;
-                }
-            }
-          if (nc == FULL_HAND_SIZE)
-            {
-              break;
-            }
-        }
             
       CardSet paird(chash);
       PokerEvaluation ret(paird.evaluatePairing().code() | ACE_LOW_BIT);
@@ -1076,6 +1062,7 @@ PokerEvaluation CardSet::evaluateLowA5 () const
 
 PokerEvaluation CardSet::evaluate8LowA5 () const
 {
+  PEVAL_COUNT(LOW_8_A5);
   // bits 2-8+A are set here
   const int LOW_MASK = 0x107F;
 
@@ -1089,6 +1076,7 @@ PokerEvaluation CardSet::evaluate8LowA5 () const
 
   if (nranks >= FULL_HAND_SIZE)
     {
+      PEVAL_COUNT(LOW_8_A5_QUALIFIED);
       PokerEvaluation ret (((NO_PAIR<<VSHIFT) ^ lowballA5Ranks[rankmask]) | ACE_LOW_BIT);
       ret.flip ();
       return ret;
@@ -1100,6 +1088,7 @@ PokerEvaluation CardSet::evaluate8LowA5 () const
 
 PokerEvaluation CardSet::evaluate3CP () const
 {
+  PEVAL_COUNT(THREE_CARD);
   int c = C();
   int d = D();
   int h = H();
@@ -1170,6 +1159,7 @@ static inline bool badugiless (int c1, int c2)
  */
 PokerEvaluation CardSet::evaluateBadugi () const
 {
+  PEVAL_COUNT(BADUGI);
   // get our ranks orgainzed in lowball order by suit
 	boost::array<int,4> suits = 
     {{ 
@@ -1359,37 +1349,38 @@ std::ostream& operator<<(std::ostream& sout, const pokerstove::CardSet & e)
   return sout;
 }
 
-vector<int> pokerstove::findSuitPermutation (const CardSet& source, const CardSet& dest)
+void pokerstove::findSuitPermutation (const CardSet& source, const CardSet& dest, int rot[])
 {
-  vector<int> rot(4,-1);
-  vector<int> taken(4,0);
+  bool taken[Suit::NUM_SUIT] = { false, false, false, false };
 
   int i=0;
   for (Suit s=Suit::begin(); s<Suit::end(); ++s, ++i)
     {
+      rot[i] = -1;
+      int smask = source.suitMask (s);
       int j=0;
       for (Suit t=Suit::begin(); t<Suit::end(); ++t, ++j)
         {
-          if (source.suitMask(s) == dest.suitMask (t))
+          if (!taken[j] && smask == dest.suitMask (t))
             {
-              if (taken[j] == 0)
-                {
-                  rot[i] = j;
-                  taken[j] = 1;
-                  break;
-                }
+              rot[i] = j;
+              taken[j] = true;
+              break;
             }
         }
     }
-  return rot;
+}
+
+vector<int> pokerstove::findSuitPermutation (const CardSet& source, const CardSet& dest)
+{
+  int rot[Suit::NUM_SUIT];
+  findSuitPermutation (source, dest, rot);
+  return vector<int>(rot, rot+Suit::NUM_SUIT);
 }
 
 CardSet pokerstove::canonizeToBoard (const CardSet& board, const CardSet& hand)
 {
-  CardSet cboard = board.canonize();
-  vector<int> perms = findSuitPermutation (board, cboard);
-  CardSet chand = hand.rotateSuits (perms[0],perms[1],perms[2],perms[3]);
-  return chand;
+  return hand.canonize (board);
 }
 
 
@@ -191,6 +191,11 @@ namespace pokerstove
   CardSet canonizeToBoard (const CardSet& board, const CardSet& hand);
 
   std::vector<int> findSuitPermutation (const CardSet& source, const CardSet& dest);
+
+  /**
+   * findSuitPermutation into rot[Suit::NUM_SUIT], without allocating
+   */
+  void findSuitPermutation (const CardSet& source, const CardSet& dest, int rot[]);
 } // namespace pokerstove
 
 
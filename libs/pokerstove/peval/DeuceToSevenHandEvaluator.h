@@ -6,6 +6,7 @@
 #define PEVAL_DEUCETOSEVENHANDEVALUATOR_H_
 
 #include "PokerHandEvaluator.h"
+#include "PerfCounters.h"
 
 namespace pokerstove 
 {
@@ -22,6 +23,7 @@ namespace pokerstove
 
     virtual PokerHandEvaluation evaluateHand (const CardSet & hand, const CardSet&) const
     {
+      PEVAL_COUNT(EVAL_DEUCE_TO_SEVEN);
       if (usesSuits())
         return PokerHandEvaluation(hand.evaluateLow2to7());
       else
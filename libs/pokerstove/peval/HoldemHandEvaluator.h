@@ -7,6 +7,7 @@
 
 #include "Holdem.h"
 #include "PokerHandEvaluator.h"
+#include "PerfCounters.h"
 
 namespace pokerstove 
 {
@@ -19,6 +20,7 @@ namespace pokerstove
 
     virtual PokerHandEvaluation evaluateHand (const CardSet & hand, const CardSet& board) const
     {
+      PEVAL_COUNT(EVAL_HOLDEM);
       //if (hand.size () != NUM_HOLDEM_POCKET)
       //throw std::invalid_argument ("HHE: incorrect number of pocket cards");
       CardSet h = hand;
@@ -26,6 +28,17 @@ namespace pokerstove
       return PokerHandEvaluation(h.evaluateHigh ());
     }
 
+    virtual void evaluateHands (const std::vector<CardSet>& hands, const CardSet& board,
+                                std::vector<PokerHandEvaluation>& evals) const
+    {
+      evals.resize (hands.size());
+      for (size_t i=0; i<hands.size(); i++)
+        {
+          PEVAL_COUNT(EVAL_HOLDEM);
+          evals[i] = PokerHandEvaluation (CardSet (hands[i] | board).evaluateHigh ());
+        }
+    }
+
     virtual PokerEvaluation evaluateRanks (const CardSet & hand, const CardSet& board=CardSet(0)) const
     {
       CardSet h = hand;
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <fstream>
+#include <map>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+#include <boost/format.hpp>
+#include "MemoryFootprint.h"
+#include "PokerEvaluationTables.h"
+
+using namespace std;
+using namespace pokerstove;
+
+PageFaults PageFaults::operator- (const PageFaults& before) const
+{
+  PageFaults ret;
+  ret.minor = minor - before.minor;
+  ret.major = major - before.major;
+  return ret;
+}
+
+void MemoryFootprint::add (const string& subsystem, const string& name,
+                           const void * p, uint64_t bytes,
+                           const PageFaults& faults)
+{
+  MemoryRegion r;
+  r.subsystem = subsystem;
+  r.name      = name;
+  r.bytes     = bytes;
+  r.resident  = residentBytes (p, bytes);
+  r.faults    = faults;
+  _regions.push_back (r);
+}
+
+uint64_t MemoryFootprint::bytes () const
+{
+  uint64_t ret = 0;
+  for (size_t i=0; i<_regions.size(); i++)
+    ret += _regions[i].bytes;
+  return ret;
+}
+
+uint64_t MemoryFootprint::resident () const
+{
+  uint64_t ret = 0;
+  for (size_t i=0; i<_regions.size(); i++)
+    ret += _regions[i].resident;
+  return ret;
+}
+
+string MemoryFootprint::str () const
+{
+  string ret = (boost::format("%-10s %-32s %14s %14s %10s %8s\n")
+                % "subsystem" % "region" % "bytes" % "resident" % "minflt" % "majflt").str();
+
+  // regions grouped by subsystem, in the order the subsystems appear
+  vector<string> order;
+  map<string,pair<uint64_t,uint64_t> > totals;
+  for (size_t i=0; i<_regions.size(); i++)
+    {
+      const MemoryRegion& r = _regions[i];
+      if (totals.find (r.subsystem) == totals.end())
+        order.push_back (r.subsystem);
+      totals[r.subsystem].first  += r.bytes;
+      totals[r.subsystem].second += r.resident;
+    }
+  for (size_t s=0; s<order.size(); s++)
+    {
+      for (size_t i=0; i<_regions.size(); i++)
+        {
+          const MemoryRegion& r = _regions[i];
+          if (r.subsystem != order[s])
+            continue;
+          ret += (boost::format("%-10s %-32s %14d %14d %10d %8d\n")
+                  % r.subsystem % r.name % r.bytes % r.resident
+                  % r.faults.minor % r.faults.major).str();
+        }
+      ret += (boost::format("%-10s %-32s %14d %14d\n")
+              % order[s] % "total" % totals[order[s]].first % totals[order[s]].second).str();
+    }
+
+  PageFaults faults = pageFaults ();
+  ret += (boost::format("%-10s %-32s %14d %14d\n")
+          % "all" % "total" % bytes () % resident ()).str();
+  ret += (boost::format("%-10s %-32s %14s %14d %10d %8d\n")
+          % "process" % "resident set" % "" % processResident ()
+          % faults.minor % faults.major).str();
+  return ret;
+}
+
+void MemoryFootprint::addStaticTables (MemoryFootprint& mem)
+{
+  mem.add ("tables", "topRankTable",       topRankTable,       sizeof(topRankTable));
+  mem.add ("tables", "botRankTable",       botRankTable,       sizeof(botRankTable));
+  mem.add ("tables", "bottomRankMask",     bottomRankMask,     sizeof(bottomRankMask));
+  mem.add ("tables", "straightTable",      straightTable,      sizeof(straightTable));
+  mem.add ("tables", "nRanksTable",        nRanksTable,        sizeof(nRanksTable));
+  mem.add ("tables", "flushTable",         flushTable,         sizeof(flushTable));
+  mem.add ("tables", "topFiveRanksTable",  topFiveRanksTable,  sizeof(topFiveRanksTable));
+  mem.add ("tables", "topThreeRanksTable", topThreeRanksTable, sizeof(topThreeRanksTable));
+  mem.add ("tables", "lowballA5Ranks",     lowballA5Ranks,     sizeof(lowballA5Ranks));
+}
+
+uint64_t MemoryFootprint::residentBytes (const void * p, uint64_t bytes)
+{
+#ifdef __linux__
+  if (p == NULL || bytes == 0)
+    return 0;
+
+  // mincore works on whole pages, so a region counts every page it
+  // touches, clipped to its own size at the ends
+  const uint64_t page  = static_cast<uint64_t>(sysconf (_SC_PAGESIZE));
+  const uint64_t begin = reinterpret_cast<uint64_t>(p);
+  const uint64_t end   = begin + bytes;
+  const uint64_t first = begin / page * page;
+  const uint64_t npages = (end - first + page - 1) / page;
+
+  vector<unsigned char> incore (npages);
+  if (mincore (reinterpret_cast<void*>(first), npages * page, &incore[0]) != 0)
+    return 0;
+
+  uint64_t ret = 0;
+  for (uint64_t i=0; i<npages; i++)
+    {
+      if (!(incore[i] & 1))
+        continue;
+      uint64_t lo = max (begin, first + i*page);
+      uint64_t hi = min (end, first + (i+1)*page);
+      ret += hi - lo;
+    }
+  return ret;
+#else
+  return 0;
+#endif
+}
+
+uint64_t MemoryFootprint::processResident ()
+{
+#ifdef __linux__
+  // the second field of statm is the resident set in pages
+  ifstream statm ("/proc/self/statm");
+  uint64_t size = 0;
+  uint64_t pages = 0;
+  if (!(statm >> size >> pages))
+    return 0;
+  return pages * static_cast<uint64_t>(sysconf (_SC_PAGESIZE));
+#else
+  return 0;
+#endif
+}
+
+PageFaults MemoryFootprint::pageFaults ()
+{
+  PageFaults ret;
+#ifdef __linux__
+  rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    {
+      ret.minor = static_cast<uint64_t>(usage.ru_minflt);
+      ret.major = static_cast<uint64_t>(usage.ru_majflt);
+    }
+#endif
+  return ret;
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PEVAL_MEMORYFOOTPRINT_H_
+#define PEVAL_MEMORYFOOTPRINT_H_
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace pokerstove
+{
+  /**
+   * Page faults taken by the process, from getrusage.  Minor faults
+   * map a page already in memory, major faults read it from disk.
+   */
+  struct PageFaults
+  {
+    uint64_t minor;
+    uint64_t major;
+
+    PageFaults () : minor(0), major(0) {}
+    PageFaults operator- (const PageFaults& before) const;
+  };
+
+  /**
+   * One block of memory owned by a library component.  Resident is
+   * the part of it in RAM, measured with mincore, so untouched pages
+   * of a memory mapped table do not count.  For a mapped file that is
+   * the page cache, which every process mapping the file shares.
+   */
+  struct MemoryRegion
+  {
+    std::string subsystem;     //!< "tables", "files", "caches", "ranges", ...
+    std::string name;
+    uint64_t    bytes;
+    uint64_t    resident;
+    PageFaults  faults;        //!< faults taken loading it, where known
+  };
+
+  /**
+   * An account of the memory held by library components, built up by
+   * each component adding its own regions, for example
+   *
+   *   MemoryFootprint mem;
+   *   MemoryFootprint::addStaticTables (mem);
+   *   strengthTable.memoryFootprint (mem);
+   *   range.memoryFootprint (mem, "hero");
+   *   cerr << mem.str ();
+   */
+  class MemoryFootprint
+  {
+  public:
+    /**
+     * Add a region, measuring how much of [p, p+bytes) is resident.
+     */
+    void add (const std::string& subsystem, const std::string& name,
+              const void * p, uint64_t bytes,
+              const PageFaults& faults = PageFaults());
+
+    const std::vector<MemoryRegion>& regions () const { return _regions; }
+    uint64_t bytes () const;
+    uint64_t resident () const;
+
+    /**
+     * one line per region and a total per subsystem, followed by the
+     * process resident set size and page faults
+     */
+    std::string str () const;
+
+    /**
+     * the lookup tables of PokerEvaluationTables.h, shared by all
+     * evaluators
+     */
+    static void addStaticTables (MemoryFootprint& mem);
+
+    /**
+     * measured on linux, zero elsewhere
+     */
+    static uint64_t residentBytes (const void * p, uint64_t bytes);
+    static uint64_t processResident ();
+    static PageFaults pageFaults ();
+
+  private:
+    std::vector<MemoryRegion> _regions;
+  };
+}
+
+#endif  // PEVAL_MEMORYFOOTPRINT_H_
@@ -9,6 +9,7 @@
 #include "PokerEvaluationTables.h"
 #include "Holdem.h"
 #include "PokerHandEvaluator.h"
+#include "PerfCounters.h"
 
 inline int bottomRanks (int x, int n)
 {
@@ -66,6 +67,7 @@ namespace pokerstove
 
     virtual PokerHandEvaluation evaluateHand (const CardSet& hand, const CardSet& board) const
     {
+      PEVAL_COUNT(EVAL_OMAHA_EIGHT);
       PokerEvaluation eval[2];
 
       // generate the possible sub hands, player hand candidates are all
@@ -8,6 +8,7 @@
 #include <boost/math/special_functions/binomial.hpp>
 #include "PokerEvaluationTables.h"
 #include "PokerHandEvaluator.h"
+#include "PerfCounters.h"
 
 namespace pokerstove 
 {
@@ -26,6 +27,7 @@ namespace pokerstove
 
     virtual PokerHandEvaluation evaluateHand (const CardSet & hand, const CardSet & board) const
     {
+      PEVAL_COUNT(EVAL_OMAHA_HIGH);
       PokerEvaluation eval[2];
 
       // generate the possible sub hands, player hand candidates are all
@@ -49,6 +51,42 @@ namespace pokerstove
       return PokerHandEvaluation (eval[0]);
     }
 
+    /**
+     * The board candidates are made once for all the hands, and the
+     * hand candidates without allocating.
+     */
+    virtual void evaluateHands (const std::vector<CardSet>& hands, const CardSet& board,
+                                std::vector<PokerHandEvaluation>& evals) const
+    {
+      double combos = boost::math::binomial_coefficient<double>(board.size(),3);
+      std::vector<CardSet> board_candidates(static_cast<size_t>(combos));
+      fillBoards (board_candidates, board);
+
+      evals.resize (hands.size());
+      for (size_t h=0; h<hands.size(); h++)
+        {
+          PEVAL_COUNT(EVAL_OMAHA_HIGH);
+          uint64_t cards[NUM_OMAHA_POCKET];
+          uint64_t m = hands[h].mask();
+          for (int i=0; i<NUM_OMAHA_POCKET; i++)
+            {
+              cards[i] = m & (~m + 1);
+              m ^= cards[i];
+            }
+
+          PokerEvaluation best;
+          for (int i=0; i<NUM_OMAHA_POCKET; i++)
+            for (int j=i+1; j<NUM_OMAHA_POCKET; j++)
+              for (size_t k=0; k<board_candidates.size(); k++)
+                {
+                  PokerEvaluation e = CardSet(cards[i] | cards[j] | board_candidates[k].mask()).evaluateHigh();
+                  if (e > best)
+                    best = e;
+                }
+          evals[h] = PokerHandEvaluation (best);
+        }
+    }
+
     virtual PokerEvaluation evaluateRanks (const CardSet & hand, const CardSet & board) const
     {
       PokerEvaluation eval;
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#include <boost/format.hpp>
+#include "PerfCounters.h"
+
+#ifdef PEVAL_COUNTERS
+#include <boost/atomic.hpp>
+#endif
+
+using namespace std;
+using namespace pokerstove;
+
+namespace
+{
+  const char * COUNTER_NAMES[PerfCounters::NUM_COUNTERS] =
+    {
+      "eval.holdem",
+      "eval.omaha_high",
+      "eval.omaha_eight",
+      "eval.stud",
+      "eval.stud_eight",
+      "eval.razz",
+      "eval.draw_high",
+      "eval.deuce_to_seven",
+      "eval.badugi",
+      "eval.universal",
+      "kernel.high",
+      "kernel.high.flush",
+      "kernel.high_ranks",
+      "kernel.high_flush",
+      "kernel.low_a5",
+      "kernel.low_a5.fast",
+      "kernel.low_a5.short",
+      "kernel.low_a5.general",
+      "kernel.low_8_a5",
+      "kernel.low_8_a5.qualified",
+      "kernel.low_2to7",
+      "kernel.three_card",
+      "kernel.badugi",
+      "kernel.pairing",
+      "enum.boards",
+      "enum.matrix_table.hit",
+      "enum.matrix_table.miss",
+      "enum.strength_lookup",
+    };
+
+#ifdef PEVAL_COUNTERS
+  boost::atomic<uint64_t> counters[PerfCounters::NUM_COUNTERS];
+#endif
+}
+
+PerfCounters::Snapshot::Snapshot ()
+{
+  for (int i=0; i<NUM_COUNTERS; i++)
+    values[i] = 0;
+}
+
+PerfCounters::Snapshot PerfCounters::Snapshot::operator- (const Snapshot& before) const
+{
+  Snapshot ret;
+  for (int i=0; i<NUM_COUNTERS; i++)
+    ret.values[i] = values[i] - before.values[i];
+  return ret;
+}
+
+string PerfCounters::Snapshot::str () const
+{
+  string ret;
+  for (int i=0; i<NUM_COUNTERS; i++)
+    if (values[i] > 0)
+      ret += (boost::format("%-28s %d\n") % COUNTER_NAMES[i] % values[i]).str();
+  return ret;
+}
+
+bool PerfCounters::enabled ()
+{
+#ifdef PEVAL_COUNTERS
+  return true;
+#else
+  return false;
+#endif
+}
+
+const char * PerfCounters::name (Counter c)
+{
+  return COUNTER_NAMES[c];
+}
+
+PerfCounters::Snapshot PerfCounters::snapshot ()
+{
+  Snapshot ret;
+#ifdef PEVAL_COUNTERS
+  for (int i=0; i<NUM_COUNTERS; i++)
+    ret.values[i] = counters[i].load (boost::memory_order_relaxed);
+#endif
+  return ret;
+}
+
+void PerfCounters::reset ()
+{
+#ifdef PEVAL_COUNTERS
+  for (int i=0; i<NUM_COUNTERS; i++)
+    counters[i].store (0, boost::memory_order_relaxed);
+#endif
+}
+
+string PerfCounters::report ()
+{
+  if (!enabled ())
+    return "performance counters are not compiled in, build with -DPEVAL_COUNTERS=ON\n";
+  return snapshot ().str ();
+}
+
+#ifdef PEVAL_COUNTERS
+void PerfCounters::increment (Counter c)
+{
+  counters[c].fetch_add (1, boost::memory_order_relaxed);
+}
+#endif
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef PEVAL_PERFCOUNTERS_H_
+#define PEVAL_PERFCOUNTERS_H_
+
+#include <string>
+#include <boost/cstdint.hpp>
+
+/**
+ * Hot path counters.  They only exist when the library is built with
+ * PEVAL_COUNTERS defined (cmake -DPEVAL_COUNTERS=ON); otherwise
+ * PEVAL_COUNT expands to nothing and snapshots are all zero.
+ *
+ * The counters are shared by all threads and updated with relaxed
+ * atomic increments, so enabling them does slow down threaded code.
+ */
+#ifdef PEVAL_COUNTERS
+#define PEVAL_COUNT(counter) \
+  ::pokerstove::PerfCounters::increment (::pokerstove::PerfCounters::counter)
+#else
+#define PEVAL_COUNT(counter) ((void) 0)
+#endif
+
+namespace pokerstove
+{
+  class PerfCounters
+  {
+  public:
+    enum Counter
+      {
+        // PokerHandEvaluator::evaluateHand, per evaluator
+        EVAL_HOLDEM,
+        EVAL_OMAHA_HIGH,
+        EVAL_OMAHA_EIGHT,
+        EVAL_STUD,
+        EVAL_STUD_EIGHT,
+        EVAL_RAZZ,
+        EVAL_DRAW_HIGH,
+        EVAL_DEUCE_TO_SEVEN,
+        EVAL_BADUGI,
+        EVAL_UNIVERSAL,
+
+        // CardSet kernels, and the paths taken through them
+        HIGH,
+        HIGH_FLUSH,            //!< evaluateHigh returned a flush
+        HIGH_RANKS,
+        HIGH_FLUSH_ONLY,       //!< evaluateHighFlush
+        LOW_A5,
+        LOW_A5_FAST,           //!< no pairs, or five or more ranks
+        LOW_A5_SHORT,          //!< paired with five or fewer cards
+        LOW_A5_GENERAL,        //!< paired with more than five cards
+        LOW_8_A5,
+        LOW_8_A5_QUALIFIED,
+        LOW_2TO7,
+        THREE_CARD,
+        BADUGI,
+        PAIRING,               //!< includes calls from the low kernels
+
+        // enumeration
+        BOARDS,                //!< board runouts or deals evaluated
+        MATRIX_TABLE_HIT,      //!< matrix showdowns served from the runout table
+        MATRIX_TABLE_MISS,     //!< matrix hand evaluations done row by row
+        STRENGTH_LOOKUP,       //!< HandStrengthTable lookups
+
+        NUM_COUNTERS
+      };
+
+    /**
+     * A copy of every counter at one point in time.
+     */
+    struct Snapshot
+    {
+      uint64_t values[NUM_COUNTERS];
+
+      Snapshot ();
+      uint64_t operator[] (Counter c) const { return values[c]; }
+      Snapshot operator- (const Snapshot& before) const;
+
+      /**
+       * one "name value" line per counter which is not zero
+       */
+      std::string str () const;
+    };
+
+    static bool enabled ();
+    static const char * name (Counter c);
+    static Snapshot snapshot ();
+    static void reset ();
+
+    /**
+     * the current counters as text, or a note saying how to enable
+     * them if they were not compiled in
+     */
+    static std::string report ();
+
+#ifdef PEVAL_COUNTERS
+    static void increment (Counter c);
+#endif
+  };
+}
+
+#endif  // PEVAL_PERFCOUNTERS_H_
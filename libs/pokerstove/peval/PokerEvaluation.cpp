@@ -239,6 +239,14 @@ void PokerEvaluation::playAceLow ()
       setMajorRank ((majorRank ().code()+1)%Rank::NUM_RANK);
       break;
     };
+
+  // aces up is now the lowest two pair, so the other pair is the major
+  if (type() == TWO_PAIR && majorRank () < minorRank ())
+    {
+      int major = majorRank ().code();
+      setMajorRank (minorRank ().code());
+      setMinorRank (major);
+    }
 }
 
 void PokerEvaluation::playAceHigh ()
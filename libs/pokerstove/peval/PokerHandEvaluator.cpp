@@ -3,6 +3,7 @@
  * $Id: PokerHandEvaluator.cpp 2649 2012-06-30 04:53:24Z prock $
  */
 #include <iostream>
+#include <pokerstove/util/utypes.h>
 #include "PokerHandEvaluator.h"
 
 using namespace std;
@@ -35,6 +36,33 @@ void display (const vector<CardSet>& hands,
   cout << endl;
 }
 
+void PokerHandEvaluator::evaluateHands (const vector<CardSet>& hands,
+                                        const CardSet& board,
+                                        vector<PokerHandEvaluation>& evals) const
+{
+  evals.resize (hands.size());
+  for (size_t i=0; i<hands.size(); i++)
+    evals[i] = evaluateHand (hands[i], board);
+}
+
+size_t PokerHandEvaluator::evaluateAll (const vector<CardSet>& hands,
+                                        const CardSet& board,
+                                        vector<PokerHandEvaluation>& evals) const
+{
+  size_t nevals = 1;
+  for (size_t i=0; i<evals.size(); i++)
+    {
+      // we track whether or not an eval is used in the nevals
+      // variable to avoid looping through the low half of split
+      // pot games when no one has a low.  This only covers games
+      // which have one or two pots.
+      evals[i] = evaluateHand (hands[i], board);
+      if (nevals == 1 && evals[i].eval(1) > PokerEvaluation(0))
+        nevals = 2;
+    }
+  return nevals;
+}
+
 void PokerHandEvaluator::evaluateShowdown (const vector<CardSet>& hands, 
                                            const CardSet& board,
                                            vector<PokerHandEvaluation>& evals,
@@ -47,19 +75,7 @@ void PokerHandEvaluator::evaluateShowdown (const vector<CardSet>& hands,
   // the number of hands, board or not.  So we use the size of the evals
   // here, not the size of the hand vector
   size_t hsize = evals.size();
-  size_t nevals = 1;
-
-  // gather all the evaluations
-  for (size_t i=0; i<hsize; i++)
-    {
-      // we track whether or not an eval is used in the nevals
-      // variable to avoid looping through the low half of split
-      // pot games when no one has a low.  This only covers games
-      // which have one or two pots.  
-      evals[i] = evaluateHand (hands[i], board);
-      if (nevals == 1 && evals[i].eval(1) > PokerEvaluation(0))
-        nevals = 2;
-    }
+  size_t nevals = evaluateAll (hands, board, evals);
 
   // award share(s)
   for (size_t e=0; e<nevals; e++)
@@ -98,3 +114,175 @@ void PokerHandEvaluator::evaluateShowdown (const vector<CardSet>& hands,
   //display (hands, board, result);
 }
 
+void PokerHandEvaluator::evaluateShowdown (const vector<CardSet>& hands,
+                                           const CardSet& board,
+                                           vector<PokerHandEvaluation>& evals,
+                                           vector<uint64_t>& winUnits,
+                                           vector<uint64_t>& tieUnits,
+                                           uint64_t unit) const
+{
+  awardUnits (evals, evaluateAll (hands, board, evals), winUnits, tieUnits, unit);
+}
+
+void PokerHandEvaluator::splitPot (const vector<PokerHandEvaluation>& evals,
+                                   vector<uint64_t>& winUnits,
+                                   vector<uint64_t>& tieUnits,
+                                   uint64_t unit)
+{
+  size_t nevals = 1;
+  for (size_t i=0; i<evals.size() && nevals == 1; i++)
+    if (evals[i].eval(1) > PokerEvaluation(0))
+      nevals = 2;
+  awardUnits (evals, nevals, winUnits, tieUnits, unit);
+}
+
+void PokerHandEvaluator::awardUnits (const vector<PokerHandEvaluation>& evals, size_t nevals,
+                                     vector<uint64_t>& winUnits,
+                                     vector<uint64_t>& tieUnits,
+                                     uint64_t unit)
+{
+  size_t hsize = evals.size();
+  uint64_t pot = unit / nevals;
+
+  for (size_t e=0; e<nevals; e++)
+    {
+      PokerEvaluation maxeval = evals[0].eval(e);
+      size_t winner = 0;
+      size_t shares = 1;
+      for (size_t i=1; i<hsize; i++)
+        {
+          PokerEvaluation eval = evals[i].eval(e);
+          if (eval > maxeval)
+            {
+              shares = 1;
+              maxeval = eval;
+              winner = i;
+            }
+          else if (eval == maxeval)
+            shares++;
+        }
+      if (shares == 1)
+        winUnits[winner] += pot;
+      else
+        {
+          uint64_t split = pot / shares;
+          for (size_t i=0; i<hsize; i++)
+            if (evals[i].eval(e) == maxeval)
+              tieUnits[i] += split;
+        }
+    }
+}
+
+/**
+ * the number of halves of a pot: two when one of its eligible hands
+ * has a low
+ */
+static size_t potHalves (const vector<PokerHandEvaluation>& evals, uint64_t eligible)
+{
+  for (size_t i=0; i<evals.size(); i++)
+    if ((eligible & (ONE64 << i)) && evals[i].eval(1) > PokerEvaluation(0))
+      return 2;
+  return 1;
+}
+
+/**
+ * the eligible hands with the best eval e, as a mask
+ */
+static uint64_t potWinners (const vector<PokerHandEvaluation>& evals, uint64_t eligible,
+                            size_t e, size_t& count)
+{
+  uint64_t winners = 0;
+  count = 0;
+  PokerEvaluation maxeval;
+  for (size_t i=0; i<evals.size(); i++)
+    {
+      if (!(eligible & (ONE64 << i)))
+        continue;
+      PokerEvaluation eval = evals[i].eval(e);
+      if (count == 0 || eval > maxeval)
+        {
+          maxeval = eval;
+          winners = 0;
+          count = 0;
+        }
+      if (eval == maxeval)
+        {
+          winners |= ONE64 << i;
+          count++;
+        }
+    }
+  return winners;
+}
+
+void PokerHandEvaluator::evaluateShowdown (const vector<CardSet>& hands,
+                                           const CardSet& board,
+                                           vector<PokerHandEvaluation>& evals,
+                                           const vector<SidePot>& pots,
+                                           vector<double>& won,
+                                           double weight) const
+{
+  evaluateAll (hands, board, evals);
+  splitPots (evals, pots, won, weight);
+}
+
+void PokerHandEvaluator::splitPots (const vector<PokerHandEvaluation>& evals,
+                                    const vector<SidePot>& pots,
+                                    vector<double>& won,
+                                    double weight)
+{
+  for (size_t p=0; p<pots.size(); p++)
+    {
+      size_t halves = potHalves (evals, pots[p].eligible);
+      for (size_t e=0; e<halves; e++)
+        {
+          size_t count;
+          uint64_t winners = potWinners (evals, pots[p].eligible, e, count);
+          if (count == 0)
+            continue;
+          double share = pots[p].amount * weight / (halves * count);
+          for (size_t i=0; i<evals.size(); i++)
+            if (winners & (ONE64 << i))
+              won[i] += share;
+        }
+    }
+}
+
+void PokerHandEvaluator::splitPots (const vector<PokerHandEvaluation>& evals,
+                                    const vector<SidePot>& pots,
+                                    vector<uint64_t>& units,
+                                    uint64_t unit)
+{
+  const size_t nhands = evals.size();
+  for (size_t p=0; p<pots.size(); p++)
+    {
+      size_t halves = potHalves (evals, pots[p].eligible);
+      for (size_t e=0; e<halves; e++)
+        {
+          size_t count;
+          uint64_t winners = potWinners (evals, pots[p].eligible, e, count);
+          if (count == 0)
+            continue;
+          uint64_t share = unit / halves / count;
+          for (size_t i=0; i<nhands; i++)
+            if (winners & (ONE64 << i))
+              units[p*nhands+i] += share;
+        }
+    }
+}
+
+uint64_t PokerHandEvaluator::shareUnit (size_t nhands)
+{
+  uint64_t lcm = 1;
+  for (uint64_t n=2; n<=nhands; n++)
+    {
+      uint64_t a = lcm, b = n;
+      while (b != 0)
+        {
+          uint64_t t = a % b;
+          a = b;
+          b = t;
+        }
+      lcm = lcm / a * n;
+    }
+  return 2 * lcm;
+}
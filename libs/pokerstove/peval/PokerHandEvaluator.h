@@ -50,6 +50,21 @@ namespace pokerstove
     }
   };
 
+  /**
+   * One pot of a showdown with side pots: its size, and the hands
+   * which may win it, hand i being bit i of eligible.
+   */
+  struct SidePot
+  {
+    double   amount;
+    uint64_t eligible;
+
+    explicit SidePot (double a=0.0, uint64_t e=0)
+      : amount(a)
+      , eligible(e)
+    {}
+  };
+
   /**
    * A base class for all simple hand evaluation classes.  All we are
    * trying to do here is to abstract the hand evaluation.  No
@@ -95,6 +110,15 @@ namespace pokerstove
     {
       return evaluateHand(hand, board);
     }
+    /**
+     * Evaluate every hand on the same board, into evals, which is
+     * resized to fit.  Evaluators override this to do the work which
+     * only depends on the board once per call, rather than per hand.
+     */
+    virtual void evaluateHands (const std::vector<CardSet>& hands,
+                                const CardSet& board,
+                                std::vector<PokerHandEvaluation>& evals) const;
+
     virtual size_t handSize () const = 0;            //!< return the maximum size of a players hand
     virtual size_t boardSize () const = 0;           //!< return the maximum size of the board
     virtual size_t evaluationSize () const = 0;      //!< return 1 for high only, 2 for high low
@@ -157,12 +181,94 @@ namespace pokerstove
                            std::vector<PokerHandEvaluation>& evals,
                            std::vector<EquityResult>& result,
                            double weight=1.0) const;
-                           
+
+    /**
+     * evaluateShowdown with exact shares.  Each pot is worth unit/2 in a
+     * split pot game with a qualifying low, otherwise unit, and is
+     * divided evenly between the hands which tie for it.  The units
+     * are accumulated in winUnits and tieUnits, which must be as large
+     * as evals.
+     *
+     * unit must be divisible by twice every possible number of tied
+     * hands, shareUnit gives the smallest such unit.  Summing units
+     * is exact and independent of order, unlike summing the fractions
+     * of the double version.
+     */
+    void evaluateShowdown (const std::vector<CardSet>& hands,
+                           const pokerstove::CardSet& board,
+                           std::vector<PokerHandEvaluation>& evals,
+                           std::vector<uint64_t>& winUnits,
+                           std::vector<uint64_t>& tieUnits,
+                           uint64_t unit) const;
+
+    /**
+     * The pot division of the exact evaluateShowdown, for hands which
+     * have already been evaluated: each pot of evals is awarded in
+     * units, and accumulated in winUnits and tieUnits.
+     */
+    static void splitPot (const std::vector<PokerHandEvaluation>& evals,
+                          std::vector<uint64_t>& winUnits,
+                          std::vector<uint64_t>& tieUnits,
+                          uint64_t unit);
+
+    /**
+     * evaluateShowdown with side pots.  Each hand is evaluated once,
+     * and every pot is divided among its eligible hands as the single
+     * pot is: in halves in a split pot game, where the low half goes
+     * with the high when no eligible hand has a low, and evenly
+     * between ties.  won accumulates weight times the amount of each
+     * pot a hand takes, and must be as large as evals.
+     */
+    void evaluateShowdown (const std::vector<CardSet>& hands,
+                           const pokerstove::CardSet& board,
+                           std::vector<PokerHandEvaluation>& evals,
+                           const std::vector<SidePot>& pots,
+                           std::vector<double>& won,
+                           double weight=1.0) const;
+
+    /**
+     * The side pot division of evaluateShowdown, for hands which have
+     * already been evaluated.
+     */
+    static void splitPots (const std::vector<PokerHandEvaluation>& evals,
+                           const std::vector<SidePot>& pots,
+                           std::vector<double>& won,
+                           double weight=1.0);
+
+    /**
+     * The side pot division in exact units, whatever the amounts: the
+     * share of pot p taken by hand i, in units of 1/unit of the pot,
+     * accumulates in units[p*evals.size()+i].  unit is as for the
+     * exact evaluateShowdown.
+     */
+    static void splitPots (const std::vector<PokerHandEvaluation>& evals,
+                           const std::vector<SidePot>& pots,
+                           std::vector<uint64_t>& units,
+                           uint64_t unit);
+
+    /**
+     * 2*lcm(1..nhands), the smallest unit which every split of either
+     * half of a pot between up to nhands hands divides evenly
+     */
+    static uint64_t shareUnit (size_t nhands);
+
 
   protected:
     PokerHandEvaluator ();
 
   private:
+    /**
+     * evaluate every hand into evals, returning the number of pots
+     */
+    size_t evaluateAll (const std::vector<CardSet>& hands,
+                        const pokerstove::CardSet& board,
+                        std::vector<PokerHandEvaluation>& evals) const;
+
+    static void awardUnits (const std::vector<PokerHandEvaluation>& evals, size_t nevals,
+                            std::vector<uint64_t>& winUnits,
+                            std::vector<uint64_t>& tieUnits,
+                            uint64_t unit);
+
     // non-copyable
     PokerHandEvaluator (const PokerHandEvaluator&);     
     PokerHandEvaluator& operator=(const PokerHandEvaluator&);
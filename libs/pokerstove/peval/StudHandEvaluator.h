@@ -6,6 +6,7 @@
 #define PEVAL_STUDHANDEVALUATOR_H_
 
 #include "PokerHandEvaluator.h"
+#include "PerfCounters.h"
 
 namespace pokerstove 
 {
@@ -18,6 +19,7 @@ namespace pokerstove
 
     virtual PokerHandEvaluation evaluateHand (const CardSet & hand, const CardSet&) const
     {
+      PEVAL_COUNT(EVAL_STUD);
       //return hand.evaluateHighRanks ();
       return PokerHandEvaluation(hand.evaluateHigh ());
     }
@@ -22,6 +22,7 @@
 #include "Card.h"
 #include "CardSet.h"
 #include "PokerHandEvaluator.h"
+#include "PerfCounters.h"
 
 namespace pokerstove
 {
@@ -83,6 +84,7 @@ namespace pokerstove
                           
     virtual PokerHandEvaluation evaluateHand (const CardSet & hand, const CardSet & board) const
     {
+      PEVAL_COUNT(EVAL_UNIVERSAL);
       PokerEvaluation eval[2];
 
       // check to see if the input hand is consistent with the game
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2012 Andrew Prock. All rights reserved.
+ * $Id$
+ */
+#ifndef POKERSTOVE_UTIL_PHILOX_H_
+#define POKERSTOVE_UTIL_PHILOX_H_
+
+#include <pokerstove/util/utypes.h>
+
+namespace pokerstove
+{
+  /**
+   * Philox4x32-10, the counter based generator of Salmon et al.,
+   * "Parallel random numbers: as easy as 1, 2, 3" (SC11).  Each output
+   * block is a pure function of a 128 bit counter and a 64 bit key,
+   * so any position of any stream can be computed directly, with no
+   * state carried from the draws before it.
+   *
+   * A generator is the stream (key, stream): the high half of the
+   * counter is the stream number and the low half counts blocks of
+   * four 32 bit outputs.  Engines give every unit of work its own
+   * stream, for example
+   *
+   *   Philox4x32 rng (seed, trial);
+   *
+   * so a unit draws the same numbers whichever thread or shard runs
+   * it, and on any machine.  uniform() and below() are defined here
+   * rather than taken from a distribution library so that they are
+   * reproducible too.
+   *
+   * It satisfies the uniform random number generator requirements, so
+   * it can also drive the boost and std distributions.
+   */
+  class Philox4x32
+  {
+  public:
+    typedef uint32_t result_type;
+
+    explicit Philox4x32 (uint64_t key=0, uint64_t stream=0)
+    {
+      _key[0] = static_cast<uint32_t>(key);
+      _key[1] = static_cast<uint32_t>(key >> 32);
+      _stream = stream;
+      seek (0);
+    }
+
+    static result_type min () { return 0; }
+    static result_type max () { return 0xFFFFFFFFu; }
+
+    result_type operator() ()
+    {
+      if (_used == 4)
+        {
+          _block++;
+          refill ();
+        }
+      return _out[_used++];
+    }
+
+    /**
+     * jump to the given 32 bit output of the stream, in constant time
+     */
+    void seek (uint64_t position)
+    {
+      _block = position / 4;
+      refill ();
+      _used = static_cast<size_t>(position % 4);
+    }
+
+    void discard (uint64_t n) { seek (position () + n); }
+
+    /**
+     * number of 32 bit outputs drawn from the stream so far
+     */
+    uint64_t position () const { return _block*4 + _used; }
+
+    uint64_t key () const { return static_cast<uint64_t>(_key[0]) | (static_cast<uint64_t>(_key[1]) << 32); }
+    uint64_t stream () const { return _stream; }
+
+    uint64_t next64 ()
+    {
+      uint64_t lo = (*this)();
+      uint64_t hi = (*this)();
+      return lo | (hi << 32);
+    }
+
+    /**
+     * uniform on [0,1), with 53 random bits
+     */
+    double uniform ()
+    {
+      return static_cast<double>(next64 () >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * uniform on [0,n), n > 0, by rejection so there is no bias
+     */
+    uint64_t below (uint64_t n)
+    {
+      if (n <= 0xFFFFFFFFu)
+        {
+          uint32_t n32 = static_cast<uint32_t>(n);
+          uint32_t limit = static_cast<uint32_t>(0x100000000uLL % n);
+          while (true)
+            {
+              uint64_t m = static_cast<uint64_t>((*this)()) * n32;
+              if (static_cast<uint32_t>(m) >= limit)
+                return m >> 32;
+            }
+        }
+      uint64_t limit = (0 - n) % n;
+      while (true)
+        {
+          uint64_t r = next64 ();
+          if (r >= limit)
+            return r % n;
+        }
+    }
+
+    /**
+     * the Philox4x32-10 bijection: out = f_key(ctr)
+     */
+    static void block (const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4])
+    {
+      uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+      uint32_t k0 = key[0], k1 = key[1];
+      for (int round=0; round<10; round++)
+        {
+          if (round > 0)
+            {
+              k0 += 0x9E3779B9u;
+              k1 += 0xBB67AE85u;
+            }
+          uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * c0;
+          uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * c2;
+          uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+          uint32_t n1 = static_cast<uint32_t>(p1);
+          uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+          uint32_t n3 = static_cast<uint32_t>(p0);
+          c0 = n0; c1 = n1; c2 = n2; c3 = n3;
+        }
+      out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+    }
+
+  private:
+    void refill ()
+    {
+      uint32_t ctr[4];
+      ctr[0] = static_cast<uint32_t>(_block);
+      ctr[1] = static_cast<uint32_t>(_block >> 32);
+      ctr[2] = static_cast<uint32_t>(_stream);
+      ctr[3] = static_cast<uint32_t>(_stream >> 32);
+      block (ctr, _key, _out);
+      _used = 0;
+    }
+
+    uint32_t _key[2];
+    uint64_t _stream;
+    uint64_t _block;
+    uint32_t _out[4];
+    size_t   _used;
+  };
+}
+
+#endif  // POKERSTOVE_UTIL_PHILOX_H_
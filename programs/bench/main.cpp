@@ -0,0 +1,253 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/PokerEvaluation.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+typedef PokerEvaluation (CardSet::*Kernel) () const;
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * The kernels and the input distributions each one is measured on.
+ * Only inputs the kernel is meant for are used: evaluateHighFlush
+ * expects a flush, evaluate3CP three cards, and evaluateBadugi four.
+ */
+struct KernelSpec
+{
+	string         name;
+	Kernel         kernel;
+	vector<string> inputs;
+};
+
+static vector<KernelSpec> kernelSpecs ()
+{
+	vector<KernelSpec> specs = {
+		{ "evaluateHigh",      &CardSet::evaluateHigh,      { "random5", "random6", "random7", "flush7" } },
+		{ "evaluateHighRanks", &CardSet::evaluateHighRanks, { "random5", "random7" } },
+		{ "evaluateHighFlush", &CardSet::evaluateHighFlush, { "flush7" } },
+		{ "evaluateLowA5",     &CardSet::evaluateLowA5,     { "random5", "random7", "razz7" } },
+		{ "evaluate8LowA5",    &CardSet::evaluate8LowA5,    { "random5", "random7", "razz7" } },
+		{ "evaluateLow2to7",   &CardSet::evaluateLow2to7,   { "random5", "random7" } },
+		{ "evaluate3CP",       &CardSet::evaluate3CP,       { "random3" } },
+		{ "evaluateBadugi",    &CardSet::evaluateBadugi,    { "random4" } },
+		{ "evaluatePairing",   &CardSet::evaluatePairing,   { "random7", "razz7" } },
+	};
+	return specs;
+}
+
+/**
+ * Draw hands from one of the named distributions:
+ *   randomN   N cards uniformly from the deck
+ *   flush7    seven cards with at least five of one suit
+ *   razz7     seven cards from the six lowest ranks, so most hands
+ *             hold one or more pairs, the slow case for the low kernels
+ */
+static vector<CardSet> makeHands (const string& input, size_t count, mt19937& rng)
+{
+	vector<CardSet> hands;
+	hands.reserve (count);
+	uniform_int_distribution<int> anyCard (0, CardSet::STANDARD_DECK_SIZE-1);
+	uniform_int_distribution<int> anySuit (0, Suit::NUM_SUIT-1);
+	uniform_int_distribution<int> anyRank (0, Rank::NUM_RANK-1);
+	uniform_int_distribution<int> lowRank (0, 5);
+
+	for (size_t i=0; i<count; i++)
+	{
+		uint64_t mask = 0;
+		if (input.compare (0, 6, "random") == 0)
+		{
+			size_t n = boost::lexical_cast<size_t>(input.substr (6));
+			while (CardSet(mask).size() < n)
+				mask |= ONE64 << anyCard (rng);
+		}
+		else if (input == "flush7")
+		{
+			int suit = anySuit (rng);
+			while (CardSet(mask).size() < 5)
+				mask |= ONE64 << (anyRank (rng) + Rank::NUM_RANK*suit);
+			while (CardSet(mask).size() < 7)
+				mask |= ONE64 << anyCard (rng);
+		}
+		else if (input == "razz7")
+		{
+			// ace low: ace, two, ... six
+			while (CardSet(mask).size() < 7)
+			{
+				int r = lowRank (rng);
+				int rank = r == 0 ? Rank::NUM_RANK-1 : r-1;
+				mask |= ONE64 << (rank + Rank::NUM_RANK*anySuit (rng));
+			}
+		}
+		else
+			throw std::invalid_argument ("unknown input: " + input);
+		hands.push_back (CardSet (mask));
+	}
+	return hands;
+}
+
+/**
+ * cache warm: cycle over a small set of inputs which stays in L1, so
+ * the kernel's tables are hot.
+ */
+static double warmNs (Kernel kernel, const vector<CardSet>& hands, size_t evals, int& sink)
+{
+	int acc = 0;
+	Clock::time_point start = Clock::now ();
+	for (size_t done=0; done<evals; )
+	{
+		for (size_t i=0; i<hands.size() && done<evals; i++, done++)
+			acc += (hands[i].*kernel)().code();
+	}
+	double ns = chrono::duration<double,nano>(Clock::now () - start).count();
+	sink += acc;
+	return ns / evals;
+}
+
+/**
+ * cache cold: before each short batch of evaluations, walk a buffer
+ * larger than the last level cache so the inputs and the kernel's
+ * tables have to come from memory.  Only the batches are timed.
+ */
+static double coldNs (Kernel kernel, const vector<CardSet>& hands, size_t batch,
+					  vector<uint64_t>& evict, int& sink)
+{
+	int acc = 0;
+	double ns = 0.0;
+	size_t evals = 0;
+	for (size_t first=0; first+batch<=hands.size(); first+=batch)
+	{
+		uint64_t x = 0;
+		for (size_t i=0; i<evict.size(); i+=8)
+			x += evict[i]++;
+		acc += static_cast<int>(x);
+
+		Clock::time_point start = Clock::now ();
+		for (size_t i=first; i<first+batch; i++)
+			acc += (hands[i].*kernel)().code();
+		ns += chrono::duration<double,nano>(Clock::now () - start).count();
+		evals += batch;
+	}
+	sink += acc;
+	return ns / evals;
+}
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   Measures the ns per evaluation of the CardSet evaluation kernels\n"
+        "   on a set of input distributions, with the tables in cache (warm)\n"
+        "   and after evicting the caches (cold).\n"
+        "\n"
+        "   inputs: random3..random7, flush7, razz7\n"
+        "\n"
+        "   examples:\n"
+		"		./bench\n"
+		"		./bench --kernel evaluateLowA5 --mode warm --evals 100000000\n"
+		"		./bench --csv > kernels.csv\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("kernel,k", po::value<string>()->default_value(""),     "only run this kernel")
+            ("input,i",  po::value<string>()->default_value(""),     "only use this input distribution")
+            ("mode,m",   po::value<string>()->default_value("both"), "warm, cold, or both")
+            ("evals,n",  po::value<size_t>()->default_value(20000000), "evaluations per warm measurement")
+            ("cold",     po::value<size_t>()->default_value(256),    "batches per cold measurement")
+            ("batch",    po::value<size_t>()->default_value(64),     "evaluations per cold batch")
+            ("evict",    po::value<size_t>()->default_value(32),     "size in MB of the eviction buffer")
+            ("seed",     po::value<uint32_t>()->default_value(5489), "random seed for the inputs")
+            ("csv",                                                  "print comma separated values")
+            ;
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .run(), vm);
+        po::notify (vm);
+
+		// check for help
+        if (vm.count("help"))
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		string onlyKernel = vm["kernel"].as<string>();
+		string onlyInput  = vm["input"].as<string>();
+		string mode       = vm["mode"].as<string>();
+		if (mode != "warm" && mode != "cold" && mode != "both")
+			throw std::invalid_argument ("unknown mode: " + mode);
+		bool csv = vm.count("csv") > 0;
+		size_t evals = vm["evals"].as<size_t>();
+		size_t batch = vm["batch"].as<size_t>();
+		size_t coldHands = vm["cold"].as<size_t>() * batch;
+		vector<uint64_t> evict (vm["evict"].as<size_t>()*1024*1024/sizeof(uint64_t), 1);
+
+		if (csv)
+			cout << "kernel,input,mode,ns_per_eval,checksum\n";
+		else
+			cout << boost::format("%-18s %-8s %-5s %12s\n") % "kernel" % "input" % "mode" % "ns/eval";
+
+		int found = 0;
+		for (const KernelSpec& spec: kernelSpecs ())
+		{
+			if (!onlyKernel.empty() && onlyKernel != spec.name)
+				continue;
+			for (const string& input: spec.inputs)
+			{
+				if (!onlyInput.empty() && onlyInput != input)
+					continue;
+				found++;
+
+				// every kernel sees the same hands for a given input
+				mt19937 rng (vm["seed"].as<uint32_t>());
+				vector<string> modes;
+				if (mode != "cold") modes.push_back ("warm");
+				if (mode != "warm") modes.push_back ("cold");
+				for (const string& m: modes)
+				{
+					int sink = 0;
+					double ns;
+					if (m == "warm")
+						ns = warmNs (spec.kernel, makeHands (input, 1024, rng), evals, sink);
+					else
+						ns = coldNs (spec.kernel, makeHands (input, coldHands, rng), batch, evict, sink);
+
+					if (csv)
+						cout << boost::format("%s,%s,%s,%.3f,%d\n") % spec.name % input % m % ns % sink;
+					else
+						cout << boost::format("%-18s %-8s %-5s %12.3f\n") % spec.name % input % m % ns;
+				}
+			}
+		}
+		if (found == 0)
+			throw std::invalid_argument ("no kernel and input match: " + onlyKernel + " " + onlyInput);
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <pokerstove/peval/Holdem.h>
+#include <pokerstove/penum/BucketTable.h>
+#include <pokerstove/penum/HandStrengthTable.h>
+#include <pokerstove/penum/KMeans.h>
+#include <pokerstove/penum/ThreadPool.h>
+#include <pokerstove/penum/Trace.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+static size_t parseStreet (const string& s)
+{
+	if (s == "preflop" || s == "0")
+		return PREFLOP;
+	if (s == "flop" || s == "1")
+		return FLOP;
+	if (s == "turn" || s == "2")
+		return TURN;
+	throw std::invalid_argument ("street must be preflop, flop or turn: " + s);
+}
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   Clusters the suit isomorphic hold'em states of a street into\n"
+        "   buckets by their river hand strength histograms, computed from\n"
+        "   an expected hand strength table (see ehs), with k-means under\n"
+        "   the earth mover's or L2 distance.  Writes the bucket of every\n"
+        "   state, indexed by its isomorphism index.  Histograms stay in\n"
+        "   memory: 4 bytes per bin per state.\n"
+        "\n"
+        "   examples:\n"
+		"		./cluster --table ehs.pshs --street flop -k 200 -o flop.psbk -t 8\n"
+		"		./cluster --table ehs.pshs --street turn --bins 30 --distance l2 -k 500 -o turn.psbk\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("table",      po::value<string>(),                        "expected hand strength table")
+            ("street,s",   po::value<string>()->default_value("flop"), "street to cluster: preflop, flop or turn")
+            ("bins",       po::value<size_t>()->default_value(50),     "histogram bins")
+            ("clusters,k", po::value<size_t>()->default_value(200),    "number of buckets")
+            ("distance",   po::value<string>()->default_value("emd"),  "emd or l2")
+            ("iterations", po::value<size_t>()->default_value(100),    "maximum k-means iterations")
+            ("tolerance",  po::value<double>()->default_value(0.0),    "stop when at most this fraction of states move")
+            ("seed",       po::value<uint64_t>()->default_value(1),    "seed for the initial centers")
+            ("limit",      po::value<uint64_t>(),                      "only cluster the first states of the street")
+            ("output,o",   po::value<string>(),                        "bucket table to write")
+            ("threads,t",  po::value<size_t>()->default_value(1),      "number of threads")
+            ("pin",                                                    "pin each thread to a cpu")
+            ("trace",      po::value<string>(),                        "write a chrome trace of the run to a file")
+            ;
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .run(), vm);
+        po::notify (vm);
+		if (vm.count("trace"))
+			Trace::enable ();
+
+		// check for help
+        if (vm.count("help") || argc == 1)
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		if (!vm.count("table") || !vm.count("output"))
+			throw std::invalid_argument ("a table and an output file are required");
+
+		size_t street = parseStreet (vm["street"].as<string>());
+		size_t bins = vm["bins"].as<size_t>();
+		size_t k = vm["clusters"].as<size_t>();
+		string dist = vm["distance"].as<string>();
+		if (dist != "emd" && dist != "l2")
+			throw std::invalid_argument ("distance must be emd or l2: " + dist);
+
+		ThreadPool::configureShared (vm["threads"].as<size_t>(), vm.count("pin") > 0);
+
+		HandStrengthTable table (vm["table"].as<string>());
+		uint64_t nstates = table.indexer().size (street);
+		if (vm.count("limit"))
+			nstates = min (nstates, vm["limit"].as<uint64_t>());
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+		vector<float> points (nstates * bins);
+		table.histograms (street, 0, nstates, bins, &points[0]);
+		if (dist == "emd")
+			KMeans::cumulative (&points[0], nstates, bins);
+		double histSeconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+
+		start = chrono::steady_clock::now ();
+		KMeans kmeans (k, bins, dist == "emd" ? KMeans::EMD : KMeans::L2);
+		kmeans.setSeed (vm["seed"].as<uint64_t>());
+		kmeans.setMaxIterations (vm["iterations"].as<size_t>());
+		kmeans.setTolerance (vm["tolerance"].as<double>());
+		kmeans.run (&points[0], nstates);
+		double clusterSeconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+
+		string filename = vm["output"].as<string>();
+		BucketTable::write (filename, street, k, kmeans.assignment ());
+
+		vector<uint64_t> sizes (k, 0);
+		for (uint32_t b: kmeans.assignment ())
+			sizes[b]++;
+		cout << boost::format("%d states, %d buckets (%d to %d states), %d iterations, cost %.6g\n")
+			% nstates % k % *min_element (sizes.begin(), sizes.end())
+			% *max_element (sizes.begin(), sizes.end())
+			% kmeans.iterations () % kmeans.cost ();
+		cout << boost::format("histograms %.3fs, clustering %.3fs, written to %s\n")
+			% histSeconds % clusterSeconds % filename;
+		if (vm.count("trace"))
+			Trace::writeChrome (vm["trace"].as<string>());
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include <pokerstove/penum/HandStrengthTable.h>
+#include <pokerstove/penum/ThreadPool.h>
+#include <pokerstove/penum/Trace.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+/**
+ * write the spans recorded with --trace or --trace-markers
+ */
+static void writeTrace (const po::variables_map& vm)
+{
+	if (vm.count("trace"))
+		Trace::writeChrome (vm["trace"].as<string>());
+	if (vm.count("trace-markers"))
+		Trace::writePerfMarkers (vm["trace-markers"].as<string>());
+}
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   Generates or queries the hold'em expected hand strength table.\n"
+        "   EHS is the chance of beating one random hand, averaged over the\n"
+        "   rest of the board, and EHS2 the average of its square.  The table\n"
+        "   covers every suit isomorphic state and is about 1.1GB.\n"
+        "\n"
+        "   examples:\n"
+		"		./ehs --generate ehs.pshs --threads 8\n"
+		"		./ehs --table ehs.pshs --hand AcKd --board 5c8s9h\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("generate",  po::value<string>(),                       "compute the table and write it to a file")
+            ("threads,t", po::value<size_t>()->default_value(1),     "number of threads used to generate")
+            ("pin",                                                  "pin each thread to a cpu")
+            ("table",     po::value<string>(),                       "table file to query")
+            ("hand,h",    po::value<string>(),                       "hole cards to look up")
+            ("board,b",   po::value<string>()->default_value(""),    "community cards")
+            ("counters",                                             "print the performance counters on exit")
+            ("memory",                                               "print the memory held per component on exit")
+            ("preload",                                              "read the whole table into memory before the lookup")
+            ("trace",     po::value<string>(),                       "write a chrome trace of the run to a file")
+            ("trace-markers", po::value<string>(),                   "write perf script style span markers to a file")
+            ;
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .run(), vm);
+        po::notify (vm);
+		if (vm.count("trace") || vm.count("trace-markers"))
+			Trace::enable ();
+
+		// check for help
+        if (vm.count("help") || argc == 1)
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		if (vm.count("generate"))
+		{
+			string filename = vm["generate"].as<string>();
+			ThreadPool::configureShared (vm["threads"].as<size_t>(), vm.count("pin") > 0);
+			HandStrengthTable::generate (filename);
+			cout << "table written to " << filename << "\n";
+			if (vm.count("counters"))
+				cerr << PerfCounters::report ();
+			writeTrace (vm);
+			return 0;
+		}
+
+		if (!vm.count("table") || !vm.count("hand"))
+			throw std::invalid_argument ("a table and a hand are required");
+
+		HandStrengthTable table (vm["table"].as<string>());
+		if (vm.count("preload"))
+			table.preload ();
+		CardSet hand (vm["hand"].as<string>());
+		CardSet board (vm["board"].as<string>());
+		const HandStrength& hs = table.lookup (hand, board);
+		cout << boost::format("%s %s ehs: %.6f ehs2: %.6f\n")
+			% hand.str() % board.str() % hs.ehs % hs.ehs2;
+		if (vm.count("counters"))
+			cerr << PerfCounters::report ();
+		if (vm.count("memory"))
+		{
+			MemoryFootprint mem;
+			MemoryFootprint::addStaticTables (mem);
+			table.memoryFootprint (mem);
+			cerr << mem.str ();
+		}
+		writeTrace (vm);
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/algorithm/string.hpp>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include <pokerstove/penum/CardDistribution.h>
+#include <pokerstove/penum/EquityJob.h>
+#include <pokerstove/penum/RankShowdownEnumerator.h>
+#include <pokerstove/penum/ShowdownEnumerator.h>
+#include <pokerstove/penum/ThreadPool.h>
+#include <pokerstove/penum/Trace.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+/**
+ * A fixed equity calculation with known results.  Exact scenarios are
+ * checked to within rounding, sampled ones to within their tolerance.
+ * When scoops are listed they are checked as well.
+ */
+struct Scenario
+{
+	string         name;
+	string         game;
+	vector<string> hands;
+	string         board;
+	string         dead;
+	uint64_t       trials;       //!< zero for exact enumeration
+	double         tolerance;
+	vector<double> equity;
+	vector<double> scoop;
+};
+
+static const double EXACT = 1e-6;
+
+static vector<Scenario> catalogue ()
+{
+	vector<Scenario> s = {
+		{ "holdem-hu-preflop", "h", { "AcAd", "KhKs" }, "", "", 0, EXACT,
+		  { 0.81255490, 0.18744510 }, {} },
+		{ "holdem-hu-flop", "h", { "AsKs", "random" }, "Js8s2d", "", 0, EXACT,
+		  { 0.71695867, 0.28304133 }, {} },
+		{ "holdem-6way-preflop", "h", { "AcAd", "KhKs", "QcJc", "9s9h", "7d6d", "AhKd" }, "", "", 0, EXACT,
+		  { 0.39090634, 0.09587801, 0.14688955, 0.14861445, 0.18796808, 0.02974356 }, {} },
+		{ "holdem-6way-flop", "h", { "AcAd", "KhKs", "QcJc", "9s9h", "7d6d", "random" }, "Tc8d2s", "", 0, EXACT,
+		  { 0.58860784, 0.07640029, 0.11439577, 0.05426986, 0.06888771, 0.09743853 }, {} },
+		{ "omaha-4way-preflop", "O", { "AcAdKcKd", "JhTh9s8s", "QcQsJd7h", "6c5c4d3d" }, "", "", 0, EXACT,
+		  { 0.32579206, 0.35691076, 0.11440694, 0.20289025 }, {} },
+		{ "omaha8-scoop-preflop", "o", { "Ac2c3dKd", "AhAs4h5s" }, "", "", 0, EXACT,
+		  { 0.45106942, 0.54893058 }, { 0.29739560, 0.39524571 } },
+		// enumerated by rank multisets, the cards are too many to deal
+		{ "razz-3rd-street", "r", { "As2d3c", "4h5h6c", "KsQd2h" }, "", "7c8dTsJh", 0, EXACT,
+		  { 0.53914042, 0.41169680, 0.04916278 }, {} },
+		{ "badugi-vs-random", "b", { "2c5d8hJs", "random" }, "", "", 0, EXACT,
+		  { 0.97792939, 0.02207061 }, {} },
+	};
+	return s;
+}
+
+/**
+ * write the spans recorded with --trace or --trace-markers
+ */
+static void writeTrace (const po::variables_map& vm)
+{
+	if (vm.count("trace"))
+		Trace::writeChrome (vm["trace"].as<string>());
+	if (vm.count("trace-markers"))
+		Trace::writePerfMarkers (vm["trace-markers"].as<string>());
+}
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   Runs a fixed catalogue of equity scenarios, checks each result\n"
+        "   against its known value, and prints one CSV line per scenario\n"
+        "   with the throughput.  The exit status is non-zero if any\n"
+        "   scenario is wrong.  Exact scenarios of games without suits\n"
+        "   or a board are enumerated by rank multisets (mode ranks),\n"
+        "   which evaluate no showdown per deal: their showdowns and\n"
+        "   showdowns_per_sec are left empty, and deals counts the card\n"
+        "   deals the multisets stand for.\n"
+        "\n"
+        "   examples:\n"
+		"		./eqbench\n"
+		"		./eqbench --threads 4 --scenario holdem-6way-preflop\n"
+		"		./eqbench --list\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("scenario,s", po::value<string>()->default_value(""),  "only run this scenario")
+            ("threads,t",  po::value<size_t>()->default_value(1),   "number of threads")
+            ("pin",                                                 "pin each thread to a cpu")
+            ("seed",       po::value<uint32_t>()->default_value(1), "seed for sampled scenarios")
+            ("progress",                                            "run each scenario as a background job, printing its running estimate")
+            ("list",                                                "list the scenarios")
+            ("counters",                                            "print the performance counters on exit")
+            ("memory",                                              "print the memory held per component after each scenario")
+            ("trace",      po::value<string>(),                     "write a chrome trace of the run to a file")
+            ("trace-markers", po::value<string>(),                  "write perf script style span markers to a file")
+            ;
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .run(), vm);
+        po::notify (vm);
+		if (vm.count("trace") || vm.count("trace-markers"))
+			Trace::enable ();
+
+		// check for help
+        if (vm.count("help"))
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		vector<Scenario> scenarios = catalogue ();
+		if (vm.count("list"))
+		{
+			for (const Scenario& sc: scenarios)
+				cout << boost::format("%-22s %s %s board:%s dead:%s %s\n")
+					% sc.name % sc.game % boost::join (sc.hands, ",") % sc.board % sc.dead
+					% (sc.trials > 0 ? "sampled" : "exact");
+			return 0;
+		}
+
+		string only = vm["scenario"].as<string>();
+		size_t threads = vm["threads"].as<size_t>();
+		ThreadPool::configureShared (threads, vm.count("pin") > 0);
+		bool failed = false;
+		int found = 0;
+		cout << "scenario,game,mode,threads,showdowns,deals,seconds,showdowns_per_sec,max_error,equity,status\n";
+		for (const Scenario& sc: scenarios)
+		{
+			if (!only.empty() && only != sc.name)
+				continue;
+			found++;
+			TraceSpan span ("scenario", "job", sc.name);
+
+			boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc (sc.game);
+			vector<CardDistribution> players;
+			for (const string& h: sc.hands)
+				players.push_back (CardDistribution (h, peval->handSize()));
+			ShowdownEnumerator enumerator (peval, players, CardSet (sc.board), CardSet (sc.dead));
+
+			bool ranks = sc.trials == 0 && !peval->usesSuits() && peval->boardSize() == 0;
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+			ShowdownResult result;
+			if (ranks)
+				result = RankShowdownEnumerator (peval, players, CardSet (sc.dead)).enumerate ();
+			else if (vm.count("progress"))
+			{
+				boost::shared_ptr<EquityJob> job = sc.trials > 0
+					? EquityJob::sample (enumerator, sc.trials, vm["seed"].as<uint32_t>())
+					: EquityJob::enumerate (enumerator);
+				while (!job->waitFor (boost::posix_time::milliseconds (250)))
+				{
+					ShowdownResult estimate = job->estimate ();
+					cerr << boost::format("%s %5.1f%%") % sc.name % (100.0 * job->progress ());
+					for (size_t i=0; i<players.size(); i++)
+						cerr << boost::format(" %.4f") % estimate.equity (i);
+					cerr << "\n";
+				}
+				result = job->result ();
+			}
+			else
+				result = sc.trials > 0
+					? enumerator.sample (sc.trials, vm["seed"].as<uint32_t>())
+					: enumerator.enumerate ();
+			double seconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+
+			double maxError = 0.0;
+			vector<string> equities;
+			for (size_t i=0; i<players.size(); i++)
+			{
+				maxError = max (maxError, fabs (result.equity (i) - sc.equity[i]));
+				if (!sc.scoop.empty())
+					maxError = max (maxError, fabs (result.scoopEquity (i) - sc.scoop[i]));
+				equities.push_back ((boost::format("%.8f") % result.equity (i)).str());
+			}
+			if (vm.count("memory"))
+			{
+				MemoryFootprint mem;
+				MemoryFootprint::addStaticTables (mem);
+				enumerator.memoryFootprint (mem);
+				cerr << sc.name << ":\n" << mem.str ();
+			}
+			bool ok = maxError <= sc.tolerance;
+			failed = failed || !ok;
+
+			// a rank multiset stands for many deals, so its rate is not one of showdowns
+			string showdowns, rate;
+			if (!ranks)
+			{
+				showdowns = (boost::format("%d") % result.showdowns).str();
+				rate = (boost::format("%.0f") % (result.showdowns / seconds)).str();
+			}
+			cout << boost::format("%s,%s,%s,%d,%s,%d,%.6f,%s,%.2e,%s,%s\n")
+				% sc.name % sc.game % (ranks ? "ranks" : sc.trials > 0 ? "sampled" : "exact") % threads
+				% showdowns % result.showdowns % seconds % rate % maxError
+				% boost::join (equities, ";") % (ok ? "ok" : "FAIL");
+		}
+		if (found == 0)
+			throw std::invalid_argument ("unknown scenario: " + only);
+		if (vm.count("counters"))
+			cerr << PerfCounters::report ();
+		writeTrace (vm);
+		return failed ? 2 : 0;
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/format.hpp>
 #include <pokerstove/peval/PokerHandEvaluator.h>
+#include <pokerstove/peval/PerfCounters.h>
 
 using namespace std;
 namespace po = boost::program_options;
@@ -85,6 +86,7 @@ int main (int argc, char ** argv)
             ("game,g",    po::value<string>()->default_value("h"), "game to use for evaluation")
             ("board,b",   po::value<string>()->default_value(""),  "community cards for he/o/o8")
             ("hand,h",    po::value< vector<string> >(),           "a hand for evaluation")
+            ("counters",                                           "print the performance counters on exit")
             ;
       
         po::positional_options_description p;
@@ -110,6 +112,8 @@ int main (int argc, char ** argv)
 						  vm["board"].as<string>());
 		driver.evaluate();
 		cout << driver.str();
+		if (vm.count("counters"))
+			cerr << PerfCounters::report ();
     }
     catch(std::exception& e) 
     {
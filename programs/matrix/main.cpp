@@ -0,0 +1,168 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/format.hpp>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include <pokerstove/peval/MemoryFootprint.h>
+#include <pokerstove/peval/PerfCounters.h>
+#include <pokerstove/penum/CardDistribution.h>
+#include <pokerstove/penum/ThreadPool.h>
+#include <pokerstove/penum/Trace.h>
+#include <pokerstove/penum/EquityMatrix.h>
+#include <pokerstove/penum/EquityMatrixEnumerator.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+/**
+ * print a matrix file as text, one row per line
+ */
+int dumpMatrix (const string& filename)
+{
+	ifstream in (filename.c_str(), ios::binary);
+	if (!in)
+		throw std::runtime_error ("unable to open " + filename);
+
+	EquityMatrixReader reader (in);
+	const EquityMatrixHeader& h = reader.header();
+	cout << "# game: " << h.game << "\n"
+		 << "# board: " << h.board << "\n"
+		 << "# dead: " << h.dead << "\n"
+		 << "# rows: " << h.rowRange << " (" << h.rows.size() << ")\n"
+		 << "# cols: " << h.colRange << " (" << h.cols.size() << ")\n";
+
+	vector<float> row;
+	while (reader.readRow (row))
+	{
+		cout << h.rows[reader.rowsRead()-1].str();
+		for (float e: row)
+			cout << " " << boost::format("%.6f") % e;
+		cout << "\n";
+	}
+	return 0;
+}
+
+/**
+ * write the spans recorded with --trace or --trace-markers
+ */
+static void writeTrace (const po::variables_map& vm)
+{
+	if (vm.count("trace"))
+		Trace::writeChrome (vm["trace"].as<string>());
+	if (vm.count("trace-markers"))
+		Trace::writePerfMarkers (vm["trace-markers"].as<string>());
+}
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   Writes the heads up equity of every row hand against every column\n"
+        "   hand as a chunked binary file.  Hands which share cards get NaN.\n"
+        "   See programs/eval for the list of games.\n"
+        "\n"
+        "   examples:\n"
+		"		./matrix --rows AA,KK --cols random --board 5c8s9h -o aa.psem\n"
+		"		./matrix --rows random --cols random --board 5c8s9hTd --format f16 -o turn.psem\n"
+		"		./matrix --dump aa.psem\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("game,g",    po::value<string>()->default_value("h"),   "game to use for evaluation")
+            ("board,b",   po::value<string>()->default_value(""),    "community cards")
+            ("dead,d",    po::value<string>()->default_value(""),    "dead cards")
+            ("rows,r",    po::value<string>()->default_value("random"), "row range")
+            ("cols,c",    po::value<string>()->default_value("random"), "column range")
+            ("output,o",  po::value<string>(),                       "matrix file to write")
+            ("format,f",  po::value<string>()->default_value("f32"), "value format, f32 or f16")
+            ("chunk",     po::value<uint32_t>()->default_value(64),  "rows per chunk")
+            ("threads,t", po::value<size_t>()->default_value(1),     "number of threads")
+            ("pin",                                                  "pin each thread to a cpu")
+            ("dump",      po::value<string>(),                       "print a matrix file as text")
+            ("counters",                                             "print the performance counters on exit")
+            ("memory",                                               "print the memory held per component on exit")
+            ("trace",     po::value<string>(),                       "write a chrome trace of the run to a file")
+            ("trace-markers", po::value<string>(),                   "write perf script style span markers to a file")
+            ;
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .run(), vm);
+        po::notify (vm);
+		if (vm.count("trace") || vm.count("trace-markers"))
+			Trace::enable ();
+
+		// check for help
+        if (vm.count("help") || argc == 1)
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		if (vm.count("dump"))
+			return dumpMatrix (vm["dump"].as<string>());
+
+		if (!vm.count("output"))
+			throw std::invalid_argument ("an output file is required");
+
+		string game = vm["game"].as<string>();
+		boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc (game);
+		CardDistribution rows (vm["rows"].as<string>(), peval->handSize());
+		CardDistribution cols (vm["cols"].as<string>(), peval->handSize());
+		ThreadPool::configureShared (vm["threads"].as<size_t>(), vm.count("pin") > 0);
+		EquityMatrixEnumerator enumerator (peval,
+										   CardSet (vm["board"].as<string>()),
+										   CardSet (vm["dead"].as<string>()));
+
+		EquityMatrixHeader header = enumerator.header (game, rows, cols);
+		string format = vm["format"].as<string>();
+		if (format == "f16")
+			header.valueFormat = EquityMatrixHeader::FLOAT16;
+		else if (format != "f32")
+			throw std::invalid_argument ("unknown format: " + format);
+		header.chunkRows = vm["chunk"].as<uint32_t>();
+
+		string filename = vm["output"].as<string>();
+		ofstream out (filename.c_str(), ios::binary);
+		if (!out)
+			throw std::runtime_error ("unable to open " + filename);
+		EquityMatrixWriter writer (out, header);
+		enumerator.calculate (rows, cols, writer);
+		cout << boost::format("%d x %d matrix, %d runouts, written to %s\n")
+			% rows.size() % cols.size() % enumerator.numRunouts() % filename;
+		if (vm.count("counters"))
+			cerr << PerfCounters::report ();
+		if (vm.count("memory"))
+		{
+			MemoryFootprint mem;
+			MemoryFootprint::addStaticTables (mem);
+			enumerator.memoryFootprint (mem);
+			rows.memoryFootprint (mem, "rows");
+			cols.memoryFootprint (mem, "cols");
+			cerr << mem.str ();
+		}
+		writeTrace (vm);
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}
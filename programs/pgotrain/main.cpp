@@ -0,0 +1,210 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include <pokerstove/penum/CardDistribution.h>
+#include <pokerstove/penum/EquityMatrixEnumerator.h>
+#include <pokerstove/penum/ShowdownEnumerator.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+/**
+ * The share of random showdowns dealt for each game, roughly in
+ * proportion to how often the games are queried.  Hold'em and omaha
+ * dominate, the rest keep every kernel and its branches warm.
+ */
+struct GameMix
+{
+	string game;
+	int    showdowns;      //!< thousands, at scale 1
+};
+
+static const GameMix MIX[] = {
+	{ "h", 600 },
+	{ "O", 150 },
+	{ "o", 100 },
+	{ "s",  40 },
+	{ "e",  40 },
+	{ "r",  40 },
+	{ "q",  20 },
+	{ "d",  20 },
+	{ "k",  20 },
+	{ "l",  20 },
+	{ "t",  20 },
+	{ "T",  20 },
+	{ "b",  20 },
+	{ "3",  20 },
+};
+
+/**
+ * Deal random showdowns of 2 to 6 players, with the board at a random
+ * street from the flop on for flop games, and evaluate them.
+ */
+static uint64_t randomShowdowns (const string& game, uint64_t count, boost::random::mt19937& rng)
+{
+	boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc (game);
+	size_t handSize  = peval->handSize ();
+	size_t boardSize = peval->boardSize ();
+	size_t maxPlayers = min<size_t> (6, (CardSet::STANDARD_DECK_SIZE - boardSize) / handSize);
+
+	boost::random::uniform_int_distribution<int> card (0, CardSet::STANDARD_DECK_SIZE-1);
+	boost::random::uniform_int_distribution<size_t> players (2, maxPlayers);
+	boost::random::uniform_int_distribution<size_t> street (0, 2);
+	const size_t STREET_CARDS[] = { 3, 4, 5 };
+
+	vector<CardSet> hands;
+	vector<PokerHandEvaluation> evals;
+	vector<EquityResult> results;
+	for (uint64_t i=0; i<count; i++)
+	{
+		size_t n = players (rng);
+		hands.assign (n, CardSet ());
+		evals.resize (n);
+		results.assign (n, EquityResult ());
+
+		// the board runs out in full for showdowns, partial boards
+		// exercise the shorter evaluations through evaluateHand
+		size_t bsize = boardSize > 0 ? min (boardSize, STREET_CARDS[street (rng)]) : 0;
+		uint64_t used = 0;
+		CardSet board;
+		while (board.size() < bsize)
+		{
+			uint64_t c = ONE64 << card (rng);
+			if (!(c & used)) { used |= c; board |= CardSet (c); }
+		}
+		for (size_t p=0; p<n; p++)
+			while (hands[p].size() < handSize)
+			{
+				uint64_t c = ONE64 << card (rng);
+				if (!(c & used)) { used |= c; hands[p] |= CardSet (c); }
+			}
+
+		if (bsize == boardSize)
+			peval->evaluateShowdown (hands, board, evals, results);
+		else
+			for (size_t p=0; p<n; p++)
+				evals[p] = peval->evaluateHand (hands[p], board);
+	}
+	return count;
+}
+
+struct EquityQuery
+{
+	string         game;
+	vector<string> hands;
+	string         board;
+	uint64_t       trials;      //!< 0 to enumerate
+};
+
+static const EquityQuery QUERIES[] = {
+	{ "h", { "AcAd", "KhKs" },                "Js8s2d",   0 },
+	{ "h", { "AA,KK,QQ,AKs", "random" },      "Js8s2d5h", 0 },
+	{ "h", { "AsKs", "QQ", "random" },        "",         200000 },
+	{ "O", { "AcAd2s3h", "KhKsQdJd" },        "Js8s2d",   0 },
+	{ "o", { "Ac2c3dKd", "AhAs4h5s", "random" }, "",     100000 },
+	{ "e", { "Ac2c3d", "KhKs4d", "7h8h9s" },  "",         50000 },
+	{ "r", { "As2d3c", "4h5h6c", "KsQd2h" },  "",         50000 },
+	{ "b", { "2c5d8hJs", "random" },          "",         0 },
+};
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   The training workload for profile guided builds.  It deals random\n"
+        "   showdowns in every game, in roughly the mix they are queried,\n"
+        "   then runs exact and sampled equity calculations and a small\n"
+        "   equity matrix.  See PEVAL_PGO in programs/CMakeLists.txt.\n"
+        "\n"
+        "   examples:\n"
+		"		./pgotrain\n"
+		"		./pgotrain --scale 0.1\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("scale",    po::value<double>()->default_value(1.0),  "multiply the amount of work")
+            ("seed",     po::value<uint32_t>()->default_value(1),  "seed for the random deals")
+            ;
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .run(), vm);
+        po::notify (vm);
+
+		// check for help
+        if (vm.count("help"))
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		double scale = vm["scale"].as<double>();
+		boost::random::mt19937 rng (vm["seed"].as<uint32_t>());
+
+		for (const GameMix& m: MIX)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+			uint64_t n = randomShowdowns (m.game, static_cast<uint64_t>(m.showdowns * 1000 * scale), rng);
+			double seconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+			cout << boost::format("showdowns %s: %d in %.3fs\n") % m.game % n % seconds;
+		}
+
+		for (const EquityQuery& q: QUERIES)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+			boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc (q.game);
+			vector<CardDistribution> players;
+			for (const string& h: q.hands)
+				players.push_back (CardDistribution (h, peval->handSize()));
+			ShowdownEnumerator enumerator (peval, players, CardSet (q.board));
+			ShowdownResult result = q.trials > 0
+				? enumerator.sample (static_cast<uint64_t>(q.trials * scale) + 1, vm["seed"].as<uint32_t>())
+				: enumerator.enumerate ();
+			double seconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+			cout << boost::format("equity %s %s: %d showdowns in %.3fs\n")
+				% q.game % q.hands[0] % result.showdowns % seconds;
+		}
+
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+			boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc ("h");
+			CardDistribution rows ("AA,KK,QQ,JJ,AKs,AKo", 2);
+			CardDistribution cols ("random", 2);
+			EquityMatrixEnumerator enumerator (peval, CardSet ("Ks7d2c"));
+			ostringstream out;
+			EquityMatrixWriter writer (out, enumerator.header ("h", rows, cols));
+			enumerator.calculate (rows, cols, writer);
+			double seconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+			cout << boost::format("matrix %d x %d in %.3fs\n") % rows.size() % cols.size() % seconds;
+		}
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include <pokerstove/penum/CardDistribution.h>
+#include <pokerstove/penum/ShowdownEnumerator.h>
+#include <pokerstove/penum/ShowdownShard.h>
+#include <pokerstove/penum/ThreadPool.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+/**
+ * parse "a/b" or "a-b" into its two numbers
+ */
+static pair<uint64_t,uint64_t> parsePair (const string& s, char sep)
+{
+	size_t p = s.find (sep);
+	if (p == string::npos)
+		throw std::invalid_argument ("expected two numbers separated by " + string (1, sep) + ": " + s);
+	return make_pair (boost::lexical_cast<uint64_t> (s.substr (0, p)),
+					  boost::lexical_cast<uint64_t> (s.substr (p+1)));
+}
+
+/**
+ * parse "amount:i,j,..." into a side pot the players i, j, ... contest
+ */
+static SidePot parsePot (const string& s)
+{
+	size_t p = s.find (':');
+	if (p == string::npos)
+		throw std::invalid_argument ("expected amount:players for a pot: " + s);
+	SidePot pot (boost::lexical_cast<double> (s.substr (0, p)));
+	string players = s.substr (p+1);
+	for (size_t b=0; b<=players.size(); )
+	{
+		size_t e = players.find (',', b);
+		if (e == string::npos)
+			e = players.size();
+		size_t i = boost::lexical_cast<size_t> (players.substr (b, e-b));
+		if (i >= 64)
+			throw std::invalid_argument ("no such player in pot: " + s);
+		pot.eligible |= ONE64 << i;
+		b = e+1;
+	}
+	return pot;
+}
+
+static vector<ShowdownShard> readShards (const vector<string>& files)
+{
+	vector<ShowdownShard> shards;
+	for (const string& f: files)
+	{
+		ifstream in (f.c_str(), ios::binary);
+		if (!in)
+			throw std::runtime_error ("unable to open " + f);
+		try
+		{
+			shards.push_back (ShowdownShard::read (in));
+		}
+		catch (std::exception& e)
+		{
+			throw std::runtime_error (f + ": " + e.what());
+		}
+	}
+	return shards;
+}
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   Runs one shard of a showdown equity job and writes its partial\n"
+        "   result, or merges the shards of a job.  The job is split into a\n"
+        "   fixed list of chunks, so the shards can run as separate processes\n"
+        "   on any hosts, and the merged result is the same bit for bit as a\n"
+        "   single run.  Shard files carry their chunk range and a checksum;\n"
+        "   --missing lists the chunk ranges still to run, which --chunks\n"
+        "   reruns.\n"
+        "\n"
+        "   examples:\n"
+		"		./shard -g O -h AA,KK -h random --shard 3/16 -o part03.pss\n"
+		"		./shard -g O -h AA,KK -h random --chunks 120-192 -o rerun.pss\n"
+		"		./shard -h AA -h KK -h QQ --pot 300:1,2 --shard 0/4 -o pots0.pss\n"
+		"		./shard --missing part*.pss rerun.pss\n"
+		"		./shard --merge part*.pss rerun.pss\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("game,g",    po::value<string>()->default_value("h"),    "game to use for evaluation")
+            ("board,b",   po::value<string>()->default_value(""),     "community cards")
+            ("dead,d",    po::value<string>()->default_value(""),     "dead cards")
+            ("hand,h",    po::value<vector<string> >(),              "a player's range, once per player")
+            ("trials,n",  po::value<uint64_t>()->default_value(0),   "sample this many deals, 0 to enumerate")
+            ("seed",      po::value<uint32_t>()->default_value(1),   "seed for sampling")
+            ("pot,p",     po::value<vector<string> >(),              "a side pot, amount:players, e.g. 300:1,2")
+            ("shard,s",   po::value<string>()->default_value("0/1"), "run shard k/n of the job")
+            ("chunks",    po::value<string>(),                        "run chunks first-last of the job instead")
+            ("output,o",  po::value<string>(),                        "shard file to write")
+            ("threads,t", po::value<size_t>()->default_value(1),     "number of threads")
+            ("pin",                                                   "pin each thread to a cpu")
+            ("merge",                                                 "merge the shard files given")
+            ("missing",                                               "list the chunks the shard files given leave out")
+            ("files",     po::value<vector<string> >(),              "shard files")
+            ;
+
+        po::positional_options_description files;
+        files.add ("files", -1);
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .positional(files)
+                   .run(), vm);
+        po::notify (vm);
+
+		// check for help
+        if (vm.count("help") || argc == 1)
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		if (vm.count("merge") || vm.count("missing"))
+		{
+			if (!vm.count("files"))
+				throw std::invalid_argument ("no shard files given");
+			vector<ShowdownShard> shards = readShards (vm["files"].as<vector<string> >());
+
+			if (vm.count("missing"))
+			{
+				vector<pair<uint64_t,uint64_t> > gaps = ShowdownShard::missing (shards);
+				for (size_t i=0; i<gaps.size(); i++)
+					cout << gaps[i].first << "-" << gaps[i].second << "\n";
+				return gaps.empty() ? 0 : 2;
+			}
+
+			const ShowdownShard& job = shards[0];
+			ShowdownResult result = ShowdownShard::merge (shards);
+			cout << boost::format("game %s board %s dead %s %s %d shards %d chunks %d showdowns\n")
+				% job.game % job.board % job.dead
+				% (job.trials > 0 ? "sampled" : "exact")
+				% shards.size() % job.totalChunks % result.showdowns;
+			for (size_t i=0; i<job.ranges.size(); i++)
+				cout << boost::format("%-30s equity %.8f scoop %.8f\n")
+					% job.ranges[i] % result.equity (i) % result.scoopEquity (i);
+			for (size_t p=0; p<job.pots.size(); p++)
+				for (size_t i=0; i<job.ranges.size(); i++)
+					if (job.pots[p].eligible & (ONE64 << i))
+						cout << boost::format("pot %d %-26s equity %.8f\n")
+							% p % job.ranges[i] % result.potEquity (p, i);
+			return 0;
+		}
+
+		if (!vm.count("hand") || !vm.count("output"))
+			throw std::invalid_argument ("the hands and an output file are required");
+
+		ThreadPool::configureShared (vm["threads"].as<size_t>(), vm.count("pin") > 0);
+
+		ShowdownShard shard;
+		shard.game   = vm["game"].as<string>();
+		shard.board  = vm["board"].as<string>();
+		shard.dead   = vm["dead"].as<string>();
+		shard.ranges = vm["hand"].as<vector<string> >();
+		shard.trials = vm["trials"].as<uint64_t>();
+		shard.seed   = vm["seed"].as<uint32_t>();
+		if (vm.count("pot"))
+			for (const string& p: vm["pot"].as<vector<string> >())
+				shard.pots.push_back (parsePot (p));
+
+		boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc (shard.game);
+		vector<CardDistribution> players;
+		for (const string& r: shard.ranges)
+			players.push_back (CardDistribution (r, peval->handSize()));
+		ShowdownEnumerator enumerator (peval, players, CardSet (shard.board), CardSet (shard.dead));
+		enumerator.setPots (shard.pots);
+
+		uint64_t total = shard.trials > 0 ? ShowdownEnumerator::sampleChunks (shard.trials)
+			: enumerator.enumerateChunks ();
+		pair<uint64_t,uint64_t> range;
+		if (vm.count("chunks"))
+			range = parsePair (vm["chunks"].as<string>(), '-');
+		else
+		{
+			pair<uint64_t,uint64_t> kn = parsePair (vm["shard"].as<string>(), '/');
+			range = ShowdownShard::shardRange (total, kn.first, kn.second);
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+		shard.run (enumerator, range.first, range.second);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+
+		// write to a temporary name and rename, so a failed run never
+		// leaves a partial file behind to be merged
+		string filename = vm["output"].as<string>();
+		string tmp = filename + ".tmp";
+		{
+			ofstream out (tmp.c_str(), ios::binary);
+			if (!out)
+				throw std::runtime_error ("unable to open " + tmp);
+			shard.write (out);
+		}
+		if (rename (tmp.c_str(), filename.c_str()) != 0)
+			throw std::runtime_error ("unable to rename " + tmp + " to " + filename);
+
+		cerr << boost::format("chunks %d-%d of %d in %.3fs, written to %s\n")
+			% range.first % range.second % total % seconds % filename;
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,902 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <pokerstove/util/utypes.h>
+#include <pokerstove/util/philox.h>
+#include <pokerstove/peval/CardSet.h>
+#include <pokerstove/peval/PokerHandEvaluator.h>
+#include <pokerstove/penum/CardDistribution.h>
+#include <pokerstove/penum/HoldemHandIndexer.h>
+#include <pokerstove/penum/OmahaHandIndexer.h>
+#include <pokerstove/penum/RangeEquityEnumerator.h>
+#include <pokerstove/penum/ShowdownEnumerator.h>
+#include <pokerstove/penum/ShowdownShard.h>
+#include <pokerstove/penum/ThreadPool.h>
+
+using namespace std;
+namespace po = boost::program_options;
+using namespace pokerstove;
+
+/**
+ * A backend and the reference it must agree with, on every hand of a
+ * domain.  The exhaustive domains visit every hand, the sampled ones
+ * draw random hands:
+ *   all5      every 5 card hand
+ *   all7      every 7 card hand
+ *   omaha     4 card hands with a random 3, 4 or 5 card board
+ *   stud7     7 card hands
+ *   badugi    4 card hands
+ *
+ * A batch backend evaluates many hands on one board at a time, and
+ * each entry must agree with the reference for that hand.  It takes
+ * the place of the backend, and the domains are dealt as boards:
+ *   all7      every 7 card hand, as 2 hole cards below a 5 card board
+ *   omaha     batches of 4 card hands on a random 3, 4 or 5 card board
+ *
+ * An engine check compares an enumeration engine against another way
+ * of getting the same numbers, on the shared pool, in domain engine;
+ * an indexer check visits or samples the states of a hand indexer,
+ * in domain indexer.  Their hands are the items they compared.
+ */
+struct CheckRun;
+
+typedef PokerHandEvaluation (*EvalFunction) (const CardSet& hand, const CardSet& board);
+typedef void (*BatchFunction) (const vector<CardSet>& hands, const CardSet& board,
+							   vector<PokerHandEvaluation>& evals);
+typedef void (*EngineFunction) (CheckRun& run);
+
+struct Check
+{
+	string         name;
+	string         domain;
+	EvalFunction   backend;
+	EvalFunction   reference;
+	BatchFunction  batch;
+	EngineFunction engine;
+};
+
+// evaluators under test, shared by all threads, evaluateHand is const
+static boost::shared_ptr<PokerHandEvaluator> holdem     = PokerHandEvaluator::alloc ("h");
+static boost::shared_ptr<PokerHandEvaluator> omahaHigh  = PokerHandEvaluator::alloc ("O");
+static boost::shared_ptr<PokerHandEvaluator> omahaEight = PokerHandEvaluator::alloc ("o");
+static boost::shared_ptr<PokerHandEvaluator> studEight  = PokerHandEvaluator::alloc ("e");
+static boost::shared_ptr<PokerHandEvaluator> badugi     = PokerHandEvaluator::alloc ("b");
+
+/**
+ * The best evaluation over every subset of n cards, with both halves
+ * maximised independently.
+ */
+static PokerEvaluation bestSubset (const CardSet& cards, size_t n,
+								   PokerEvaluation (CardSet::*kernel) () const)
+{
+	vector<CardSet> c = cards.cardSets ();
+	PokerEvaluation best;
+	vector<size_t> idx (n);
+	for (size_t i=0; i<n; i++)
+		idx[i] = i;
+	while (true)
+	{
+		CardSet sub;
+		for (size_t i=0; i<n; i++)
+			sub |= c[idx[i]];
+		PokerEvaluation e = (sub.*kernel) ();
+		if (e > best)
+			best = e;
+
+		size_t i = n;
+		while (i > 0 && idx[i-1] == c.size() - n + i - 1)
+			i--;
+		if (i == 0)
+			break;
+		idx[i-1]++;
+		for (size_t j=i; j<n; j++)
+			idx[j] = idx[j-1] + 1;
+	}
+	return best;
+}
+
+/**
+ * Omaha by brute force: two cards from the hand, three from the board.
+ */
+static PokerEvaluation bestOmaha (const CardSet& hand, const CardSet& board,
+								  PokerEvaluation (CardSet::*kernel) () const)
+{
+	vector<CardSet> h = hand.cardSets ();
+	vector<CardSet> b = board.cardSets ();
+	PokerEvaluation best;
+	for (size_t i=0; i<h.size(); i++)
+		for (size_t j=i+1; j<h.size(); j++)
+			for (size_t k=0; k<b.size(); k++)
+				for (size_t l=k+1; l<b.size(); l++)
+					for (size_t m=l+1; m<b.size(); m++)
+					{
+						PokerEvaluation e = (CardSet (h[i] | h[j] | b[k] | b[l] | b[m]).*kernel) ();
+						if (e > best)
+							best = e;
+					}
+	return best;
+}
+
+static PokerHandEvaluation refHigh (const CardSet& hand, const CardSet& board)
+{
+	return PokerHandEvaluation (CardSet (hand | board).evaluateHigh ());
+}
+
+static PokerHandEvaluation refLowA5 (const CardSet& hand, const CardSet&)
+{
+	return PokerHandEvaluation (hand.evaluateLowA5 ());
+}
+
+static PokerHandEvaluation holdemEvaluator (const CardSet& hand, const CardSet& board)
+{
+	return holdem->evaluateHand (hand, board);
+}
+
+// the flush and rank only kernels, dispatched on whether there is a flush
+static PokerHandEvaluation splitHigh (const CardSet& hand, const CardSet&)
+{
+	PokerEvaluation e = hand.evaluateHighFlush ();
+	if (e == PokerEvaluation (0))
+		e = hand.evaluateHighRanks ();
+	return PokerHandEvaluation (e);
+}
+
+static PokerHandEvaluation bestFiveHigh (const CardSet& hand, const CardSet&)
+{
+	return PokerHandEvaluation (bestSubset (hand, 5, &CardSet::evaluateHigh));
+}
+
+static PokerHandEvaluation bestFiveLowA5 (const CardSet& hand, const CardSet&)
+{
+	return PokerHandEvaluation (bestSubset (hand, 5, &CardSet::evaluateLowA5));
+}
+
+static void holdemBatch (const vector<CardSet>& hands, const CardSet& board,
+						 vector<PokerHandEvaluation>& evals)
+{
+	holdem->evaluateHands (hands, board, evals);
+}
+
+static PokerHandEvaluation omahaHighEvaluator (const CardSet& hand, const CardSet& board)
+{
+	return omahaHigh->evaluateHand (hand, board);
+}
+
+static void omahaHighBatch (const vector<CardSet>& hands, const CardSet& board,
+							vector<PokerHandEvaluation>& evals)
+{
+	omahaHigh->evaluateHands (hands, board, evals);
+}
+
+static PokerHandEvaluation refOmahaHigh (const CardSet& hand, const CardSet& board)
+{
+	return PokerHandEvaluation (bestOmaha (hand, board, &CardSet::evaluateHigh));
+}
+
+static PokerHandEvaluation omahaEightEvaluator (const CardSet& hand, const CardSet& board)
+{
+	return omahaEight->evaluateHand (hand, board);
+}
+
+static PokerHandEvaluation refOmahaEight (const CardSet& hand, const CardSet& board)
+{
+	return PokerHandEvaluation (bestOmaha (hand, board, &CardSet::evaluateHigh),
+								bestOmaha (hand, board, &CardSet::evaluate8LowA5));
+}
+
+static PokerHandEvaluation studEightEvaluator (const CardSet& hand, const CardSet& board)
+{
+	return studEight->evaluateHand (hand, board);
+}
+
+static PokerHandEvaluation refStudEight (const CardSet& hand, const CardSet&)
+{
+	return PokerHandEvaluation (bestSubset (hand, 5, &CardSet::evaluateHigh),
+								bestSubset (hand, 5, &CardSet::evaluate8LowA5));
+}
+
+static PokerHandEvaluation badugiEvaluator (const CardSet& hand, const CardSet& board)
+{
+	return badugi->evaluateHand (hand, board);
+}
+
+// the best subset with no repeated rank or suit
+static PokerHandEvaluation refBadugi (const CardSet& hand, const CardSet&)
+{
+	vector<CardSet> c = hand.cardSets ();
+	PokerEvaluation best;
+	for (size_t m=1; m<(1u<<c.size()); m++)
+	{
+		CardSet sub;
+		for (size_t i=0; i<c.size(); i++)
+			if (m & (1u<<i))
+				sub |= c[i];
+		if (sub.countSuits () != sub.size () || sub.countRanks () != sub.size ())
+			continue;
+		PokerEvaluation e = sub.evaluateBadugi ();
+		if (e > best)
+			best = e;
+	}
+	return PokerHandEvaluation (best);
+}
+
+static void shardMerge (CheckRun& run);
+static void rangeEquity (CheckRun& run);
+static void omahaIndexer (CheckRun& run);
+static void holdemIndexer (CheckRun& run);
+
+static vector<Check> checks ()
+{
+	vector<Check> c = {
+		{ "holdem-evaluator",  "all5",   holdemEvaluator,     refHigh },
+		{ "holdem-evaluator",  "all7",   holdemEvaluator,     refHigh },
+		{ "holdem-batch",      "all7",   0,                   holdemEvaluator,    holdemBatch },
+		{ "high-split",        "all5",   splitHigh,           refHigh },
+		{ "high-split",        "all7",   splitHigh,           refHigh },
+		{ "high-best-five",    "all7",   refHigh,             bestFiveHigh },
+		{ "lowa5-best-five",   "all7",   refLowA5,            bestFiveLowA5 },
+		{ "omaha-high",        "omaha",  omahaHighEvaluator,  refOmahaHigh },
+		{ "omaha-high-batch",  "omaha",  0,                   omahaHighEvaluator, omahaHighBatch },
+		{ "omaha-eight",       "omaha",  omahaEightEvaluator, refOmahaEight },
+		{ "stud-eight",        "stud7",  studEightEvaluator,  refStudEight },
+		{ "badugi",            "badugi", badugiEvaluator,     refBadugi },
+		{ "shard-merge",       "engine", 0,                   0,                  0,            shardMerge },
+		{ "range-equity",      "engine", 0,                   0,                  0,            rangeEquity },
+		{ "omaha-indexer",     "indexer", 0,                  0,                  0,            omahaIndexer },
+		{ "holdem-indexer",    "indexer", 0,                  0,                  0,            holdemIndexer },
+	};
+	return c;
+}
+
+/**
+ * Shared state of one check: the next job to hand out, the mismatch
+ * count, and the first few mismatches for the report.
+ */
+struct CheckRun
+{
+	const Check *   check;
+	size_t          ncards;
+	uint64_t        samples;
+	uint32_t        seed;
+	size_t          nthreads;
+
+	boost::mutex    lock;
+	size_t          nextJob;
+	uint64_t        hands;
+	uint64_t        mismatches;
+	vector<string>  examples;
+};
+
+static const size_t MAX_EXAMPLES = 10;
+static const size_t BATCH_SIZE   = 16;   //!< hands per sampled batch
+
+static void report (CheckRun& run, const CardSet& hand, const CardSet& board,
+					const PokerHandEvaluation& got, uint64_t& mismatches)
+{
+	PokerHandEvaluation want = run.check->reference (hand, board);
+	if (got.eval(0) == want.eval(0) && got.eval(1) == want.eval(1))
+		return;
+
+	mismatches++;
+	boost::mutex::scoped_lock guard (run.lock);
+	if (run.examples.size() < MAX_EXAMPLES)
+		run.examples.push_back ((boost::format("%s %s backend %x/%x reference %x/%x")
+								 % hand.str() % board.str()
+								 % got.eval(0).code() % got.eval(1).code()
+								 % want.eval(0).code() % want.eval(1).code()).str());
+}
+
+static void compare (CheckRun& run, const CardSet& hand, const CardSet& board,
+					 uint64_t& mismatches)
+{
+	report (run, hand, board, run.check->backend (hand, board), mismatches);
+}
+
+static void compareBatch (CheckRun& run, const vector<CardSet>& hands, const CardSet& board,
+						  vector<PokerHandEvaluation>& evals, uint64_t& mismatches)
+{
+	run.check->batch (hands, board, evals);
+	for (size_t i=0; i<hands.size(); i++)
+		report (run, hands[i], board, evals[i], mismatches);
+}
+
+// every way to add n more cards above card "from" to the hand
+static void extend (CheckRun& run, uint64_t hand, int from, size_t n,
+					uint64_t& hands, uint64_t& mismatches)
+{
+	if (n == 0)
+	{
+		compare (run, CardSet (hand), CardSet (), mismatches);
+		hands++;
+		return;
+	}
+	for (int c=from; c<=static_cast<int>(CardSet::STANDARD_DECK_SIZE - n); c++)
+		extend (run, hand | (ONE64 << c), c+1, n-1, hands, mismatches);
+}
+
+/**
+ * The exhaustive domains are split into one job per pair of lowest
+ * cards, handed out on demand so the threads finish together.
+ */
+static void exhaustiveWorker (CheckRun * run)
+{
+	const int DECK = CardSet::STANDARD_DECK_SIZE;
+	uint64_t hands = 0;
+	uint64_t mismatches = 0;
+	while (true)
+	{
+		size_t job;
+		{
+			boost::mutex::scoped_lock guard (run->lock);
+			job = run->nextJob++;
+		}
+		if (job >= static_cast<size_t>(DECK*DECK))
+			break;
+		int a = static_cast<int>(job) / DECK;
+		int b = static_cast<int>(job) % DECK;
+		if (b <= a)
+			continue;
+		extend (*run, (ONE64 << a) | (ONE64 << b), b+1, run->ncards-2, hands, mismatches);
+	}
+
+	boost::mutex::scoped_lock guard (run->lock);
+	run->hands      += hands;
+	run->mismatches += mismatches;
+}
+
+// every way to add n more cards above card "from" to the board, each
+// board evaluated as one batch of the hole cards below it
+static void extendBoard (CheckRun& run, const vector<CardSet>& holes, uint64_t board,
+						 int from, size_t n, vector<PokerHandEvaluation>& evals,
+						 uint64_t& hands, uint64_t& mismatches)
+{
+	if (n == 0)
+	{
+		compareBatch (run, holes, CardSet (board), evals, mismatches);
+		hands += holes.size();
+		return;
+	}
+	for (int c=from; c<=static_cast<int>(CardSet::STANDARD_DECK_SIZE - n); c++)
+		extendBoard (run, holes, board | (ONE64 << c), c+1, n-1, evals, hands, mismatches);
+}
+
+/**
+ * Batch checks over all7 split each hand into its two lowest cards
+ * and a board of the other five, so that every 7 card hand is seen
+ * once.  The jobs are the pairs of lowest board cards, and the hole
+ * cards are every pair below them.
+ */
+static void exhaustiveBatchWorker (CheckRun * run)
+{
+	const int DECK = CardSet::STANDARD_DECK_SIZE;
+	uint64_t hands = 0;
+	uint64_t mismatches = 0;
+	vector<CardSet> holes;
+	vector<PokerHandEvaluation> evals;
+	while (true)
+	{
+		size_t job;
+		{
+			boost::mutex::scoped_lock guard (run->lock);
+			job = run->nextJob++;
+		}
+		if (job >= static_cast<size_t>(DECK*DECK))
+			break;
+		int a = static_cast<int>(job) / DECK;
+		int b = static_cast<int>(job) % DECK;
+		if (b <= a || a < 2)
+			continue;
+		holes.clear ();
+		for (int i=0; i<a; i++)
+			for (int j=i+1; j<a; j++)
+				holes.push_back (CardSet ((ONE64 << i) | (ONE64 << j)));
+		extendBoard (*run, holes, (ONE64 << a) | (ONE64 << b), b+1, 3, evals, hands, mismatches);
+	}
+
+	boost::mutex::scoped_lock guard (run->lock);
+	run->hands      += hands;
+	run->mismatches += mismatches;
+}
+
+// sample i is drawn from its own stream, so the same hands are checked
+// whatever the number of threads
+static void sampleWorker (CheckRun * run, size_t thread)
+{
+	const string& domain = run->check->domain;
+
+	uint64_t n = 0;
+	uint64_t mismatches = 0;
+	for (uint64_t i=thread; i<run->samples; i+=run->nthreads, n++)
+	{
+		Philox4x32 rng (run->seed, i);
+		size_t hsize = domain == "stud7" ? 7 : 4;
+		size_t bsize = domain == "omaha" ? 3 + rng.below (3) : 0;
+		uint64_t hand = 0;
+		uint64_t board = 0;
+		while (CardSet (hand).size() < hsize)
+			hand |= ONE64 << rng.below (CardSet::STANDARD_DECK_SIZE);
+		while (CardSet (board).size() < bsize)
+		{
+			uint64_t c = ONE64 << rng.below (CardSet::STANDARD_DECK_SIZE);
+			if (!(c & hand))
+				board |= c;
+		}
+		compare (*run, CardSet (hand), CardSet (board), mismatches);
+	}
+
+	boost::mutex::scoped_lock guard (run->lock);
+	run->hands      += n;
+	run->mismatches += mismatches;
+}
+
+// each sample is a board and a batch of hands which avoid it
+static void sampleBatchWorker (CheckRun * run, size_t thread)
+{
+	uint64_t n = 0;
+	uint64_t mismatches = 0;
+	vector<CardSet> hands (BATCH_SIZE);
+	vector<PokerHandEvaluation> evals;
+	uint64_t batches = (run->samples + BATCH_SIZE - 1) / BATCH_SIZE;
+	for (uint64_t i=thread; i<batches; i+=run->nthreads)
+	{
+		Philox4x32 rng (run->seed, i);
+		size_t bsize = 3 + rng.below (3);
+		uint64_t board = 0;
+		while (CardSet (board).size() < bsize)
+			board |= ONE64 << rng.below (CardSet::STANDARD_DECK_SIZE);
+		for (size_t h=0; h<BATCH_SIZE; h++)
+		{
+			uint64_t hand = 0;
+			while (CardSet (hand).size() < 4)
+			{
+				uint64_t c = ONE64 << rng.below (CardSet::STANDARD_DECK_SIZE);
+				if (!(c & board))
+					hand |= c;
+			}
+			hands[h] = CardSet (hand);
+		}
+		compareBatch (*run, hands, CardSet (board), evals, mismatches);
+		n += BATCH_SIZE;
+	}
+
+	boost::mutex::scoped_lock guard (run->lock);
+	run->hands      += n;
+	run->mismatches += mismatches;
+}
+
+static void fail (CheckRun& run, const string& what)
+{
+	run.mismatches++;
+	if (run.examples.size() < MAX_EXAMPLES)
+		run.examples.push_back (what);
+}
+
+// bit for bit, exact counts included
+static bool sameResult (const ShowdownResult& a, const ShowdownResult& b)
+{
+	if (a.weight != b.weight || a.showdowns != b.showdowns || a.unit != b.unit
+		|| a.scoops != b.scoops || a.potShares != b.potShares
+		|| a.winUnits != b.winUnits || a.tieUnits != b.tieUnits
+		|| a.scoopCount != b.scoopCount || a.potUnits != b.potUnits
+		|| a.shares.size() != b.shares.size())
+		return false;
+	for (size_t i=0; i<a.shares.size(); i++)
+		if (a.shares[i].winShares != b.shares[i].winShares
+			|| a.shares[i].tieShares != b.shares[i].tieShares)
+			return false;
+	return true;
+}
+
+/**
+ * Each job is run as three shards, written and read back, and merged,
+ * which must give the single run bit for bit.  missing() must name
+ * the chunks of a shard left out, and refuse shards of another job.
+ */
+static void shardMerge (CheckRun& run)
+{
+	vector<ShowdownShard> jobs (3);
+	jobs[0].game   = "h";
+	jobs[0].board  = "Td7c2s";
+	jobs[0].ranges = { "AA,KK", "QQ,AKs", "JJ" };
+	jobs[0].pots   = { SidePot (100.0, 7), SidePot (50.0, 6) };
+	jobs[1].game   = "h";
+	jobs[1].board  = "9h8h2c";
+	jobs[1].ranges = { "AA:0.5,KK", "T9s,87s:0.25" };
+	jobs[2].game   = "o";
+	jobs[2].ranges = { "AA", "random" };
+	jobs[2].trials = max<uint64_t> (1, run.samples / 20);
+	jobs[2].seed   = run.seed;
+
+	for (ShowdownShard& job: jobs)
+	{
+		boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc (job.game);
+		vector<CardDistribution> players;
+		for (const string& r: job.ranges)
+			players.push_back (CardDistribution (r, peval->handSize()));
+		ShowdownEnumerator enumerator (peval, players, CardSet (job.board), CardSet (job.dead));
+		enumerator.setPots (job.pots);
+		job.totalChunks = job.trials > 0 ? ShowdownEnumerator::sampleChunks (job.trials)
+			: enumerator.enumerateChunks ();
+		string name = job.game + " " + job.board + " " + job.ranges[0];
+
+		vector<ShowdownShard> shards;
+		for (uint64_t k=0; k<3; k++)
+		{
+			pair<uint64_t,uint64_t> range = ShowdownShard::shardRange (job.totalChunks, k, 3);
+			ShowdownShard shard = job;
+			shard.run (enumerator, range.first, range.second);
+			stringstream file;
+			shard.write (file);
+			shards.push_back (ShowdownShard::read (file));
+		}
+		run.hands += job.totalChunks;
+
+		ShowdownResult single = job.trials > 0 ? enumerator.sample (job.trials, job.seed)
+			: enumerator.enumerate ();
+		if (!sameResult (ShowdownShard::merge (shards), single))
+			fail (run, name + ": merged shards differ from a single run");
+
+		if (!ShowdownShard::missing (shards).empty())
+			fail (run, name + ": missing() reports gaps in a whole job");
+		vector<ShowdownShard> gap = { shards[0], shards[2] };
+		vector<pair<uint64_t,uint64_t> > gaps = ShowdownShard::missing (gap);
+		if (gaps.size() != 1 || gaps[0].first != shards[1].firstChunk
+			|| gaps[0].second != shards[1].lastChunk ())
+			fail (run, name + ": missing() does not report the shard left out");
+
+		gap[1].seed++;
+		gap[1].board = "2h3h4h";
+		try
+		{
+			ShowdownShard::missing (gap);
+			fail (run, name + ": missing() takes shards of different jobs");
+		}
+		catch (std::runtime_error&)
+		{}
+	}
+}
+
+/**
+ * RangeEquityEnumerator sweeps whole ranges at once; each hero hand's
+ * equity, and the range's, must match ShowdownEnumerator's over the
+ * same deals, to within the rounding of the different sums.
+ */
+static void rangeEquity (CheckRun& run)
+{
+	struct Spot { const char * game; const char * board; const char * hero; const char * villain; };
+	const Spot spots[] = {
+		{ "h", "Td7c2s5h", "AA,KK,AKs,T9s:0.5,76o", "JJ,QQ,KK,AA,AQs,AKs,98s:0.5" },
+		{ "h", "Ah8h3c",   "AK,KhQh,33",            "random" },
+		{ "O", "Kd9c4h",   "AcAdKsQs,JhTh9h8c:0.5,7c6c5d4d", "AsAhQcJd,Tc9s8d7h,KhKcQdQh:0.25,6h5h4c3c" },
+	};
+	const double TOLERANCE = 1e-9;
+
+	for (const Spot& spot: spots)
+	{
+		boost::shared_ptr<PokerHandEvaluator> peval = PokerHandEvaluator::alloc (spot.game);
+		CardDistribution hero (spot.hero, peval->handSize());
+		CardDistribution villain (spot.villain, peval->handSize());
+		CardSet board (spot.board);
+		RangeEquity sweep = RangeEquityEnumerator (peval, board).calculate (hero, villain);
+		string name = string (spot.game) + " " + spot.board;
+
+		for (size_t h=0; h<hero.size(); h++)
+		{
+			if (hero[h].intersects (board))
+				continue;
+			vector<CardDistribution> players = { CardDistribution (hero[h]), villain };
+			double want = ShowdownEnumerator (peval, players, board).enumerate ().equity (0);
+			if (fabs (sweep.equity (h) - want) > TOLERANCE)
+				fail (run, (boost::format("%s %s: equity %.12f, showdowns give %.12f")
+							% name % hero[h].str() % sweep.equity (h) % want).str());
+			run.hands++;
+		}
+		vector<CardDistribution> players = { hero, villain };
+		double want = ShowdownEnumerator (peval, players, board).enumerate ().equity (0);
+		if (fabs (sweep.equity () - want) > TOLERANCE)
+			fail (run, (boost::format("%s range: equity %.12f, showdowns give %.12f")
+						% name % sweep.equity () % want).str());
+	}
+}
+
+// the next larger mask with as many bits set
+static uint64_t nextSubset (uint64_t x)
+{
+	uint64_t c = x & (~x + 1);
+	uint64_t r = x + c;
+	return (((r ^ x) >> 2) / c) | r;
+}
+
+static uint64_t choose (uint64_t n, uint64_t k)
+{
+	uint64_t ret = 1;
+	for (uint64_t i=1; i<=k; i++)
+		ret = ret * (n - k + i) / i;
+	return ret;
+}
+
+/**
+ * Every 4 and 5 card hand is indexed: each class must be met as often
+ * as its multiplicity, the multiplicities must add up to C(52,n), and
+ * each canonical hand must index back to its class.
+ */
+static void omahaIndexer (CheckRun& run)
+{
+	const uint64_t DECK = (ONE64 << CardSet::STANDARD_DECK_SIZE) - 1;
+	const size_t   sizes[] = { 4, 5 };
+	const uint32_t classes[] = { 16432, 134459 };
+	for (size_t s=0; s<2; s++)
+	{
+		OmahaHandIndexer indexer (sizes[s]);
+		string name = (boost::format("%d cards") % sizes[s]).str();
+		if (indexer.size () != classes[s])
+			fail (run, (boost::format("%s: %d classes, not %d") % name % indexer.size () % classes[s]).str());
+
+		vector<uint32_t> met (indexer.size (), 0);
+		for (uint64_t hand=(ONE64 << sizes[s]) - 1; hand <= DECK; hand=nextSubset (hand))
+		{
+			uint32_t idx = indexer.index (CardSet (hand));
+			if (idx < met.size())
+				met[idx]++;
+			else
+				fail (run, name + ": " + CardSet (hand).str() + " indexes out of range");
+			run.hands++;
+		}
+
+		uint64_t total = 0;
+		for (uint32_t idx=0; idx<indexer.size (); idx++)
+		{
+			total += indexer.multiplicity (idx);
+			if (met[idx] != indexer.multiplicity (idx))
+				fail (run, (boost::format("%s: class %d met %d times, multiplicity %d")
+							% name % idx % met[idx] % indexer.multiplicity (idx)).str());
+			CardSet hand = indexer.unindex (idx);
+			if (hand.size () != sizes[s] || indexer.index (hand) != idx)
+				fail (run, (boost::format("%s: class %d unindexes to %s") % name % idx % hand.str()).str());
+		}
+		if (total != choose (CardSet::STANDARD_DECK_SIZE, sizes[s]))
+			fail (run, (boost::format("%s: multiplicities add up to %d") % name % total).str());
+	}
+}
+
+/**
+ * one of the 24 permutations of the suits, the same for every round
+ */
+static bool sameUpToSuits (const CardSet a[], const CardSet b[], size_t n)
+{
+	int perm[] = { 0, 1, 2, 3 };
+	do
+	{
+		size_t r = 0;
+		while (r < n && a[r].rotateSuits (perm[0], perm[1], perm[2], perm[3]) == b[r])
+			r++;
+		if (r == n)
+			return true;
+	}
+	while (next_permutation (perm, perm+4));
+	return false;
+}
+
+/**
+ * Both layouts of HoldemHandIndexer.  Preflop and flop are visited
+ * exhaustively: every class must be met, and unindex to a state which
+ * indexes back to it.  Turn and river states are sampled: each must
+ * index like its canonical state and like a suit permutation of it,
+ * and the canonical state must be the same but for the suits, round
+ * by round.
+ */
+static void holdemIndexer (CheckRun& run)
+{
+	const uint64_t DECK = (ONE64 << CardSet::STANDARD_DECK_SIZE) - 1;
+	const uint64_t sizes[2][NUM_HOLDEM_ROUNDS] = {
+		{ 169, 1286792, 13960050, 123156254 },
+		{ 169, 1286792, 55190538, 2428287420ull },
+	};
+	const HoldemHandIndexer::Layout layouts[] = { HoldemHandIndexer::BOARD, HoldemHandIndexer::STREETS };
+	for (size_t l=0; l<2; l++)
+	{
+		HoldemHandIndexer indexer (layouts[l]);
+		string name = l == 0 ? "board" : "streets";
+		for (size_t street=PREFLOP; street<NUM_HOLDEM_ROUNDS; street++)
+			if (indexer.size (street) != sizes[l][street])
+				fail (run, (boost::format("%s: street %d has %d classes, not %d")
+							% name % street % indexer.size (street) % sizes[l][street]).str());
+
+		for (size_t street=PREFLOP; street<=FLOP; street++)
+		{
+			vector<uint32_t> met (indexer.size (street), 0);
+			size_t nflop = street == FLOP ? NUM_FLOP_CARDS : 0;
+			for (uint64_t hole=3; hole<=DECK; hole=nextSubset (hole))
+				for (uint64_t flop=(ONE64 << nflop) - 1; flop<=DECK; flop=nflop ? nextSubset (flop) : DECK+1)
+				{
+					if (flop & hole)
+						continue;
+					uint64_t idx = indexer.index (CardSet (hole), CardSet (flop), CardSet (), CardSet ());
+					if (idx < met.size())
+						met[idx]++;
+					else
+						fail (run, name + ": " + CardSet (hole | flop).str() + " indexes out of range");
+					run.hands++;
+				}
+			for (uint64_t idx=0; idx<met.size(); idx++)
+			{
+				CardSet rounds[4];
+				indexer.unindex (street, idx, rounds[0], rounds[1], rounds[2], rounds[3]);
+				if (met[idx] == 0 || indexer.index (rounds[0], rounds[1], rounds[2], rounds[3]) != idx)
+					fail (run, (boost::format("%s: street %d class %d met %d times, unindexes to %s %s")
+								% name % street % idx % met[idx] % rounds[0].str() % rounds[1].str()).str());
+			}
+		}
+
+		for (uint64_t i=0; i<run.samples; i++)
+		{
+			Philox4x32 rng (run.seed, i);
+			size_t street = TURN + i % 2;
+			const size_t ncards[] = { NUM_HOLDEM_POCKET, NUM_FLOP_CARDS, 1, street == RIVER ? 1u : 0u };
+			CardSet rounds[4];
+			uint64_t used = 0;
+			for (size_t r=0; r<4; r++)
+			{
+				uint64_t cards = 0;
+				while (CardSet (cards).size() < ncards[r])
+				{
+					uint64_t c = ONE64 << rng.below (CardSet::STANDARD_DECK_SIZE);
+					if (!(c & used))
+						cards |= c;
+				}
+				used |= cards;
+				rounds[r] = CardSet (cards);
+			}
+			int perm[] = { 0, 1, 2, 3 };
+			for (size_t k=rng.below (24); k>0; k--)
+				next_permutation (perm, perm+4);
+			CardSet permuted[4];
+			for (size_t r=0; r<4; r++)
+				permuted[r] = rounds[r].rotateSuits (perm[0], perm[1], perm[2], perm[3]);
+
+			uint64_t idx = indexer.index (rounds[0], rounds[1], rounds[2], rounds[3]);
+			CardSet canon[4];
+			indexer.unindex (street, idx, canon[0], canon[1], canon[2], canon[3]);
+			// the board layout forgets the order of the board cards
+			CardSet a[] = { rounds[0], rounds[1] | rounds[2] | rounds[3] };
+			CardSet b[] = { canon[0], canon[1] | canon[2] | canon[3] };
+			bool same = l == 0 ? sameUpToSuits (a, b, 2) : sameUpToSuits (rounds, canon, 4);
+			if (idx >= indexer.size (street) || !same
+				|| indexer.index (canon[0], canon[1], canon[2], canon[3]) != idx
+				|| indexer.index (permuted[0], permuted[1], permuted[2], permuted[3]) != idx)
+				fail (run, (boost::format("%s: %s %s %s %s indexes to %d, which unindexes to %s %s %s %s")
+							% name % rounds[0].str() % rounds[1].str() % rounds[2].str() % rounds[3].str()
+							% idx % canon[0].str() % canon[1].str() % canon[2].str() % canon[3].str()).str());
+			run.hands++;
+		}
+	}
+}
+
+int main (int argc, char ** argv)
+{
+    string extendedHelp = "\n"
+        "   Checks evaluator backends against the reference CardSet kernels,\n"
+        "   exhaustively over every 5 and 7 card hand and by sampling for\n"
+        "   omaha, stud/8 and badugi.  The batch evaluators are checked hand\n"
+        "   by hand against the single hand ones.  The engine checks run\n"
+        "   shards of equity jobs through their files and merge them, and\n"
+        "   compare range against range equity with single showdowns.  The\n"
+        "   indexer checks cover the hold'em and omaha hand indexers.\n"
+        "   Prints one CSV line per check and exits non-zero on any\n"
+        "   mismatch.\n"
+        "\n"
+        "   examples:\n"
+		"		./validate --threads 8\n"
+		"		./validate --check omaha-eight --samples 10000000\n"
+		"		./validate --domain all5\n"
+        "\n"
+        ;
+
+    try
+    {
+        // set up the program options, handle the help case, and extract the values
+		po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,?", "produce help message")
+            ("check,c",   po::value<string>()->default_value(""),     "only run this check")
+            ("domain,d",  po::value<string>()->default_value(""),     "only run checks over this domain")
+            ("threads,t", po::value<size_t>()->default_value(boost::thread::hardware_concurrency()),
+                                                                      "number of threads")
+            ("samples,n", po::value<uint64_t>()->default_value(1000000), "hands per sampled check")
+            ("seed",      po::value<uint32_t>()->default_value(1),    "seed for sampled checks")
+            ("list",                                                  "list the checks")
+            ;
+
+        po::variables_map vm;
+        po::store (po::command_line_parser(argc, argv)
+                   .style(po::command_line_style::unix_style)
+                   .options(desc)
+                   .run(), vm);
+        po::notify (vm);
+
+		// check for help
+        if (vm.count("help"))
+        {
+            cout << desc << extendedHelp << endl;
+            return 1;
+        }
+
+		if (vm.count("list"))
+		{
+			for (const Check& c: checks ())
+				cout << boost::format("%-18s %s\n") % c.name % c.domain;
+			return 0;
+		}
+
+		string onlyCheck  = vm["check"].as<string>();
+		string onlyDomain = vm["domain"].as<string>();
+		size_t nthreads   = max<size_t> (1, vm["threads"].as<size_t>());
+		ThreadPool::configureShared (nthreads);
+		bool failed = false;
+		int found = 0;
+
+		cout << "check,domain,threads,hands,mismatches,seconds,mhands_per_sec\n";
+		for (const Check& c: checks ())
+		{
+			if ((!onlyCheck.empty() && onlyCheck != c.name) ||
+				(!onlyDomain.empty() && onlyDomain != c.domain))
+				continue;
+			found++;
+
+			CheckRun run;
+			run.check      = &c;
+			run.ncards     = c.domain == "all5" ? 5 : 7;
+			run.samples    = vm["samples"].as<uint64_t>();
+			run.seed       = vm["seed"].as<uint32_t>();
+			run.nthreads   = nthreads;
+			run.nextJob    = 0;
+			run.hands      = 0;
+			run.mismatches = 0;
+			bool exhaustive = c.domain.compare (0, 3, "all") == 0;
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+			boost::thread_group threads;
+			if (c.engine)
+				c.engine (run);
+			for (size_t t=0; t<nthreads && !c.engine; t++)
+			{
+				if (exhaustive)
+					threads.create_thread (boost::bind (c.batch ? exhaustiveBatchWorker : exhaustiveWorker, &run));
+				else
+					threads.create_thread (boost::bind (c.batch ? sampleBatchWorker : sampleWorker, &run, t));
+			}
+			threads.join_all ();
+			double seconds = chrono::duration<double>(chrono::steady_clock::now () - start).count();
+
+			cout << boost::format("%s,%s,%d,%d,%d,%.3f,%.2f\n")
+				% c.name % c.domain % nthreads % run.hands % run.mismatches % seconds
+				% (run.hands / seconds / 1e6);
+			for (const string& e: run.examples)
+				cerr << c.name << ": " << e << "\n";
+			failed = failed || run.mismatches > 0;
+		}
+		if (found == 0)
+			throw std::invalid_argument ("no check matches: " + onlyCheck + " " + onlyDomain);
+		return failed ? 2 : 0;
+    }
+    catch(std::exception& e)
+    {
+        cerr << "-- caught exception--\n" << e.what() << "\n";
+        return 1;
+    }
+    catch(...)
+    {
+        cerr << "Exception of unknown type!\n";
+        return 1;
+    }
+    return 0;
+}